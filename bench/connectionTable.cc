@@ -0,0 +1,86 @@
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../src/connectionTable.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+static std::vector<IpAddr>
+makeAddrs(size_t num)
+{
+  std::mt19937 gen(1234);
+  std::vector<IpAddr> addrs(num);
+  for (auto& ipAddr : addrs) {
+    ipAddr.addr.sin_family = AF_INET;
+    ipAddr.addr.sin_addr.s_addr = gen();
+    ipAddr.addr.sin_port = uint16_t(gen());
+    ipAddr.addrLen = sizeof(ipAddr.addr);
+  }
+  return addrs;
+}
+
+// per packet lookup cost as the number of connections grows
+static void
+ConnectionTable_Find(benchmark::State& state)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto addrs = makeAddrs(state.range(0));
+  ConnectionTable table;
+  for (const auto& addr : addrs) {
+    table.insert(addr, now);
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    auto con = table.find(addrs[i]);
+    con->lastSeen = now;
+    benchmark::DoNotOptimize(con);
+    i = (i + 1) % addrs.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ConnectionTable_Find)->RangeMultiplier(8)->Range(8, 1 << 16);
+
+// what ServerConnectionPipe used before, for comparison
+static void
+ConnectionTable_StdMapFind(benchmark::State& state)
+{
+  auto addrs = makeAddrs(state.range(0));
+  std::map<IpAddr, uint32_t> pathTokens;
+  for (const auto& addr : addrs) {
+    pathTokens[addr] = 1;
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    auto it = pathTokens.find(addrs[i]);
+    benchmark::DoNotOptimize(it);
+    pathTokens[addrs[i]] = 2;
+    i = (i + 1) % addrs.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ConnectionTable_StdMapFind)->RangeMultiplier(8)->Range(8, 1 << 16);
+
+static void
+ConnectionTable_InsertErase(benchmark::State& state)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto addrs = makeAddrs(state.range(0));
+  ConnectionTable table;
+
+  for (auto _ : state) {
+    for (const auto& addr : addrs) {
+      table.insert(addr, now);
+    }
+    for (const auto& addr : addrs) {
+      table.erase(addr);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * addrs.size());
+}
+BENCHMARK(ConnectionTable_InsertErase)->Arg(1024)->Arg(1 << 14);
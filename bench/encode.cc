@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "quicr/packet.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+// the headers each published object carries, written onto a packet and
+// read back off it
+static void
+Encode_DataHeaders(benchmark::State& state)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->reserve(1280);
+  packet << Packet::Header(PacketTag::headerData);
+  packet->push_back(std::vector<uint8_t>(1000, 0x5a));
+
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/1/");
+  namedDataChunk.shortName.mediaTime = 5000;
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(1000);
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  for (auto _ : state) {
+    packet << dataBlock;
+    packet << namedDataChunk;
+    packet << clientData;
+
+    bool ok = packet >> clientData;
+    ok &= packet >> namedDataChunk;
+    ok &= packet >> dataBlock;
+    benchmark::DoNotOptimize(ok);
+    clientData.clientSeqNum++;
+  }
+}
+BENCHMARK(Encode_DataHeaders);
+
+// a varint of the arg's size onto a packet and back
+static void
+Encode_VarInt(benchmark::State& state)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->reserve(64);
+  packet << Packet::Header(PacketTag::headerData);
+  uint64_t value = state.range(0);
+
+  for (auto _ : state) {
+    packet << toVarInt(value);
+    uintVar_t var;
+    packet >> var;
+    benchmark::DoNotOptimize(fromVarInt(var));
+  }
+}
+BENCHMARK(Encode_VarInt)->Arg(100)->Arg(10000)->Arg(1 << 20)->Arg(1 << 29);
@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/encryptPipe.hh"
+#include "quicr/packet.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+class SinkPipe : public PipeInterface
+{
+public:
+  SinkPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    benchmark::DoNotOptimize(&packet->fullData());
+    return true;
+  }
+};
+
+// hands what EncryptPipe sends back up to it, as the relay would
+class EncryptLoopPipe : public PipeInterface
+{
+public:
+  EncryptLoopPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    ClientData clientData;
+    packet >> clientData;
+    held = std::move(packet);
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override { return std::move(held); }
+
+  std::unique_ptr<Packet> held;
+};
+
+// publish path: payload in, ciphertext handed to the next pipe
+static void
+Encrypt_Publish(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto sink = new SinkPipe(); // owned by encryptPipe
+  EncryptPipe encryptPipe(sink);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+
+  std::vector<uint8_t> payload(size, 0x5a);
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/");
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(size);
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  for (auto _ : state) {
+    auto packet = std::make_unique<Packet>();
+    packet->reserve(size + sframe::max_overhead + 20);
+    packet << Packet::Header(PacketTag::headerData);
+    packet->push_back(payload);
+    packet << dataBlock;
+    packet << namedDataChunk;
+    packet << clientData;
+
+    encryptPipe.send(std::move(packet));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Encrypt_Publish)->Arg(100)->Arg(1000)->Arg(16000)->Arg(60000);
+
+// same with the crypto fanned out to worker threads, args are payload size
+// and thread count; up to CryptoWorkerPool::maxPending packets may still be
+// in flight when the timing stops
+static void
+Encrypt_PublishThreads(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto sink = new SinkPipe(); // owned by encryptPipe
+  EncryptPipe encryptPipe(sink);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+  encryptPipe.setCryptoThreads(int(state.range(1)));
+
+  std::vector<uint8_t> payload(size, 0x5a);
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/");
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(size);
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  for (auto _ : state) {
+    auto packet = std::make_unique<Packet>();
+    packet->reserve(size + sframe::max_overhead + 20);
+    packet << Packet::Header(PacketTag::headerData);
+    packet->push_back(payload);
+    packet << dataBlock;
+    packet << namedDataChunk;
+    packet << clientData;
+
+    encryptPipe.send(std::move(packet));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Encrypt_PublishThreads)
+  ->Args({ 1200, 1 })
+  ->Args({ 1200, 2 })
+  ->Args({ 1200, 4 })
+  ->Args({ 16000, 1 })
+  ->Args({ 16000, 4 });
+
+// protect on the way out and unprotect on the way back in
+static void
+Encrypt_RoundTrip(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto loop = new EncryptLoopPipe(); // owned by encryptPipe
+  EncryptPipe encryptPipe(loop);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+
+  std::vector<uint8_t> payload(size, 0x5a);
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/");
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(size);
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  for (auto _ : state) {
+    auto packet = std::make_unique<Packet>();
+    packet->reserve(size + sframe::max_overhead + 20);
+    packet << Packet::Header(PacketTag::headerData);
+    packet->push_back(payload);
+    packet << dataBlock;
+    packet << namedDataChunk;
+    packet << clientData;
+
+    encryptPipe.send(std::move(packet));
+    auto decrypted = encryptPipe.recv();
+    benchmark::DoNotOptimize(decrypted.get());
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Encrypt_RoundTrip)->Arg(100)->Arg(1000)->Arg(16000);
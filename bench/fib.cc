@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+
+#include "../cmd/relay/include/multimap_fib.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+static IpAddr
+makeFace(uint32_t n)
+{
+  IpAddr face{};
+  face.addr.sin_family = AF_INET;
+  face.addr.sin_addr.s_addr = htonl(0x0a000000 + n);
+  face.addr.sin_port = htons(5004);
+  face.addrLen = sizeof(face.addr);
+  return face;
+}
+
+// the relay's per object lookup with the arg's number of subscriptions,
+// four subscribers on each sender's name
+static void
+Fib_Lookup(benchmark::State& state)
+{
+  auto numSubscriptions = uint32_t(state.range(0));
+  uint32_t numSenders = std::max<uint32_t>(numSubscriptions / 4, 1);
+
+  MultimapFib fib;
+  for (uint32_t i = 0; i < numSubscriptions; i++) {
+    ShortName name(1234, 1 + i % numSenders);
+    fib.addSubscription(name, SubscriberInfo{ name, makeFace(i) });
+  }
+
+  ShortName published(1234, 1 + numSenders / 2, 1);
+  for (auto _ : state) {
+    published.mediaTime++;
+    auto subscribers = fib.lookupSubscription(published);
+    benchmark::DoNotOptimize(subscribers.size());
+  }
+}
+BENCHMARK(Fib_Lookup)->RangeMultiplier(8)->Range(64, 1 << 16);
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/fragmentPipe.hh"
+#include "quicr/packet.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+class FragmentSinkPipe : public PipeInterface
+{
+public:
+  FragmentSinkPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    benchmark::DoNotOptimize(&packet->fullData());
+    return true;
+  }
+};
+
+// keeps the fragments, minus the ClientData the connection would take off
+class FragmentCollectPipe : public PipeInterface
+{
+public:
+  FragmentCollectPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    ClientData clientData;
+    packet >> clientData;
+    fragments.push_back(std::move(packet));
+    return true;
+  }
+
+  std::deque<std::unique_ptr<Packet>> fragments;
+};
+
+static std::unique_ptr<Packet>
+makeObject(const std::vector<uint8_t>& payload, uint32_t mediaTime = 0)
+{
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/");
+  namedDataChunk.shortName.mediaTime = mediaTime;
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(payload.size());
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  auto packet = std::make_unique<Packet>();
+  packet->reserve(payload.size() + 20);
+  packet << Packet::Header(PacketTag::headerData);
+  packet->push_back(payload);
+  packet << dataBlock;
+  packet << namedDataChunk;
+  packet << clientData;
+  return packet;
+}
+
+// splitting one object into mtu sized fragments, the bytes per second
+// should stay flat as the object grows
+static void
+Fragment_Send(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto sink = new FragmentSinkPipe(); // owned by fragmentPipe
+  FragmentPipe fragmentPipe(sink);
+
+  std::vector<uint8_t> payload(size, 0x5a);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto packet = makeObject(payload);
+    state.ResumeTiming();
+
+    fragmentPipe.send(std::move(packet));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Fragment_Send)->Arg(6000)->Arg(20000)->Arg(40000)->Arg(70000);
+
+// putting the fragments of one object back together, they arrive in order
+static void
+Fragment_Reassemble(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto collect = new FragmentCollectPipe(); // owned by fragmentPipe
+  FragmentPipe fragmentPipe(collect);
+  std::vector<uint8_t> payload(size, 0x5a);
+  uint32_t mediaTime = 0;
+  int64_t objects = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    fragmentPipe.send(makeObject(payload, ++mediaTime));
+    auto fragments = std::move(collect->fragments);
+    collect->fragments.clear();
+    state.ResumeTiming();
+
+    for (auto& fragment : fragments) {
+      if (fragmentPipe.processRxPacket(std::move(fragment))) {
+        objects++;
+      }
+    }
+  }
+  state.SetItemsProcessed(objects);
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Fragment_Reassemble)->Arg(6000)->Arg(20000)->Arg(40000)->Arg(70000);
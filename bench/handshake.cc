@@ -0,0 +1,100 @@
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <memory>
+
+#include "../src/connectionPipe.hh"
+#include "../src/encode.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+// stands in for the UDP socket under a ServerConnectionPipe
+class HandshakePipe : public PipeInterface
+{
+public:
+  HandshakePipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    sent = std::move(packet);
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override { return std::move(pending); }
+
+  std::unique_ptr<Packet> pending;
+  std::unique_ptr<Packet> sent;
+};
+
+static std::unique_ptr<Packet>
+makeSyn(uint32_t host, uint16_t port, uint32_t cookie)
+{
+  IpAddr src{};
+  src.addr.sin_family = AF_INET;
+  src.addr.sin_addr.s_addr = htonl(host);
+  src.addr.sin_port = htons(port);
+  src.addrLen = sizeof(src.addr);
+
+  auto packet = std::make_unique<Packet>();
+  packet << Packet::Header{ PacketTag::headerSyn, 1 };
+  NetSyncReq synReq{};
+  synReq.senderId = 1;
+  synReq.cookie = cookie;
+  synReq.origin = "example.com";
+  packet << synReq;
+  packet->setSrc(src);
+  return packet;
+}
+
+// a flood of first syncs, each answered with a retry cookie
+static void
+Handshake_SynFlood(benchmark::State& state)
+{
+  auto udp = new HandshakePipe(); // owned by server
+  ServerConnectionPipe server(udp);
+
+  uint32_t i = 0;
+  for (auto _ : state) {
+    udp->pending = makeSyn(0x0a000000 + (i >> 16), uint16_t(i), 0);
+    server.recv();
+    benchmark::DoNotOptimize(udp->sent);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Handshake_SynFlood);
+
+// sync, retry, sync with cookie, sync ack
+static void
+Handshake_Complete(benchmark::State& state)
+{
+  auto udp = new HandshakePipe(); // owned by server
+  ServerConnectionPipe server(udp);
+
+  // every new connection is logged
+  std::clog.setstate(std::ios::failbit);
+
+  uint32_t i = 0;
+  for (auto _ : state) {
+    uint32_t host = 0x0a000000 + (i >> 16);
+    auto port = uint16_t(i);
+
+    udp->pending = makeSyn(host, port, 0);
+    server.recv();
+
+    NetResetRetry rstRetry{};
+    udp->sent >> rstRetry;
+
+    udp->pending = makeSyn(host, port, rstRetry.cookie);
+    server.recv();
+    benchmark::DoNotOptimize(udp->sent);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  std::clog.clear();
+}
+BENCHMARK(Handshake_Complete);
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/jitterBufferPipe.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+class JitterFeedPipe : public PipeInterface
+{
+public:
+  JitterFeedPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  std::unique_ptr<Packet> recv() override
+  {
+    if (queue.empty()) {
+      return nullptr;
+    }
+    auto packet = std::move(queue.front());
+    queue.pop_front();
+    return packet;
+  }
+
+  std::deque<std::unique_ptr<Packet>> queue;
+};
+
+// 20 ms objects over a path with 20 ms delay plus uniform jitter of up to
+// range(0) ms and 2% loss, played on a simulated 1 ms clock. Reports the
+// mean latency from send to release, the spread of the release gaps around
+// 20 ms, and the share of objects that came too late to play.
+static void
+JitterBuffer_Playout(benchmark::State& state)
+{
+  const int frameMs = 20;
+  const int numFrames = 500;
+  const int jitterRangeMs = int(state.range(0));
+
+  QuicRClient client;
+  std::mt19937 rand(1);
+  std::uniform_int_distribution<int> jitterDist(0, jitterRangeMs);
+  std::uniform_int_distribution<int> lossDist(0, 99);
+
+  double latencySum = 0;
+  double gapSquareSum = 0;
+  uint64_t released = 0;
+  uint64_t gaps = 0;
+  uint64_t late = 0;
+  uint64_t delivered = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto feed = new JitterFeedPipe(); // owned by jitterBuffer
+    JitterBufferPipe jitterBuffer(feed);
+    jitterBuffer.setDepth(10, 200);
+    // what the rate control would estimate for this path
+    jitterBuffer.updateStat(PipeInterface::StatName::jitterDownMs,
+                            uint64_t(jitterRangeMs / 2));
+
+    std::vector<std::pair<int, uint32_t>> arrivals; // ms, mediaTime
+    for (int i = 0; i < numFrames; i++) {
+      if (lossDist(rand) < 2) {
+        continue;
+      }
+      arrivals.emplace_back(i * frameMs + 20 + jitterDist(rand), i * frameMs);
+    }
+    std::sort(arrivals.begin(), arrivals.end());
+    delivered += arrivals.size();
+
+    auto name = ShortName::fromString("qr://1234/12/");
+    std::vector<std::unique_ptr<Packet>> packets;
+    for (const auto& arrival : arrivals) {
+      name.mediaTime = arrival.second;
+      auto packet = client.createPacket(name, 100);
+      packet->resize(100);
+      NamedDataChunk namedDataChunk;
+      namedDataChunk.shortName = name;
+      namedDataChunk.lifetime = toVarInt(0);
+      namedDataChunk.priority = 3;
+      packet << namedDataChunk;
+      packets.push_back(std::move(packet));
+    }
+    state.ResumeTiming();
+
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    int lastRelease = -1;
+    int endMs = numFrames * frameMs + jitterRangeMs + 500;
+    for (int ms = 0; ms < endMs; ms++) {
+      while (next < arrivals.size() && arrivals[next].first <= ms) {
+        feed->queue.push_back(std::move(packets[next++]));
+      }
+      auto now = start + std::chrono::milliseconds(ms);
+      while (auto packet = jitterBuffer.recv(now)) {
+        latencySum += ms - int(packet->shortName().mediaTime);
+        released++;
+        if (lastRelease >= 0) {
+          double gapError = (ms - lastRelease) - frameMs;
+          gapSquareSum += gapError * gapError;
+          gaps++;
+        }
+        lastRelease = ms;
+      }
+    }
+    late += jitterBuffer.lateCount();
+  }
+
+  state.counters["latencyMs"] = released ? latencySum / released : 0;
+  state.counters["gapStdDevMs"] = gaps ? std::sqrt(gapSquareSum / gaps) : 0;
+  state.counters["lateRate"] = delivered ? double(late) / delivered : 0;
+}
+BENCHMARK(JitterBuffer_Playout)->Arg(0)->Arg(10)->Arg(40)->Iterations(20);
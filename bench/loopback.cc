@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/quicRServer.hh"
+
+using namespace MediaNet;
+
+// objects per second published through a whole client to a server on a
+// LoopbackNetwork, with the pacer, connection and transport threads all
+// running. The arg is the object size. delivered is the share of objects
+// the server got; the rest were dropped from the send queues while the
+// rate control held the pacer back.
+static void
+Loopback_Publish(benchmark::State& state)
+{
+  size_t size = state.range(0);
+
+  LoopbackNetwork network;
+  QuicRServer server(network);
+  server.open(5004);
+
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> received(0);
+  std::thread relay([&]() {
+    while (!done) {
+      auto packet = server.recv(std::chrono::milliseconds(1));
+      if (packet && nextTag(packet) == PacketTag::clientData) {
+        received++;
+      }
+    }
+  });
+
+  QuicRClient client(ClientConfig(), network);
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  client.open(1, "loopback", 5004, 1);
+  while (!client.ready()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::vector<uint8_t> payload(size, 0x5a);
+  auto name = ShortName::fromString("qr://1234/12/");
+  for (auto _ : state) {
+    name.mediaTime++;
+    auto packet = client.createPacket(name, int(size));
+    packet->push_back(payload);
+    packet->setPriority(3);
+    packet->setReliable(false);
+    client.publish(std::move(packet));
+  }
+
+  // let what is queued drain
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  done = true;
+  relay.join();
+  client.close();
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["delivered"] =
+    double(received) / double(std::max<uint64_t>(state.iterations(), 1));
+}
+BENCHMARK(Loopback_Publish)->Arg(200)->Arg(1000)->UseRealTime();
@@ -0,0 +1,26 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+// a full copy of a packet of the arg's size, as FEC and the relay's
+// fan-out make
+static void
+Packet_Clone(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  auto packet = std::make_unique<Packet>();
+  packet << Packet::Header(PacketTag::headerData);
+  packet->push_back(std::vector<uint8_t>(size, 0x5a));
+
+  for (auto _ : state) {
+    auto copy = packet->clone();
+    benchmark::DoNotOptimize(&copy->fullData());
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(Packet_Clone)->Arg(100)->Arg(1200)->Arg(16000);
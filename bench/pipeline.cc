@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+
+#include "../src/crazyBitPipe.hh"
+#include "../src/encode.hh"
+#include "../src/staticPipeline.hh"
+#include "../src/statsPipe.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+// hands back what it was sent, so one packet goes round and round
+class LoopSinkPipe : public PipeInterface
+{
+public:
+  LoopSinkPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    held = std::move(packet);
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override { return std::move(held); }
+
+  std::unique_ptr<Packet> held;
+};
+
+static std::unique_ptr<Packet>
+makePacket()
+{
+  auto packet = std::make_unique<Packet>();
+  packet << Packet::Header(PacketTag::headerData);
+  packet->resize(100);
+  return packet;
+}
+
+// one packet down and back up through stats and spin bit, as virtual
+// calls per stage
+static void
+Pipeline_Dynamic(benchmark::State& state)
+{
+  auto sink = new LoopSinkPipe(); // owned by the chain
+  StatsPipe head(new CrazyBitPipe(sink));
+  sink->held = makePacket();
+
+  for (auto _ : state) {
+    head.send(sink->recv());
+    auto packet = head.recv();
+    benchmark::DoNotOptimize(packet.get());
+    sink->held = std::move(packet);
+  }
+}
+BENCHMARK(Pipeline_Dynamic);
+
+// the same stages composed at compile time, one virtual call in and one
+// out to the dynamic sink
+static void
+Pipeline_Static(benchmark::State& state)
+{
+  auto sink = new LoopSinkPipe(); // owned by the chain
+  StaticPipe<StatsStage<CrazyBitStage<DynamicTail>>> head(sink);
+  sink->held = makePacket();
+
+  for (auto _ : state) {
+    head.send(sink->recv());
+    auto packet = head.recv();
+    benchmark::DoNotOptimize(packet.get());
+    sink->held = std::move(packet);
+  }
+}
+BENCHMARK(Pipeline_Static);
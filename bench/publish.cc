@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+// objects per second a single publishing thread pushes from publish() down
+// to the priority queues, args are object size and batch size with 0 being
+// one publish() per object. The client is not opened so nothing drains the
+// queues, they drop their oldest past 1000 packets.
+static void
+Client_Publish(benchmark::State& state)
+{
+  size_t size = state.range(0);
+  size_t batchSize = state.range(1);
+
+  QuicRClient client;
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+
+  std::vector<uint8_t> payload(size, 0x5a);
+  auto name = ShortName::fromString("qr://1234/12/");
+  std::vector<std::unique_ptr<Packet>> batch;
+
+  auto makeObject = [&]() {
+    name.mediaTime++;
+    auto packet = client.createPacket(name, int(size));
+    packet->push_back(payload);
+    packet->setPriority(3);
+    return packet;
+  };
+
+  for (auto _ : state) {
+    if (batchSize == 0) {
+      state.PauseTiming();
+      auto packet = makeObject();
+      state.ResumeTiming();
+      client.publish(std::move(packet));
+      continue;
+    }
+
+    state.PauseTiming();
+    for (size_t i = 0; i < batchSize; i++) {
+      batch.push_back(makeObject());
+    }
+    state.ResumeTiming();
+    client.publishBatch(batch);
+  }
+  state.SetItemsProcessed(state.iterations() * std::max<size_t>(batchSize, 1));
+}
+BENCHMARK(Client_Publish)
+  ->Args({ 200, 0 })
+  ->Args({ 200, 8 })
+  ->Args({ 200, 32 })
+  ->Args({ 4000, 0 })
+  ->Args({ 4000, 8 })
+  ->Args({ 4000, 32 });
@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+
+#include "../src/rateCtrl.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+// stands in for the pacer, takes the stats and acks RateCtrl hands it
+class PacerStandInPipe : public PipeInterface
+{
+public:
+  PacerStandInPipe()
+    : PipeInterface(nullptr)
+  {}
+};
+
+namespace MediaNet {
+// the friend RateCtrl lets call its private updatePhase
+class RateCtrlBench
+{
+public:
+  static void updatePhase(RateCtrl& rateCtrl,
+                          std::chrono::steady_clock::time_point now)
+  {
+    rateCtrl.updatePhase(now);
+  }
+};
+} // namespace MediaNet
+
+// the estimates RateCtrl runs at the end of each phase, over the arg's
+// number of packets sent and acked in a phase. The phases run on a clock
+// an hour ahead so the real time the calls read never moves them on.
+static void
+RateCtrl_Phase(benchmark::State& state)
+{
+  auto perPhase = uint32_t(state.range(0));
+  PacerStandInPipe pacer;
+  RateCtrl rateCtrl(&pacer);
+
+  const auto phase = std::chrono::microseconds(33333 * 2);
+  auto now = std::chrono::steady_clock::now() + std::chrono::hours(1);
+  RateCtrlBench::updatePhase(rateCtrl, now);
+
+  ShortName name(1234, 12, 1);
+  uint32_t seqNum = 0;
+  uint32_t timeUs = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (uint32_t i = 0; i < perPhase; i++) {
+      seqNum++;
+      timeUs += uint32_t(phase.count()) / perPhase;
+      name.mediaTime = seqNum;
+      rateCtrl.sendPacket(seqNum, timeUs, 8 * 1000, name);
+      rateCtrl.recvPacket(seqNum, timeUs, timeUs + 10000, 8 * 1000, false);
+      rateCtrl.recvAck(
+        seqNum, 0xffffffff, timeUs + 10000, 0, timeUs + 20000, false, true);
+    }
+    now += phase;
+    state.ResumeTiming();
+
+    RateCtrlBench::updatePhase(rateCtrl, now);
+  }
+  benchmark::DoNotOptimize(rateCtrl.bwUpTarget());
+}
+// the history is never trimmed, so the runs are kept short
+BENCHMARK(RateCtrl_Phase)->Arg(30)->Arg(300)->Arg(3000)->Iterations(300);
@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+#include <functional>
+#include <vector>
+
+#include "quicr/packet.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+static std::vector<ShortName>
+makeNames(size_t count)
+{
+  std::vector<ShortName> names;
+  for (size_t i = 0; i < count; i++) {
+    ShortName name(1234, uint32_t(1 + i % 64), uint8_t(1 + i % 3));
+    name.mediaTime = uint32_t(i);
+    names.push_back(name);
+  }
+  return names;
+}
+
+// == and < over names that mostly differ only in mediaTime, as the
+// subscribe and jitter buffer lookups see them
+static void
+ShortName_Compare(benchmark::State& state)
+{
+  auto names = makeNames(1024);
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto& a = names[i % names.size()];
+    const auto& b = names[(i + 1) % names.size()];
+    benchmark::DoNotOptimize(a == b);
+    benchmark::DoNotOptimize(a < b);
+    i++;
+  }
+}
+BENCHMARK(ShortName_Compare);
+
+static void
+ShortName_Hash(benchmark::State& state)
+{
+  auto names = makeNames(1024);
+  std::hash<ShortName> hash;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hash(names[i % names.size()]));
+    i++;
+  }
+}
+BENCHMARK(ShortName_Hash);
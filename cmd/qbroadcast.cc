@@ -1,7 +1,11 @@
 
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <thread>
 
+#include "quicr/log.hh"
+#include "quicr/metricsExporter.hh"
 #include "quicr/quicRServer.hh"
 
 //#include "../src/encode.hh"
@@ -16,8 +20,23 @@ Connection::Connection(uint32_t randNum, const MediaNet::IpAddr& addr)
 
 BroadcastRelay::BroadcastRelay(uint16_t port)
   : qServer()
+  , publishedCount(MetricsRegistry::global().counter(
+      "quicr_relay_published_total",
+      "objects received from publishers"))
+  , forwardedCount(MetricsRegistry::global().counter(
+      "quicr_relay_forwarded_total",
+      "packets sent on to subscribers"))
+  , fanOut(MetricsRegistry::global().histogram(
+      "quicr_relay_fanout",
+      "subscribers each published object goes to",
+      { 0, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 }))
+  , subscriptionCount(MetricsRegistry::global().gauge(
+      "quicr_relay_fib_entries",
+      "subscriptions in the FIB"))
 {
   qServer.open(port);
+  qServer.setClosedCallback(
+    [this](const MediaNet::IpAddr& addr) { processClosed(addr); });
   prevAckSeqNum = 0;
   prevRecvTimeUs = 0;
 
@@ -29,10 +48,9 @@ BroadcastRelay::BroadcastRelay(uint16_t port)
 void
 BroadcastRelay::process()
 {
-  std::unique_ptr<Packet> packet = qServer.recv();
+  std::unique_ptr<Packet> packet = qServer.recv(std::chrono::milliseconds(10));
 
   if (!packet) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
     return;
   }
 
@@ -52,9 +70,7 @@ BroadcastRelay::process()
     return;
   }
 
-  std::clog << std::endl
-            << "Got bad packet nextTag=" << int(nextTag(packet)) / 256
-            << std::endl;
+  QUICR_LOG_WARN("got bad packet nextTag={}", int(nextTag(packet)) / 256);
 }
 
 void
@@ -62,9 +78,8 @@ BroadcastRelay::processRate(std::unique_ptr<MediaNet::Packet>& packet)
 {
   NetRateReq rateReq;
   packet >> rateReq;
-  std::clog << std::endl
-            << "ReqRate: " << float(rateReq.bitrateKbps) / 1000.0 << " mbps"
-            << std::endl;
+  QUICR_LOG_DEBUG("rate request: {} mbps",
+                  float(fromVarInt(rateReq.bitrateKbps)) / 1000.0f);
 }
 
 void
@@ -82,7 +97,7 @@ BroadcastRelay::processAppMessage(std::unique_ptr<MediaNet::Packet>& packet)
     return processSub(packet, seqNumTag);
   }
 
-  std::clog << "Bad App message:" << (int)tag << "\n";
+  QUICR_LOG_WARN("bad app message: {}", int(tag));
 }
 
 void
@@ -109,16 +124,33 @@ BroadcastRelay::processSub(std::unique_ptr<MediaNet::Packet>& packet,
   packet >> tag;
   ShortName name;
   packet >> name;
-  std::clog << "Adding Subscription for: " << name << std::endl;
+  QUICR_LOG_INFO("adding subscription for: {}", name);
   auto conIndex = connectionMap.find(name);
   if (conIndex == connectionMap.end()) {
     // new connection
     connectionMap[name] =
       std::make_unique<Connection>(getRandom(), packet->getSrc());
+    namesByAddr[packet->getSrc()].insert(name);
+    subscriptionCount.set(int64_t(connectionMap.size()));
+  }
+}
+
+void
+BroadcastRelay::processClosed(const MediaNet::IpAddr& addr)
+{
+  auto names = namesByAddr.find(addr);
+  if (names == namesByAddr.end()) {
+    return;
   }
 
-  std::unique_ptr<Connection>& con = connectionMap[name];
-  con->lastSyn = std::chrono::steady_clock::now();
+  for (const auto& name : names->second) {
+    connectionMap.erase(name);
+  }
+  QUICR_LOG_INFO("removed {} subscriptions for: {}",
+                 names->second.size(),
+                 IpAddr::toString(addr));
+  namesByAddr.erase(names);
+  subscriptionCount.set(int64_t(connectionMap.size()));
 }
 
 void
@@ -130,8 +162,6 @@ BroadcastRelay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
   uint32_t nowUs =
     (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn).count();
 
-  std::clog << ".";
-
   // save the name for publish
   ClientData clientData;
   NamedDataChunk namedDataChunk;
@@ -146,8 +176,8 @@ BroadcastRelay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
   uint16_t payloadSize;
   packet >> payloadSize;
   if (payloadSize > packet->size()) {
-    std::clog << "relay recv bad data size " << payloadSize << " "
-              << packet->size() << std::endl;
+    QUICR_LOG_WARN(
+      "relay recv bad data size {} of {}", payloadSize, packet->size());
     return;
   }
 
@@ -171,12 +201,12 @@ BroadcastRelay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
   ack << ackTag;
 
   qServer.send(move(ack));
+  publishedCount.add();
+  fanOut.record(connectionMap.size());
 
   prevAckSeqNum = ackTag.clientSeqNum;
   prevRecvTimeUs = ackTag.recvTimeUs;
 
-  // TODO - loop over connections and remove ones with old last Syn time
-
   // TODO: push this into server class
   packet << encryptedDataBlock;
   packet << namedDataChunk;
@@ -206,9 +236,7 @@ BroadcastRelay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
 
     if (!simLoss) {
       qServer.send(move(relayDataPacket));
-      std::clog << "*";
-    } else {
-      std::clog << "-";
+      forwardedCount.add();
     }
   }
 }
@@ -223,10 +251,40 @@ BroadcastRelay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
 #pragma ide diagnostic ignored "EndlessLoop"
 #pragma ide diagnostic ignored "UnreachableCode"
 
+// a port number from 1 to 65535, or 0 if value is not one
+static uint16_t
+parsePort(const std::string& value)
+{
+  try {
+    size_t used = 0;
+    unsigned long num = std::stoul(value, &used);
+    if (used != value.size() || num > UINT16_MAX) {
+      return 0;
+    }
+    return uint16_t(num);
+  } catch (const std::exception&) {
+    return 0;
+  }
+}
+
 int
-main()
+main(int argc, char* argv[])
 {
+  // optional port to serve OpenMetrics on
+  uint16_t metricsPort = argc > 1 ? parsePort(argv[1]) : 0;
+  if (argc > 2 || (argc > 1 && metricsPort == 0)) {
+    std::cerr << "Usage: " << argv[0] << " [metricsPort]" << std::endl;
+    return -1;
+  }
+
   auto qRelay = BroadcastRelay(5004);
+
+  MetricsExporter exporter;
+  if (metricsPort != 0 && !exporter.start(metricsPort)) {
+    std::cerr << "Can not serve metrics on port " << metricsPort << std::endl;
+    return -1;
+  }
+
   while (true) {
     qRelay.process();
   }
@@ -4,9 +4,11 @@
 #include <functional> // for bind
 #include <map>
 #include <random>
+#include <set>
 
 #include "../src/encode.hh" // TODO
 
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
 #include "quicr/quicRServer.hh"
 
@@ -16,7 +18,6 @@ public:
   Connection(uint32_t relaySeq, const MediaNet::IpAddr& addr);
   uint32_t relaySeqNum;
   MediaNet::IpAddr address;
-  std::chrono::time_point<std::chrono::steady_clock> lastSyn;
 };
 
 class BroadcastRelay
@@ -30,14 +31,21 @@ public:
   void processSub(std::unique_ptr<MediaNet::Packet>& packet,
                   MediaNet::ClientData& clientSeqNum);
   void processRate(std::unique_ptr<MediaNet::Packet>& packet);
+  void processClosed(const MediaNet::IpAddr& addr);
 
 private:
   uint32_t prevAckSeqNum = 0;
   uint32_t prevRecvTimeUs = 0;
   MediaNet::QuicRServer qServer;
   std::map<MediaNet::ShortName, std::unique_ptr<Connection>> connectionMap;
+  std::map<MediaNet::IpAddr, std::set<MediaNet::ShortName>> namesByAddr;
 
   std::mt19937 randomGen;
   std::uniform_int_distribution<uint32_t> randomDist;
   std::function<uint32_t()> getRandom;
+
+  MediaNet::Counter& publishedCount;
+  MediaNet::Counter& forwardedCount;
+  MediaNet::Histogram& fanOut;
+  MediaNet::Gauge& subscriptionCount;
 };
\ No newline at end of file
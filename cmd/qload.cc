@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <quicr/quicRClient.hh>
+
+using namespace MediaNet;
+using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+// Loads a relay with many publishers and subscribers in one process and
+// reports what got through. Publisher i sends fps objects a second as
+// qr://resourceId/i/1/ with mediaTime counting up and the send time in
+// the first 8 bytes, each subscribed to by fanOut subscribers. A few
+// driver threads share the clients between them, each client still has
+// its own pacer and timer threads.
+
+struct LoadConfig
+{
+  uint32_t publishers = 10;
+  uint32_t fanOut = 1; // subscribers per publisher
+  uint32_t objectBytes = 500;
+  uint32_t fps = 30;
+  uint32_t seconds = 10;
+  uint32_t churnPerSecond = 0; // subscribers that leave and rejoin
+  uint32_t threads = 4;
+  uint32_t resourceId = 1234;
+  uint32_t relayPid = 0; // to report the relay's CPU, Linux only
+  std::string config;    // client and relay config file
+  std::string results;   // JSON results file, - is stdout
+};
+
+struct Results
+{
+  uint64_t published = 0;
+  uint64_t publishedBytes = 0;
+  uint64_t received = 0;
+  uint64_t receivedBytes = 0;
+  uint64_t expected = 0; // between the first and last each subscriber saw
+  uint64_t rejoins = 0;
+  uint64_t connectFailures = 0;
+  std::vector<uint32_t> latencyUs;
+
+  void add(Results& other)
+  {
+    published += other.published;
+    publishedBytes += other.publishedBytes;
+    received += other.received;
+    receivedBytes += other.receivedBytes;
+    expected += other.expected;
+    rejoins += other.rejoins;
+    connectFailures += other.connectFailures;
+    latencyUs.insert(
+      latencyUs.end(), other.latencyUs.begin(), other.latencyUs.end());
+  }
+};
+
+struct Publisher
+{
+  std::unique_ptr<QuicRClient> client;
+  ShortName name;
+  timepoint next;
+};
+
+struct Subscriber
+{
+  std::unique_ptr<QuicRClient> client;
+  uint32_t clientId;
+  ShortName name;
+  bool subscribed = false;
+  timepoint deadline; // to be ready by
+
+  // this session, objects from one publisher
+  bool any = false;
+  uint32_t first = 0;
+  uint32_t last = 0;
+};
+
+static int64_t
+nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+static bool
+setOption(LoadConfig& load, const std::string& key, const std::string& value)
+{
+  if (key == "config") {
+    load.config = value;
+    return true;
+  }
+  if (key == "results") {
+    load.results = value;
+    return true;
+  }
+
+  uint32_t* field = nullptr;
+  if (key == "publishers") {
+    field = &load.publishers;
+  } else if (key == "fanOut") {
+    field = &load.fanOut;
+  } else if (key == "objectBytes") {
+    field = &load.objectBytes;
+  } else if (key == "fps") {
+    field = &load.fps;
+  } else if (key == "seconds") {
+    field = &load.seconds;
+  } else if (key == "churnPerSecond") {
+    field = &load.churnPerSecond;
+  } else if (key == "threads") {
+    field = &load.threads;
+  } else if (key == "resourceId") {
+    field = &load.resourceId;
+  } else if (key == "relayPid") {
+    field = &load.relayPid;
+  } else {
+    return false;
+  }
+
+  try {
+    size_t used = 0;
+    unsigned long num = std::stoul(value, &used);
+    if (used != value.size() || num > UINT32_MAX) {
+      return false;
+    }
+    *field = uint32_t(num);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+// user plus system time, of this process or pid, in microseconds
+static uint64_t
+cpuUs(uint32_t pid = 0)
+{
+#if defined(__linux__) || defined(__APPLE__)
+  if (pid == 0) {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return uint64_t(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+  }
+#endif
+#if defined(__linux__)
+  // utime and stime are fields 14 and 15, after the parenthesised name
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (!std::getline(stat, line) || line.rfind(')') == std::string::npos) {
+    return 0;
+  }
+  std::istringstream fields(line.substr(line.rfind(')') + 2));
+  std::string field;
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  for (int i = 3; i <= 15 && fields >> field; i++) {
+    if (i == 14) {
+      utime = std::stoull(field);
+    } else if (i == 15) {
+      stime = std::stoull(field);
+    }
+  }
+  return (utime + stime) * 1000000 / uint64_t(sysconf(_SC_CLK_TCK));
+#else
+  (void)pid;
+  return 0;
+#endif
+}
+
+static std::unique_ptr<QuicRClient>
+openClient(const ClientConfig& config,
+           const std::string& relayName,
+           uint16_t relayPort,
+           uint32_t clientId)
+{
+  auto client = std::make_unique<QuicRClient>(config);
+  client->setCryptoKey(1, sframe::bytes(8, uint8_t(1)));
+  if (!client->open(clientId, relayName, relayPort, 1)) {
+    return std::unique_ptr<QuicRClient>(nullptr);
+  }
+  return client;
+}
+
+///
+/// Driver
+///
+
+// runs its share of the clients on one thread until end
+class Driver
+{
+public:
+  Driver(const LoadConfig& load,
+         const ClientConfig& config,
+         const std::string& relayName,
+         uint16_t relayPort)
+    : load(load)
+    , config(config)
+    , relayName(relayName)
+    , relayPort(relayPort)
+    , rng(std::random_device()())
+  {}
+
+  void run(timepoint start, timepoint end)
+  {
+    auto interval = std::chrono::nanoseconds(1000000000 / load.fps);
+    for (size_t i = 0; i < publishers.size(); i++) {
+      // spread over the frame so they do not all send at once
+      publishers[i].next = start + interval * i / publishers.size();
+    }
+
+    double churnPerSecond =
+      subscribers.empty() ? 0.0 : double(load.churnPerSecond) * share;
+    auto nextChurn = start;
+    std::vector<uint8_t> payload(std::max<uint32_t>(load.objectBytes, 8));
+
+    auto now = std::chrono::steady_clock::now();
+    while (now < end) {
+      auto wake = now + std::chrono::milliseconds(1);
+
+      for (auto& publisher : publishers) {
+        if (publisher.next <= now) {
+          publish(publisher, payload);
+          publisher.next += interval;
+        }
+        while (publisher.client->recv()) {
+          // acks
+        }
+        wake = std::min(wake, publisher.next);
+      }
+
+      for (auto& subscriber : subscribers) {
+        receive(subscriber, now);
+      }
+
+      if (churnPerSecond > 0 && nextChurn <= now) {
+        std::uniform_int_distribution<size_t> pick(0, subscribers.size() - 1);
+        rejoin(subscribers[pick(rng)], now);
+        results.rejoins++;
+        std::exponential_distribution<double> gap(churnPerSecond);
+        nextChurn = now + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::duration<double>(gap(rng)));
+      }
+
+      std::this_thread::sleep_until(wake);
+      now = std::chrono::steady_clock::now();
+    }
+
+    for (auto& subscriber : subscribers) {
+      endSession(subscriber);
+    }
+  }
+
+  const LoadConfig& load;
+  const ClientConfig& config;
+  const std::string& relayName;
+  uint16_t relayPort;
+  double share = 0.0; // of the subscribers this driver has
+
+  std::vector<Publisher> publishers;
+  std::vector<Subscriber> subscribers;
+  Results results;
+
+private:
+  void publish(Publisher& publisher, std::vector<uint8_t>& payload)
+  {
+    publisher.name.mediaTime++;
+    int64_t sent = nowNs();
+    std::memcpy(payload.data(), &sent, sizeof(sent));
+
+    auto packet = publisher.client->createPacket(publisher.name,
+                                                 int(payload.size()));
+    packet->push_back(payload);
+    packet->setFEC(false);
+    packet->setReliable(false);
+    packet->setPriority(3);
+    if (publisher.client->publish(std::move(packet))) {
+      results.published++;
+      results.publishedBytes += payload.size();
+    }
+  }
+
+  void receive(Subscriber& subscriber, timepoint now)
+  {
+    if (!subscriber.subscribed) {
+      if (subscriber.client && subscriber.client->ready()) {
+        subscriber.subscribed = subscriber.client->subscribe(subscriber.name);
+      } else if (now > subscriber.deadline) {
+        results.connectFailures++;
+        rejoin(subscriber, now);
+      }
+      return;
+    }
+
+    while (auto packet = subscriber.client->recv()) {
+      if (packet->size() < sizeof(int64_t) ||
+          packet->shortName().senderID != subscriber.name.senderID) {
+        continue;
+      }
+      int64_t sent = 0;
+      std::memcpy(&sent, &packet->data(), sizeof(sent));
+      results.latencyUs.push_back(
+        uint32_t(std::max<int64_t>(nowNs() - sent, 0) / 1000));
+      results.received++;
+      results.receivedBytes += packet->size();
+
+      uint32_t seq = packet->shortName().mediaTime;
+      if (!subscriber.any) {
+        subscriber.any = true;
+        subscriber.first = seq;
+        subscriber.last = seq;
+      }
+      subscriber.first = std::min(subscriber.first, seq);
+      subscriber.last = std::max(subscriber.last, seq);
+    }
+  }
+
+  void endSession(Subscriber& subscriber)
+  {
+    if (subscriber.any) {
+      results.expected += subscriber.last - subscriber.first + 1;
+    }
+    subscriber.any = false;
+  }
+
+  void rejoin(Subscriber& subscriber, timepoint now)
+  {
+    endSession(subscriber);
+    subscriber.client.reset();
+    subscriber.client =
+      openClient(config, relayName, relayPort, subscriber.clientId);
+    subscriber.subscribed = false;
+    subscriber.deadline = now + std::chrono::seconds(5);
+  }
+
+  std::mt19937 rng;
+};
+
+///
+/// Report
+///
+
+static uint32_t
+percentile(const std::vector<uint32_t>& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto index = size_t(p / 100.0 * double(sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void
+writeJson(std::ostream& out,
+          const LoadConfig& load,
+          const Results& results,
+          double seconds,
+          uint64_t clientCpuUs,
+          uint64_t relayCpuUs)
+{
+  const auto& latency = results.latencyUs;
+  double loss = results.expected == 0
+                  ? 0.0
+                  : std::max(0.0,
+                             1.0 - double(results.received) /
+                                     double(results.expected));
+
+  out << "{\n"
+      << "  \"publishers\": " << load.publishers << ",\n"
+      << "  \"subscribers\": " << load.publishers * load.fanOut << ",\n"
+      << "  \"objectBytes\": " << load.objectBytes << ",\n"
+      << "  \"fps\": " << load.fps << ",\n"
+      << "  \"churnPerSecond\": " << load.churnPerSecond << ",\n"
+      << "  \"seconds\": " << seconds << ",\n"
+      << "  \"published\": " << results.published << ",\n"
+      << "  \"received\": " << results.received << ",\n"
+      << "  \"receivedPerSecond\": " << double(results.received) / seconds
+      << ",\n"
+      << "  \"receivedBps\": "
+      << double(results.receivedBytes) * 8 / seconds << ",\n"
+      << "  \"loss\": " << loss << ",\n"
+      << "  \"rejoins\": " << results.rejoins << ",\n"
+      << "  \"connectFailures\": " << results.connectFailures << ",\n"
+      << "  \"latencyUs\": { \"p50\": " << percentile(latency, 50)
+      << ", \"p90\": " << percentile(latency, 90)
+      << ", \"p99\": " << percentile(latency, 99)
+      << ", \"p999\": " << percentile(latency, 99.9)
+      << ", \"max\": " << (latency.empty() ? 0 : latency.back()) << " },\n"
+      << "  \"clientCpuUsPerObject\": "
+      << double(clientCpuUs) /
+           double(std::max<uint64_t>(results.published + results.received, 1))
+      << ",\n"
+      << "  \"relayCpuUsPerObject\": "
+      << double(relayCpuUs) / double(std::max<uint64_t>(results.received, 1))
+      << "\n"
+      << "}" << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <hostname> [key=value ...]"
+              << std::endl;
+    std::cerr << "\tpublishers=10 fanOut=1 objectBytes=500 fps=30 seconds=10"
+              << std::endl;
+    std::cerr << "\tchurnPerSecond=0 threads=4 resourceId=1234 relayPid=0"
+              << std::endl;
+    std::cerr << "\tconfig=<client config> results=<json file, - for stdout>"
+              << std::endl;
+    return -1;
+  }
+  std::string relayName(argv[1]);
+
+  LoadConfig load;
+  for (int i = 2; i < argc; i++) {
+    std::string arg(argv[i]);
+    auto equals = arg.find('=');
+    if (equals == std::string::npos ||
+        !setOption(load, arg.substr(0, equals), arg.substr(equals + 1))) {
+      std::cerr << "bad option " << arg << std::endl;
+      return -1;
+    }
+  }
+  if (load.publishers == 0 || load.fps == 0 || load.threads == 0 ||
+      load.seconds == 0) {
+    std::cerr << "publishers, fps, threads and seconds must not be 0"
+              << std::endl;
+    return -1;
+  }
+
+  ClientConfig config;
+  RelayConfig relay;
+  if (!load.config.empty() && !loadConfig(load.config, config, relay)) {
+    return -1;
+  }
+
+  // clients are dealt out to the drivers in turn
+  std::vector<std::unique_ptr<Driver>> drivers;
+  for (uint32_t i = 0; i < load.threads; i++) {
+    drivers.push_back(
+      std::make_unique<Driver>(load, config, relayName, relay.relayPort));
+  }
+
+  uint32_t numSubscribers = load.publishers * load.fanOut;
+  uint32_t clientId = 1;
+  for (uint32_t i = 0; i < numSubscribers; i++) {
+    Subscriber subscriber;
+    subscriber.clientId = load.publishers + 1 + i;
+    subscriber.name = ShortName(load.resourceId, 1 + i % load.publishers);
+    subscriber.client =
+      openClient(config, relayName, relay.relayPort, subscriber.clientId);
+    subscriber.deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    drivers[i % load.threads]->subscribers.push_back(std::move(subscriber));
+  }
+  for (auto& driver : drivers) {
+    driver->share = double(driver->subscribers.size()) / numSubscribers;
+  }
+
+  for (uint32_t i = 0; i < load.publishers; i++) {
+    Publisher publisher;
+    publisher.name = ShortName(load.resourceId, clientId++, 1);
+    publisher.name.mediaTime = 0;
+    publisher.client = openClient(
+      config, relayName, relay.relayPort, publisher.name.senderID);
+    if (!publisher.client) {
+      std::cerr << "can not open publisher " << i
+                << ", is the open file limit high enough?" << std::endl;
+      return -1;
+    }
+    drivers[i % load.threads]->publishers.push_back(std::move(publisher));
+  }
+
+  // publishers have to be connected before the clock starts
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  for (auto& driver : drivers) {
+    for (auto& publisher : driver->publishers) {
+      while (!publisher.client->ready() &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (!publisher.client->ready()) {
+        std::cerr << "publisher " << publisher.name << " did not connect"
+                  << std::endl;
+        return -1;
+      }
+    }
+  }
+  std::clog << load.publishers << " publishers and " << numSubscribers
+            << " subscribers open" << std::endl;
+
+  // a second for the subscriptions to land before counting
+  auto start = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  auto end = start + std::chrono::seconds(load.seconds);
+  uint64_t clientCpuStart = cpuUs();
+  uint64_t relayCpuStart = load.relayPid ? cpuUs(load.relayPid) : 0;
+
+  std::vector<std::thread> threads;
+  for (auto& driver : drivers) {
+    threads.emplace_back([&driver, start, end]() { driver->run(start, end); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  double seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  uint64_t clientCpu = cpuUs() - clientCpuStart;
+  uint64_t relayCpu = load.relayPid ? cpuUs(load.relayPid) - relayCpuStart : 0;
+
+  Results results;
+  for (auto& driver : drivers) {
+    results.add(driver->results);
+  }
+  std::sort(results.latencyUs.begin(), results.latencyUs.end());
+
+  if (load.results == "-") {
+    writeJson(std::cout, load, results, seconds, clientCpu, relayCpu);
+  } else {
+    writeJson(std::clog, load, results, seconds, clientCpu, relayCpu);
+    if (!load.results.empty()) {
+      std::ofstream file(load.results);
+      writeJson(file, load, results, seconds, clientCpu, relayCpu);
+      if (!file) {
+        std::cerr << "can not write " << load.results << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
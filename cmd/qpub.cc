@@ -13,13 +13,32 @@
 
 using namespace MediaNet;
 
+// stands in for a media encoder: writes a frame of up to size bytes to
+// out and returns how many it wrote, the marker byte, the frame number
+// and then a pattern a subscriber could check
+static size_t
+encodeFrame(uint8_t* out, size_t size, uint32_t frame)
+{
+  size_t used = 0;
+  out[used++] = 1;
+  for (int shift = 24; shift >= 0 && used < size; shift -= 8) {
+    out[used++] = uint8_t(frame >> shift);
+  }
+  while (used < size) {
+    out[used] = uint8_t(frame + used);
+    used++;
+  }
+  return used;
+}
+
 int
 main(int argc, char* argv[])
 {
   std::string relayName("localhost");
 
   if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " <hostname> <shortname>" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " <hostname> <shortname> [config]"
+              << std::endl;
     std::cerr << "\t<shortname>: qr://<resourceId>/<senderId>/<sourceId>/"
               << std::endl;
     std::cerr << "\t Example: qr://1234/12/1/" << std::endl;
@@ -28,9 +47,15 @@ main(int argc, char* argv[])
     return -1;
   }
 
-  QuicRClient qClient;
+  ClientConfig config;
+  RelayConfig relay;
+  if (argc > 3 && !loadConfig(argv[3], config, relay)) {
+    return -1;
+  }
+
+  QuicRClient qClient(config);
   qClient.setCryptoKey(1, sframe::bytes(8, uint8_t(1)));
-  qClient.open(1, relayName, 5004, 1);
+  qClient.open(1, relayName, relay.relayPort, 1);
 
   while (!qClient.ready()) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -84,10 +109,11 @@ main(int argc, char* argv[])
     auto packet = qClient.createPacket(name, 1200);
 
     assert(bytesPerPacket - transportHeaderBytes >= 1);
-    packet->resize(bytesPerPacket - transportHeaderBytes);
+    size_t payloadSize = bytesPerPacket - transportHeaderBytes;
 
-    uint8_t* buffer = &(packet->data());
-    *buffer++ = 1;
+    // encode straight into the packet, then keep what was written
+    uint8_t* buffer = packet->acquire(1200 - transportHeaderBytes);
+    packet->commit(encodeFrame(buffer, payloadSize, uint32_t(packetCount)));
 
     packet->setFEC(false);
     packet->setReliable(false);
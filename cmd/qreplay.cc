@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../src/encode.hh"
+#include <quicr/packetCapture.hh>
+
+using namespace MediaNet;
+using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+// Replays the client side of a relay capture, see PacketCapture, into a
+// relay. Each datagram the capture has going to port is sent from a
+// socket of its own per captured client, at the captured spacing divided
+// by speed, so the relay sees the same clients, mix and timing as it did
+// in production. The relay's cookies differ from the captured ones, so a
+// reset with a retry cookie is answered by sending the client's last sync
+// again with the new cookie. What the relay sends back is only counted.
+
+struct ReplayConfig
+{
+  uint32_t port = 5004; // the relay port in the capture and to replay to
+  double speed = 1.0;   // 0 sends as fast as it can
+  uint32_t loops = 1;
+  std::string results; // JSON results file, - is stdout
+};
+
+struct Results
+{
+  uint64_t replayed = 0;
+  uint64_t replayedBytes = 0;
+  uint64_t skipped = 0; // from the relay, or to other ports
+  uint64_t resynced = 0;
+  uint64_t received = 0;
+  uint64_t receivedBytes = 0;
+  int64_t lateMaxUs = 0; // behind the captured spacing
+  int64_t lateSumUs = 0;
+};
+
+// one captured client
+struct Face
+{
+  int fd = -1;
+  std::vector<uint8_t> lastSync;
+};
+
+static bool
+setOption(ReplayConfig& replay,
+          const std::string& key,
+          const std::string& value)
+{
+  try {
+    size_t used = 0;
+    if (key == "results") {
+      replay.results = value;
+      return true;
+    }
+    if (key == "speed") {
+      replay.speed = std::stod(value, &used);
+      return used == value.size() && replay.speed >= 0;
+    }
+
+    unsigned long num = std::stoul(value, &used);
+    if (used != value.size() || num > UINT32_MAX) {
+      return false;
+    }
+    if (key == "port") {
+      replay.port = uint32_t(num);
+      return num > 0 && num <= 0xffff;
+    }
+    if (key == "loops") {
+      replay.loops = uint32_t(num);
+      return true;
+    }
+    return false;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+static bool
+resolve(const std::string& host, uint32_t port, IpAddr& relay)
+{
+  struct addrinfo hints = {}, *found = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) !=
+        0 ||
+      !found) {
+    return false;
+  }
+  std::memcpy(&relay.addr, found->ai_addr, sizeof(relay.addr));
+  relay.addrLen = sizeof(relay.addr);
+  freeaddrinfo(found);
+  return true;
+}
+
+///
+/// Replayer
+///
+
+class Replayer
+{
+public:
+  Replayer(const ReplayConfig& replay, const IpAddr& relay)
+    : replay(replay)
+    , relay(relay)
+  {}
+
+  ~Replayer()
+  {
+    for (auto& face : faces) {
+      ::close(face.second.fd);
+    }
+  }
+
+  // one pass over the capture, false if it can not be read
+  bool run(const std::string& path)
+  {
+    CaptureReader reader(path);
+    if (!reader.ok()) {
+      return false;
+    }
+
+    CapturedPacket captured;
+    bool first = true;
+    std::chrono::nanoseconds captureStart{};
+    auto start = std::chrono::steady_clock::now();
+    while (reader.next(captured)) {
+      if (ntohs(captured.dst.addr.sin_port) != replay.port) {
+        results.skipped++;
+        continue;
+      }
+      if (first) {
+        captureStart = captured.time;
+        first = false;
+      }
+
+      Face& face = faceFor(captured.src);
+      if (face.fd < 0) {
+        return false;
+      }
+
+      if (replay.speed > 0) {
+        auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          (captured.time - captureStart) / replay.speed);
+        waitUntil(start + offset);
+      } else if (results.replayed % 64 == 0) {
+        drain(0);
+      }
+
+      if (isSync(captured.data)) {
+        face.lastSync = captured.data;
+      }
+      send(face, captured.data);
+    }
+
+    // what the relay still has to say
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < end) {
+      drain(10);
+    }
+    return true;
+  }
+
+  [[nodiscard]] size_t faceCount() const { return faces.size(); }
+
+  Results results;
+
+private:
+  Face& faceFor(const IpAddr& captured)
+  {
+    auto found = faces.find(captured);
+    if (found != faces.end()) {
+      return found->second;
+    }
+
+    Face& face = faces[captured];
+    face.fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (face.fd < 0) {
+      std::cerr << "can not open a socket for "
+                << IpAddr::toString(captured)
+                << ", is the open file limit high enough?" << std::endl;
+      return face;
+    }
+    fcntl(face.fd, F_SETFL, fcntl(face.fd, F_GETFL) | O_NONBLOCK);
+
+    struct sockaddr_in any
+    {};
+    any.sin_family = AF_INET;
+    any.sin_addr.s_addr = htonl(INADDR_ANY);
+    bind(face.fd, (struct sockaddr*)&any, sizeof(any));
+
+    pollFds.push_back(pollfd{ face.fd, POLLIN, 0 });
+    pollFaces.push_back(&face);
+    return face;
+  }
+
+  static bool isSync(const std::vector<uint8_t>& data)
+  {
+    return !data.empty() && data.back() == packetTagTrunc(PacketTag::sync);
+  }
+
+  void send(Face& face, const std::vector<uint8_t>& data)
+  {
+    auto sent = sendto(face.fd,
+                       data.data(),
+                       data.size(),
+                       0,
+                       (const struct sockaddr*)&relay.addr,
+                       relay.addrLen);
+    if (sent == ssize_t(data.size())) {
+      results.replayed++;
+      results.replayedBytes += data.size();
+    }
+  }
+
+  // drains replies while waiting, then sleeps out the last ms
+  void waitUntil(timepoint due)
+  {
+    auto now = std::chrono::steady_clock::now();
+    while (due - now > std::chrono::milliseconds(1)) {
+      drain(int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                  due - now)
+                  .count()));
+      now = std::chrono::steady_clock::now();
+    }
+    if (now < due) {
+      std::this_thread::sleep_until(due);
+      now = std::chrono::steady_clock::now();
+    }
+    drain(0);
+
+    auto lateUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - due).count();
+    results.lateMaxUs = std::max<int64_t>(results.lateMaxUs, lateUs);
+    results.lateSumUs += lateUs;
+  }
+
+  // reads what the relay sent back, waiting up to timeoutMs for the first
+  void drain(int timeoutMs)
+  {
+    if (pollFds.empty() || poll(pollFds.data(), pollFds.size(), timeoutMs) <= 0) {
+      return;
+    }
+
+    for (size_t i = 0; i < pollFds.size(); i++) {
+      if (!(pollFds[i].revents & POLLIN)) {
+        continue;
+      }
+      Face& face = *pollFaces[i];
+      while (true) {
+        auto packet = std::make_unique<Packet>();
+        packet->resizeFull(1500);
+        auto length = recv(face.fd, &packet->fullData(), 1500, 0);
+        if (length <= 0) {
+          break;
+        }
+        packet->resizeFull(int(length));
+        results.received++;
+        results.receivedBytes += uint64_t(length);
+
+        if (nextTag(packet) == PacketTag::resetRetry && !face.lastSync.empty()) {
+          NetResetRetry retry{};
+          if (packet >> retry) {
+            resync(face, retry.cookie);
+          }
+        }
+      }
+    }
+  }
+
+  // the last captured sync, with the cookie this relay handed out
+  void resync(Face& face, uint32_t cookie)
+  {
+    auto sync = std::make_unique<Packet>();
+    sync->resizeFull(int(face.lastSync.size()));
+    std::memcpy(&sync->fullData(), face.lastSync.data(), face.lastSync.size());
+
+    NetSyncReq request{};
+    if (!(sync >> request)) {
+      return;
+    }
+    request.cookie = cookie;
+    sync << request;
+
+    send(face, std::vector<uint8_t>(&sync->fullData(),
+                                    &sync->fullData() + sync->fullSize()));
+    results.resynced++;
+  }
+
+  const ReplayConfig& replay;
+  const IpAddr relay;
+
+  std::map<IpAddr, Face> faces; // by captured address
+  std::vector<pollfd> pollFds;
+  std::vector<Face*> pollFaces; // per pollFds entry
+};
+
+static void
+report(const ReplayConfig& replay,
+       const Results& results,
+       size_t faces,
+       double seconds)
+{
+  std::ofstream file;
+  if (!replay.results.empty() && replay.results != "-") {
+    file.open(replay.results);
+  }
+  std::ostream& out = file.is_open() ? file : std::cout;
+
+  out << "{\n"
+      << "  \"speed\": " << replay.speed << ",\n"
+      << "  \"loops\": " << replay.loops << ",\n"
+      << "  \"faces\": " << faces << ",\n"
+      << "  \"seconds\": " << seconds << ",\n"
+      << "  \"replayed\": " << results.replayed << ",\n"
+      << "  \"replayedPerSecond\": " << double(results.replayed) / seconds
+      << ",\n"
+      << "  \"replayedBps\": " << double(results.replayedBytes) * 8 / seconds
+      << ",\n"
+      << "  \"skipped\": " << results.skipped << ",\n"
+      << "  \"resynced\": " << results.resynced << ",\n"
+      << "  \"received\": " << results.received << ",\n"
+      << "  \"receivedBytes\": " << results.receivedBytes << ",\n"
+      << "  \"lateUs\": { \"mean\": "
+      << double(results.lateSumUs) /
+           double(std::max<uint64_t>(results.replayed, 1))
+      << ", \"max\": " << results.lateMaxUs << " }\n"
+      << "}" << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <capture> <hostname> [key=value ...]" << std::endl;
+    std::cerr << "\tport=5004 speed=1 (0 is as fast as it can) loops=1"
+              << std::endl;
+    std::cerr << "\tresults=<json file, - for stdout>" << std::endl;
+    return -1;
+  }
+  std::string path(argv[1]);
+  std::string relayName(argv[2]);
+
+  ReplayConfig replay;
+  for (int i = 3; i < argc; i++) {
+    std::string arg(argv[i]);
+    auto equals = arg.find('=');
+    if (equals == std::string::npos ||
+        !setOption(replay, arg.substr(0, equals), arg.substr(equals + 1))) {
+      std::cerr << "bad option " << arg << std::endl;
+      return -1;
+    }
+  }
+
+  IpAddr relay{};
+  if (!resolve(relayName, replay.port, relay)) {
+    std::cerr << "can not resolve " << relayName << std::endl;
+    return -1;
+  }
+
+  Replayer replayer(replay, relay);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < replay.loops; i++) {
+    if (!replayer.run(path)) {
+      std::cerr << "can not replay " << path << std::endl;
+      return -1;
+    }
+  }
+  double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count();
+
+  report(replay, replayer.results, replayer.faceCount(), seconds);
+  return 0;
+}
@@ -15,15 +15,22 @@ main(int argc, char* argv[])
 {
   std::string relayName("localhost");
 
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <hostname>" << std::endl;
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <hostname> [config]" << std::endl;
     return -1;
   }
   relayName = std::string(argv[1]);
 
-  QuicRClient qClient;
+  ClientConfig config;
+  RelayConfig relay;
+  bool haveConfig = argc == 3;
+  if (haveConfig && !loadConfig(argv[2], config, relay)) {
+    return -1;
+  }
+
+  QuicRClient qClient(config);
   qClient.setCryptoKey(1, sframe::bytes(8, uint8_t(1)));
-  qClient.open(1, relayName, 5004, 1);
+  qClient.open(1, relayName, relay.relayPort, 1);
 
   while (!qClient.ready()) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -36,9 +43,12 @@ main(int argc, char* argv[])
   const int timeToSendUpSeconds = 30;
   const int packetsUpPerSecond = 60;
 
-  qClient.setBitrateUp(1e6, 3e6, 4e6);
-  qClient.setRttEstimate(50);
-  qClient.setPacketsUp(500, 240);
+  // a config file gives the starting packet rate, MTU and RTT instead
+  if (!haveConfig) {
+    qClient.setBitrateUp(1e6, 3e6, 4e6);
+    qClient.setRttEstimate(50);
+    qClient.setPacketsUp(500, 240);
+  }
 
   const int packetSizeByes =
     100; // TODO FIX (maxSpeedUpBps / packetsUpPerSecond) / 8;
@@ -99,5 +109,9 @@ main(int argc, char* argv[])
 
   } while (true);
 
+#if defined(QUICR_TRACING)
+  TraceRecorder::global().dumpText(std::clog);
+#endif
+
   return 0;
 }
@@ -13,7 +13,8 @@ main(int argc, char* argv[])
   std::string relayName("localhost");
 
   if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " <hostname> <shortname>" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " <hostname> <shortname> [config]"
+              << std::endl;
     std::cerr << "<shortname>: qr://<resourceId>/<senderId>/<sourceId>;"
               << std::endl;
     std::cerr << "resourceId, senderId, sourceId, mediaTime are integers."
@@ -30,9 +31,15 @@ main(int argc, char* argv[])
   auto shortName = ShortName::fromString(argv[2]);
 
   std::cout << "Subscribing to ->" << shortName << std::endl;
-  QuicRClient qClient;
+  ClientConfig config;
+  RelayConfig relay;
+  if (argc > 3 && !loadConfig(argv[3], config, relay)) {
+    return -1;
+  }
+
+  QuicRClient qClient(config);
   qClient.setCryptoKey(1, sframe::bytes(8, uint8_t(1)));
-  qClient.open(1, relayName, 5004, 1);
+  qClient.open(1, relayName, relay.relayPort, 1);
 
   while (!qClient.ready()) {
     std::this_thread::sleep_for(std::chrono::milliseconds(1));
@@ -45,9 +52,8 @@ main(int argc, char* argv[])
   int numRecv = 0;
   // empty the receive queue
   do {
-    auto packet = qClient.recv();
+    auto packet = qClient.recv(std::chrono::milliseconds(10));
     if (!packet) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
       continue;
     }
     // std::clog << "QuicR received buff size=" << packet->size() << std::endl;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../../../src/encode.hh" // TODO
+
+// Collects the clientSeqNums received from one client so they can be acked
+// with a single NetAck. The ack names the newest packet, ackVec covers the
+// 32 before it and ackDelayUs says how long the newest one waited here, so
+// the client can still take an RTT sample from it.
+class AckAggregator
+{
+public:
+  AckAggregator();
+
+  void recv(uint32_t clientSeqNum, uint32_t nowUs);
+
+  [[nodiscard]] bool pending() const { return pendingCount > 0; }
+  // enough packets or enough time since the first unacked one
+  [[nodiscard]] bool due(uint32_t nowUs) const;
+
+  // older packets stay in the vector so a lost ack is covered by the next
+  MediaNet::NetAck flush(uint32_t nowUs);
+
+  // share of clientSeqNums missing since the last call, in parts per
+  // million. Late packets count as received.
+  uint32_t takeLossPerMillion();
+
+  uint32_t pathToken; // from the last packet received
+  bool active;        // on the relay list of aggregators with acks pending
+
+private:
+  static constexpr uint32_t maxPending = 16;
+  static constexpr uint32_t maxDelayUs = 10 * 1000;
+
+  bool haveSeqNum;
+  uint32_t highestSeqNum;
+  uint32_t highestRecvTimeUs;
+  uint32_t ackVec; // bit i set when highestSeqNum-1-i was received
+
+  uint32_t pendingCount;
+  uint32_t firstPendingUs;
+
+  uint64_t expectedCount;
+  uint64_t receivedCount;
+};
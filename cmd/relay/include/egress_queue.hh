@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "quicr/packet.hh"
+
+// Per subscriber queue of data waiting to leave the relay. Packets are
+// released no faster than the rate the subscriber asked for with NetRateReq,
+// highest priority first as PriorityPipe sends them, and once the queue
+// holds more than maxQueueDelayMs worth of data, the oldest packets of the
+// lowest priority are dropped first.
+class EgressQueue
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  EgressQueue(uint32_t relaySeq, const timepoint& now);
+
+  // 0 turns shaping off
+  void setRate(uint64_t bitsPerSecond);
+  [[nodiscard]] uint64_t getRate() const { return rateBps; }
+
+  void push(std::unique_ptr<MediaNet::Packet> packet);
+
+  // returns nullptr when empty or when the rate does not allow a send yet
+  std::unique_ptr<MediaNet::Packet> pop(const timepoint& now);
+
+  // when the rate next allows a send, now if it already does
+  [[nodiscard]] timepoint nextSendTime(const timepoint& now) const;
+
+  [[nodiscard]] bool empty() const { return queuedPackets == 0; }
+  [[nodiscard]] size_t size() const { return queuedPackets; }
+  [[nodiscard]] size_t bytes() const { return queuedBytes; }
+  [[nodiscard]] uint64_t getDropCount() const { return dropCount; }
+
+  uint32_t relaySeqNum;
+  bool active; // on the relay list of queues with data
+
+private:
+  static constexpr int numPriority = 6;       // priority 5 and above share
+  static constexpr uint64_t minRateBps = 100 * 1000;
+  static constexpr uint32_t maxQueueDelayMs = 250;
+  static constexpr uint32_t maxBurstMs = 20;
+  static constexpr size_t minQueueBytes = 64 * 1024;
+  static constexpr size_t maxQueuePackets = 1000;
+
+  void refill(const timepoint& now);
+  void dropLeastImportant();
+  [[nodiscard]] size_t byteLimit() const;
+
+  std::array<std::deque<std::unique_ptr<MediaNet::Packet>>, numPriority> queues;
+  size_t queuedPackets;
+  size_t queuedBytes;
+
+  uint64_t rateBps;
+  int64_t tokenBits;
+  timepoint lastRefill;
+
+  uint64_t dropCount;
+};
@@ -11,7 +11,6 @@ struct SubscriberInfo
 {
   MediaNet::ShortName name;
   Face face{};
-  uint32_t relaySeqNum;
 };
 
 class Fib
@@ -25,6 +24,8 @@ public:
     const SubscriberInfo& subscriberInfo) = 0;
   [[nodiscard]] virtual std::list<SubscriberInfo> lookupSubscription(
     const MediaNet::ShortName& name) const = 0;
+  // number of subscriptions held
+  [[nodiscard]] virtual size_t size() const = 0;
 
   virtual ~Fib() = default;
 };
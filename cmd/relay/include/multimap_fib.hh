@@ -16,6 +16,7 @@ public:
     const SubscriberInfo& subscriberInfo) override;
   virtual std::list<SubscriberInfo> lookupSubscription(
     const MediaNet::ShortName& name) const override;
+  size_t size() const override { return fibStore.size(); }
 
 private:
   std::multimap<MediaNet::ShortName, SubscriberInfo> fibStore;
@@ -5,10 +5,16 @@
 #include <map>
 #include <memory>
 #include <random>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "../../../src/encode.hh" // TODO
 
+#include "ack_aggregator.hh"
+#include "egress_queue.hh"
 #include "fib.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
 #include "quicr/quicRServer.hh"
 
@@ -16,25 +22,80 @@ class Relay
 {
 
 public:
-  explicit Relay(uint16_t port);
+  // with capturePath set, records its traffic, see QuicRServer::startCapture
+  explicit Relay(uint16_t port,
+                 const std::string& capturePath = std::string(),
+                 uint64_t captureFileBytes = 0);
+  // on network instead of UDP, see LoopbackNetwork
+  Relay(MediaNet::LoopbackNetwork& network, uint16_t port);
   void process();
   void stop();
 
+  // subscriptions held for all faces
+  [[nodiscard]] size_t subscriptionCount() const { return fib->size(); }
+
+  // adds the latest per face samples, for a MetricsExporter collector.
+  // Safe from the exporter thread while process() runs.
+  void collectMetrics(std::vector<MediaNet::MetricsRegistry::Sample>& samples);
+
 private:
+  Relay(std::unique_ptr<MediaNet::QuicRServer> server,
+        uint16_t port,
+        const std::string& capturePath,
+        uint64_t captureFileBytes);
+
   void processAppMessage(std::unique_ptr<MediaNet::Packet>& packet);
   void processRateRequest(std::unique_ptr<MediaNet::Packet>& packet);
   void processSub(std::unique_ptr<MediaNet::Packet>& packet,
                   MediaNet::ClientData& clientSeqNum);
   void processPub(std::unique_ptr<MediaNet::Packet>& packet,
                   MediaNet::ClientData& clientSeqNum);
+  void processEgress();
+  void processAcks();
+  void processClosed(const Face& face);
+
+  void recordAck(std::unique_ptr<MediaNet::Packet>& packet,
+                 uint32_t clientSeqNum,
+                 uint32_t nowUs);
+  void sendAck(const Face& face, AckAggregator& aggregator, uint32_t nowUs);
+
+  EgressQueue& egressQueue(const Face& face);
 
-  uint32_t prevAckSeqNum = 0;
-  uint32_t prevRecvTimeUs = 0;
+  struct FaceStats
+  {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t reportedIn = 0; // at the last updateMetrics()
+    uint64_t reportedOut = 0;
+  };
+  void updateMetrics(const std::chrono::steady_clock::time_point& now);
 
-  MediaNet::QuicRServer qServer;
+  std::unique_ptr<MediaNet::QuicRServer> qServer;
   std::unique_ptr<Fib> fib;
+  // to drop the subscriptions of a face when its connection closes
+  std::map<Face, std::set<MediaNet::ShortName>> subscriptionsByFace;
+
+  std::map<Face, std::unique_ptr<EgressQueue>> egressQueues;
+  std::vector<EgressQueue*> activeQueues; // queues with data waiting
+
+  std::map<Face, AckAggregator> ackAggregators;
+  std::vector<Face> pendingAcks; // faces with acks not yet sent
 
   std::mt19937 randomGen;
   std::uniform_int_distribution<uint32_t> randomDist;
   std::function<uint32_t()> getRandom;
+
+  // rebuilt once a second by process() and read by collectMetrics()
+  std::map<Face, FaceStats> faceStats;
+  std::chrono::steady_clock::time_point lastMetrics;
+  MediaNet::TripleBuffer<std::vector<MediaNet::MetricsRegistry::Sample>>
+    faceSamples;
+
+  MediaNet::Counter& publishedCount;
+  MediaNet::Counter& publishedBytes;
+  MediaNet::Counter& forwardedCount;
+  MediaNet::Counter& egressDrops;
+  MediaNet::Histogram& fanOut;
+  MediaNet::Gauge& fibSize;
+  MediaNet::Gauge& faceCount;
 };
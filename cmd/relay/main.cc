@@ -1,15 +1,34 @@
-
 #include <iostream>
 
 #include "include/fib.hh"
 #include "include/multimap_fib.hh"
 #include "include/relay.hh"
+#include "quicr/config.hh"
+#include "quicr/metricsExporter.hh"
 
 int
-main()
+main(int argc, char* argv[])
 {
-  auto relay = Relay{ 5004 };
+  // the relay reads the same file the clients use
+  MediaNet::RelayConfig config;
+  if (argc > 1 && !MediaNet::loadRelayConfig(argv[1], config)) {
+    std::cerr << "Usage: " << argv[0] << " [config]" << std::endl;
+    return -1;
+  }
+
+  auto relay =
+    Relay{ config.relayPort, config.capture, config.captureFileBytes };
+
+  MediaNet::MetricsExporter exporter;
+  exporter.addCollector(
+    [&relay](MediaNet::MetricsExporter::Samples& samples) {
+      relay.collectMetrics(samples);
+    });
+  if (config.metricsPort != 0 && !exporter.start(config.metricsPort)) {
+    return -1;
+  }
+
   while (1) {
     relay.process();
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,92 @@
+#include "../include/ack_aggregator.hh"
+
+using namespace MediaNet;
+
+AckAggregator::AckAggregator()
+  : pathToken(0)
+  , active(false)
+  , haveSeqNum(false)
+  , highestSeqNum(0)
+  , highestRecvTimeUs(0)
+  , ackVec(0)
+  , pendingCount(0)
+  , firstPendingUs(0)
+  , expectedCount(0)
+  , receivedCount(0)
+{}
+
+void
+AckAggregator::recv(uint32_t clientSeqNum, uint32_t nowUs)
+{
+  if (pendingCount == 0) {
+    firstPendingUs = nowUs;
+  }
+  pendingCount++;
+
+  if (!haveSeqNum) {
+    haveSeqNum = true;
+    highestSeqNum = clientSeqNum;
+    highestRecvTimeUs = nowUs;
+    ackVec = 0;
+    expectedCount++;
+    receivedCount++;
+    return;
+  }
+
+  auto diff = int32_t(clientSeqNum - highestSeqNum);
+  if (diff > 0) {
+    // slide the vector up and add the previous highest to it
+    auto shift = uint32_t(diff);
+    ackVec = (shift < 32) ? (ackVec << shift) : 0;
+    if (shift <= 32) {
+      ackVec |= 1u << (shift - 1);
+    }
+    highestSeqNum = clientSeqNum;
+    highestRecvTimeUs = nowUs;
+    expectedCount += shift;
+    receivedCount++;
+  } else if (diff < 0 && diff >= -32) {
+    // reordered
+    uint32_t bit = 1u << uint32_t(-diff - 1);
+    if (!(ackVec & bit)) {
+      receivedCount++;
+    }
+    ackVec |= bit;
+  }
+}
+
+bool
+AckAggregator::due(uint32_t nowUs) const
+{
+  if (pendingCount == 0) {
+    return false;
+  }
+  return (pendingCount >= maxPending) ||
+         (nowUs - firstPendingUs >= maxDelayUs);
+}
+
+NetAck
+AckAggregator::flush(uint32_t nowUs)
+{
+  NetAck ack{};
+  ack.clientSeqNum = highestSeqNum;
+  ack.recvTimeUs = highestRecvTimeUs;
+  ack.ackVec = ackVec;
+  ack.ackDelayUs = nowUs - highestRecvTimeUs;
+
+  pendingCount = 0;
+
+  return ack;
+}
+
+uint32_t
+AckAggregator::takeLossPerMillion()
+{
+  uint32_t loss = 0;
+  if (expectedCount > receivedCount) {
+    loss = uint32_t((expectedCount - receivedCount) * 1000000 / expectedCount);
+  }
+  expectedCount = 0;
+  receivedCount = 0;
+  return loss;
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cassert>
+
+#include "../include/egress_queue.hh"
+
+using namespace MediaNet;
+
+EgressQueue::EgressQueue(uint32_t relaySeq, const timepoint& now)
+  : relaySeqNum(relaySeq)
+  , active(false)
+  , queuedPackets(0)
+  , queuedBytes(0)
+  , rateBps(0)
+  , tokenBits(0)
+  , lastRefill(now)
+  , dropCount(0)
+{}
+
+void
+EgressQueue::setRate(uint64_t bitsPerSecond)
+{
+  if (bitsPerSecond > 0 && bitsPerSecond < minRateBps) {
+    bitsPerSecond = minRateBps;
+  }
+  rateBps = bitsPerSecond;
+}
+
+void
+EgressQueue::push(std::unique_ptr<Packet> packet)
+{
+  assert(packet);
+  int priority = std::min(int(packet->getPriority()), numPriority - 1);
+
+  queuedBytes += packet->fullSize();
+  queuedPackets++;
+  queues[priority].push_back(std::move(packet));
+
+  while (queuedPackets > maxQueuePackets || queuedBytes > byteLimit()) {
+    dropLeastImportant();
+  }
+}
+
+std::unique_ptr<Packet>
+EgressQueue::pop(const timepoint& now)
+{
+  if (queuedPackets == 0) {
+    return nullptr;
+  }
+
+  if (rateBps > 0) {
+    refill(now);
+    // allowed to go into debt so a packet bigger than the bucket still goes
+    if (tokenBits <= 0) {
+      return nullptr;
+    }
+  }
+
+  // higher numbers matter more, FEC repairs at 0 go last
+  for (auto it = queues.rbegin(); it != queues.rend(); ++it) {
+    auto& queue = *it;
+    if (queue.empty()) {
+      continue;
+    }
+    auto packet = std::move(queue.front());
+    queue.pop_front();
+
+    queuedPackets--;
+    queuedBytes -= packet->fullSize();
+    if (rateBps > 0) {
+      tokenBits -= int64_t(packet->fullSize() + 42) * 8; // 42 bytes of UDP/IP
+    }
+    return packet;
+  }
+
+  assert(0);
+  return nullptr;
+}
+
+EgressQueue::timepoint
+EgressQueue::nextSendTime(const timepoint& now) const
+{
+  if (rateBps == 0) {
+    return now;
+  }
+  auto sinceRefillUs =
+    std::chrono::duration_cast<std::chrono::microseconds>(now - lastRefill)
+      .count();
+  int64_t neededBits = 1 - tokenBits;
+  if (neededBits <= 0) {
+    return now;
+  }
+  auto waitUs = neededBits * 1000000 / int64_t(rateBps) + 1 - sinceRefillUs;
+  if (waitUs <= 0) {
+    return now;
+  }
+  return now + std::chrono::microseconds(waitUs);
+}
+
+///
+/// Private Implementation
+///
+
+void
+EgressQueue::refill(const timepoint& now)
+{
+  auto elapsedUs =
+    std::chrono::duration_cast<std::chrono::microseconds>(now - lastRefill)
+      .count();
+  if (elapsedUs <= 0) {
+    return;
+  }
+  lastRefill = now;
+
+  int64_t maxTokenBits = int64_t(rateBps * maxBurstMs / 1000);
+  tokenBits += int64_t(rateBps) * elapsedUs / 1000000;
+  tokenBits = std::min(tokenBits, maxTokenBits);
+}
+
+void
+EgressQueue::dropLeastImportant()
+{
+  for (auto& queue : queues) {
+    if (queue.empty()) {
+      continue;
+    }
+    // oldest data is the least useful to a real time subscriber
+    queuedPackets--;
+    queuedBytes -= queue.front()->fullSize();
+    queue.pop_front();
+    dropCount++;
+    return;
+  }
+}
+
+size_t
+EgressQueue::byteLimit() const
+{
+  if (rateBps == 0) {
+    return SIZE_MAX;
+  }
+  size_t limit = size_t(rateBps / 8 * maxQueueDelayMs / 1000);
+  return std::max(limit, minQueueBytes);
+}
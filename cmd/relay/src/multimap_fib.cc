@@ -1,20 +1,26 @@
 
 #include <algorithm>
 #include <cassert>
-#include <iostream>
-
 #include "../include/multimap_fib.hh"
+#include "quicr/log.hh"
 
 void
 MultimapFib::addSubscription(const MediaNet::ShortName& name,
                              SubscriberInfo subscriberInfo)
 {
-  if (fibStore.count((name))) {
-    fibStore.erase(name);
+  // a face subscribing again replaces its entry, other faces keep theirs
+  auto entries = fibStore.equal_range(name);
+  auto it = std::find_if(
+    entries.first, entries.second, [&subscriberInfo](auto const& entry) {
+      return MediaNet::IpAddr::toString(entry.second.face) ==
+             MediaNet::IpAddr::toString(subscriberInfo.face);
+    });
+  if (it != entries.second) {
+    it->second = subscriberInfo;
+  } else {
+    fibStore.insert(std::make_pair(name, subscriberInfo));
   }
-
-  fibStore.insert(std::make_pair(name, subscriberInfo));
-  std::clog << name << " has " << fibStore.count(name) << " subscription \n";
+  QUICR_LOG_DEBUG("{} has {} subscriptions", name, fibStore.count(name));
 }
 
 void
@@ -32,7 +38,7 @@ MultimapFib::removeSubscription(const MediaNet::ShortName& name,
              MediaNet::IpAddr::toString(subscriberInfo.face);
     });
 
-  if (it != fibStore.end()) {
+  if (it != entries.second) {
     fibStore.erase(it);
   }
 }
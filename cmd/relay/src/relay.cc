@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <functional>
@@ -7,14 +8,68 @@
 
 #include "../include/multimap_fib.hh"
 #include "../include/relay.hh"
+#include "quicr/log.hh"
 
 using namespace MediaNet;
 
-Relay::Relay(uint16_t port)
-  : qServer()
+// when the packet arrived from the kernel's timestamp, nowUs without one
+static uint32_t
+arrivalUs(const std::unique_ptr<Packet>& packet, uint32_t nowUs)
+{
+  auto tp = packet->getWireTime();
+  if (tp.time_since_epoch().count() == 0) {
+    return nowUs;
+  }
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+           tp.time_since_epoch())
+    .count();
+}
+
+Relay::Relay(uint16_t port,
+             const std::string& capturePath,
+             uint64_t captureFileBytes)
+  : Relay(std::make_unique<QuicRServer>(), port, capturePath, captureFileBytes)
+{}
+
+Relay::Relay(LoopbackNetwork& network, uint16_t port)
+  : Relay(std::make_unique<QuicRServer>(network), port, std::string(), 0)
+{}
+
+Relay::Relay(std::unique_ptr<QuicRServer> server,
+             uint16_t port,
+             const std::string& capturePath,
+             uint64_t captureFileBytes)
+  : qServer(std::move(server))
   , fib(std::make_unique<MultimapFib>())
+  , lastMetrics(std::chrono::steady_clock::now())
+  , publishedCount(MetricsRegistry::global().counter(
+      "quicr_relay_published_total",
+      "objects received from publishers"))
+  , publishedBytes(MetricsRegistry::global().counter(
+      "quicr_relay_published_bytes_total",
+      "bytes received from publishers"))
+  , forwardedCount(MetricsRegistry::global().counter(
+      "quicr_relay_forwarded_total",
+      "packets sent on to subscribers"))
+  , egressDrops(MetricsRegistry::global().counter(
+      "quicr_relay_egress_drops_total",
+      "packets dropped from full subscriber queues"))
+  , fanOut(MetricsRegistry::global().histogram(
+      "quicr_relay_fanout",
+      "subscribers each published object goes to",
+      { 0, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 }))
+  , fibSize(MetricsRegistry::global().gauge("quicr_relay_fib_entries",
+                                            "subscriptions in the FIB"))
+  , faceCount(MetricsRegistry::global().gauge("quicr_relay_faces",
+                                              "clients the relay knows"))
 {
-  qServer.open(port);
+  if (!capturePath.empty() &&
+      !qServer->startCapture(capturePath, captureFileBytes)) {
+    QUICR_LOG_ERROR("can not capture to {}, running without", capturePath);
+  }
+  qServer->open(port);
+  qServer->setClosedCallback(
+    [this](const MediaNet::IpAddr& face) { processClosed(face); });
   std::random_device randDev;
   randomGen.seed(randDev()); // TODO - should use crypto random
   getRandom = std::bind(randomDist, randomGen);
@@ -23,23 +78,53 @@ Relay::Relay(uint16_t port)
 void
 Relay::process()
 {
-  auto packet = qServer.recv();
+  // block until something arrives, or until the first paced queue may
+  // send again; ack flushes need a look every ms
+  auto wait = pendingAcks.empty() ? std::chrono::milliseconds(10)
+                                  : std::chrono::milliseconds(1);
+  auto before = std::chrono::steady_clock::now();
+  for (auto* queue : activeQueues) {
+    auto untilSend = std::chrono::ceil<std::chrono::milliseconds>(
+      queue->nextSendTime(before) - before);
+    wait = std::min(wait, std::max(untilSend, std::chrono::milliseconds(1)));
+  }
+  auto packet = qServer->recv(wait);
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - lastMetrics >= std::chrono::seconds(1)) {
+    updateMetrics(now);
+  }
 
   if (!packet) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    processEgress();
+    processAcks();
     return;
   }
 
+  faceStats[packet->getSrc()].bytesIn += packet->fullSize();
+
   auto tag = nextTag(packet);
 
   switch (tag) {
     case PacketTag::clientData:
-      return processAppMessage(packet);
+      processAppMessage(packet);
+      break;
     case PacketTag::rate:
-      return processRateRequest(packet);
+      processRateRequest(packet);
+      break;
     default:
-      std::clog << "unknown tag :" << (int)tag << "\n";
+      QUICR_LOG_WARN("unknown tag: {}", int(tag));
   }
+
+  processEgress();
+  processAcks();
+}
+
+void
+Relay::collectMetrics(std::vector<MetricsRegistry::Sample>& samples)
+{
+  const auto& faces = faceSamples.read();
+  samples.insert(samples.end(), faces.begin(), faces.end());
 }
 
 ///
@@ -61,7 +146,7 @@ Relay::processAppMessage(std::unique_ptr<MediaNet::Packet>& packet)
     return processSub(packet, seqNumTag);
   }
 
-  std::clog << "Bad App message:" << (int)tag << "\n";
+  QUICR_LOG_WARN("bad app message: {}", int(tag));
 }
 
 /// Subscribe Request
@@ -74,24 +159,17 @@ Relay::processSub(std::unique_ptr<MediaNet::Packet>& packet,
   uint32_t nowUs =
     (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn).count();
 
-  // ack the packet
-  auto ackPacket = std::make_unique<Packet>();
-  ackPacket->setDst(packet->getSrc());
-  auto hdr = Packet::Header(PacketTag::headerData);
-  ackPacket << hdr;
-  NetAck ack{};
-  ack.clientSeqNum = clientSeqNumTag.clientSeqNum;
-  ack.recvTimeUs = nowUs;
-  ackPacket << ack;
+  recordAck(packet, clientSeqNumTag.clientSeqNum, nowUs);
 
   // save the subscription
   PacketTag tag;
   packet >> tag;
   ShortName name;
   packet >> name;
-  std::clog << "Adding Subscription for: " << name << std::endl;
-  fib->addSubscription(name,
-                       SubscriberInfo{ name, packet->getSrc(), getRandom() });
+  QUICR_LOG_INFO("adding subscription for: {}", name);
+  fib->addSubscription(name, SubscriberInfo{ name, packet->getSrc() });
+  subscriptionsByFace[packet->getSrc()].insert(name);
+  fibSize.set(int64_t(fib->size()));
 }
 
 void
@@ -103,8 +181,6 @@ Relay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
   uint32_t nowUs =
     (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn).count();
 
-  std::clog << ". ";
-
   // save the name for publish
   ClientData clientData;
   NamedDataChunk namedDataChunk;
@@ -127,43 +203,22 @@ Relay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
                            ? fromVarInt(encryptedDataBlock.cipherDataLen)
                            : fromVarInt(dataBlock.dataLen);
   if (payloadSize > packet->size()) {
-    std::clog << "relay recv bad data size " << payloadSize << " "
-              << packet->size() << std::endl;
+    QUICR_LOG_WARN(
+      "relay recv bad data size {} of {}", payloadSize, packet->size());
     return;
   }
 
-  // TODO: refactor ack logic
-  auto ack = std::make_unique<Packet>();
-  ack->setDst(packet->getSrc());
-  // TODO: set the token in connPipe once qServer uses
-  // ConnectionPipe
-  auto token = packet->getPathToken();
-  auto hdr = Packet::Header(PacketTag::headerData, token);
-  ack << hdr;
-
-  // TODO - get rid of prev Ack tag and use ack vector
-  if (prevAckSeqNum > 0) {
-    NetAck prevAckTag{};
-    prevAckTag.clientSeqNum = prevAckSeqNum;
-    prevAckTag.recvTimeUs = prevRecvTimeUs;
-    ack << prevAckTag;
-  }
-
-  NetAck ackTag{};
-  ackTag.clientSeqNum = clientSeqNumTag.clientSeqNum;
-  ackTag.recvTimeUs = nowUs;
-  ack << ackTag;
-
-  qServer.send(move(ack));
-
-  prevAckSeqNum = ackTag.clientSeqNum;
-  prevRecvTimeUs = ackTag.recvTimeUs;
+  recordAck(packet, clientSeqNumTag.clientSeqNum, nowUs);
+  publishedCount.add();
+  publishedBytes.add(payloadSize);
 
   // find the matching subscribers
   auto subscribers = fib->lookupSubscription(namedDataChunk.shortName);
+  fanOut.record(subscribers.size());
 
-  std::clog << "Name:" << namedDataChunk.shortName
-            << " has:" << subscribers.size() << " subscribers\n";
+  QUICR_LOG_DEBUG("name: {} has {} subscribers",
+                  namedDataChunk.shortName,
+                  subscribers.size());
 
   if (encrypted) {
     packet << encryptedDataBlock;
@@ -175,38 +230,268 @@ Relay::processPub(std::unique_ptr<MediaNet::Packet>& packet,
   for (auto& subscriber : subscribers) {
     auto relayDataPacket = packet->clone(); // TODO - just clone header stuff
     relayDataPacket->setDst(subscriber.face);
-    RelayData relayData{};
-    relayData.relaySeqNum = subscriber.relaySeqNum++;
-    relayData.relaySendTimeUs = nowUs;
+    relayDataPacket->setPriority(namedDataChunk.priority);
+
+    auto& queue = egressQueue(subscriber.face);
+    auto drops = queue.getDropCount();
+    queue.push(std::move(relayDataPacket));
+    egressDrops.add(queue.getDropCount() - drops);
+    if (!queue.active) {
+      queue.active = true;
+      activeQueues.push_back(&queue);
+    }
+  }
+}
+
+// send what each subscriber's rate allows, RelayData is added at send time so
+// the subscriber's jitter and rate estimates do not include queueing here
+void
+Relay::processEgress()
+{
+  if (activeQueues.empty()) {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration dn = tp.time_since_epoch();
+  uint32_t nowUs =
+    (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn).count();
+
+  for (auto it = activeQueues.begin(); it != activeQueues.end();) {
+    EgressQueue& queue = **it;
 
-    relayDataPacket << relayData;
+    while (auto relayDataPacket = queue.pop(tp)) {
+      RelayData relayData{};
+      relayData.relaySeqNum = queue.relaySeqNum++;
+      relayData.relaySendTimeUs = nowUs;
 
-    bool simLoss = false;
+      relayDataPacket << relayData;
 
-    if (false) {
-      //  simulate 10% packet loss
-      if ((relayData.relaySeqNum % 10) == 7) {
-        simLoss = true;
+      // piggyback any pending ack for this face
+      auto ackIt = ackAggregators.find(relayDataPacket->getDst());
+      if (ackIt != ackAggregators.end() && ackIt->second.pending()) {
+        relayDataPacket << ackIt->second.flush(nowUs);
       }
+
+      faceStats[relayDataPacket->getDst()].bytesOut +=
+        relayDataPacket->fullSize();
+      forwardedCount.add();
+      qServer->send(move(relayDataPacket));
+    }
+
+    if (queue.empty()) {
+      queue.active = false;
+      it = activeQueues.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+EgressQueue&
+Relay::egressQueue(const Face& face)
+{
+  auto it = egressQueues.find(face);
+  if (it == egressQueues.end()) {
+    it = egressQueues
+           .emplace(face,
+                    std::make_unique<EgressQueue>(
+                      getRandom(), std::chrono::steady_clock::now()))
+           .first;
+  }
+  return *(it->second);
+}
+
+void
+Relay::recordAck(std::unique_ptr<MediaNet::Packet>& packet,
+                 uint32_t clientSeqNum,
+                 uint32_t nowUs)
+{
+  const Face& face = packet->getSrc();
+  AckAggregator& aggregator = ackAggregators[face];
+  aggregator.pathToken = packet->getPathToken();
+  // the ack delay runs from when it arrived
+  aggregator.recv(clientSeqNum, arrivalUs(packet, nowUs));
+
+  if (aggregator.due(nowUs)) {
+    sendAck(face, aggregator, nowUs);
+  } else if (!aggregator.active) {
+    aggregator.active = true;
+    pendingAcks.push_back(face);
+  }
+}
+
+// send acks that have waited long enough
+void
+Relay::processAcks()
+{
+  if (pendingAcks.empty()) {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration dn = tp.time_since_epoch();
+  uint32_t nowUs =
+    (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn).count();
+
+  for (auto it = pendingAcks.begin(); it != pendingAcks.end();) {
+    AckAggregator& aggregator = ackAggregators.at(*it);
+
+    if (aggregator.due(nowUs)) {
+      sendAck(*it, aggregator, nowUs);
     }
 
-    if (!simLoss) {
-      qServer.send(move(relayDataPacket));
-      std::clog << "*";
+    if (!aggregator.pending()) {
+      aggregator.active = false;
+      it = pendingAcks.erase(it);
     } else {
-      std::clog << "-";
+      it++;
+    }
+  }
+}
+
+void
+Relay::sendAck(const Face& face, AckAggregator& aggregator, uint32_t nowUs)
+{
+  auto ack = std::make_unique<Packet>();
+  ack->setDst(face);
+  // TODO: set the token in connPipe once qServer uses
+  // ConnectionPipe
+  auto hdr = Packet::Header(PacketTag::headerData, aggregator.pathToken);
+  ack << hdr;
+  ack << aggregator.flush(nowUs);
+
+  qServer->send(move(ack));
+}
+
+// connection reset or timed out, forget everything about the face
+void
+Relay::processClosed(const Face& face)
+{
+  auto subs = subscriptionsByFace.find(face);
+  if (subs != subscriptionsByFace.end()) {
+    for (const auto& name : subs->second) {
+      fib->removeSubscription(name, SubscriberInfo{ name, face });
     }
+    QUICR_LOG_INFO("removed {} subscriptions for: {}",
+                   subs->second.size(),
+                   IpAddr::toString(face));
+    subscriptionsByFace.erase(subs);
+    fibSize.set(int64_t(fib->size()));
+  }
+  faceStats.erase(face);
+
+  auto queue = egressQueues.find(face);
+  if (queue != egressQueues.end()) {
+    if (queue->second->active) {
+      activeQueues.erase(std::find(
+        activeQueues.begin(), activeQueues.end(), queue->second.get()));
+    }
+    egressQueues.erase(queue);
+  }
+
+  auto aggregator = ackAggregators.find(face);
+  if (aggregator != ackAggregators.end()) {
+    if (aggregator->second.active) {
+      pendingAcks.erase(
+        std::find_if(pendingAcks.begin(),
+                     pendingAcks.end(),
+                     [&face](const Face& f) { return !(f < face || face < f); }));
+    }
+    ackAggregators.erase(aggregator);
   }
 }
 
+// per face rates since the last call, handed to the exporter thread
+void
+Relay::updateMetrics(const std::chrono::steady_clock::time_point& now)
+{
+  double seconds = std::chrono::duration<double>(now - lastMetrics).count();
+  lastMetrics = now;
+  faceCount.set(int64_t(faceStats.size()));
+
+  auto& samples = faceSamples.back();
+  samples.clear();
+  auto add = [&samples](const char* name,
+                        const char* help,
+                        const std::string& labels,
+                        MetricsRegistry::Type type,
+                        int64_t value) {
+    samples.push_back(
+      MetricsRegistry::Sample{ name, help, labels, type, value, {}, {}, 0, 0 });
+  };
+  const auto gauge = MetricsRegistry::Type::gauge;
+
+  for (auto& [face, stats] : faceStats) {
+    std::string labels = "face=\"" + IpAddr::toString(face) + "\"";
+
+    add("quicr_relay_face_rx_bps",
+        "bitrate received from the face",
+        labels,
+        gauge,
+        int64_t(double(stats.bytesIn - stats.reportedIn) * 8 / seconds));
+    add("quicr_relay_face_tx_bps",
+        "bitrate sent to the face",
+        labels,
+        gauge,
+        int64_t(double(stats.bytesOut - stats.reportedOut) * 8 / seconds));
+    stats.reportedIn = stats.bytesIn;
+    stats.reportedOut = stats.bytesOut;
+
+    auto aggregator = ackAggregators.find(face);
+    if (aggregator != ackAggregators.end()) {
+      add("quicr_relay_face_loss_per_million",
+          "client packets from the face that never arrived",
+          labels,
+          gauge,
+          aggregator->second.takeLossPerMillion());
+    }
+
+    auto subs = subscriptionsByFace.find(face);
+    add("quicr_relay_face_subscriptions",
+        "names the face subscribed to",
+        labels,
+        gauge,
+        subs == subscriptionsByFace.end() ? 0 : int64_t(subs->second.size()));
+
+    auto queue = egressQueues.find(face);
+    if (queue != egressQueues.end()) {
+      add("quicr_relay_face_requested_bps",
+          "rate the face asked to receive at",
+          labels,
+          gauge,
+          int64_t(queue->second->getRate()));
+      add("quicr_relay_face_queued_packets",
+          "packets waiting to go to the face",
+          labels,
+          gauge,
+          int64_t(queue->second->size()));
+      add("quicr_relay_face_drops_total",
+          "packets to the face dropped from its queue",
+          labels,
+          MetricsRegistry::Type::counter,
+          int64_t(queue->second->getDropCount()));
+    }
+  }
+
+  faceSamples.publish();
+}
+
 void
 Relay::processRateRequest(std::unique_ptr<MediaNet::Packet>& packet)
 {
   NetRateReq rateReq{};
-  packet >> rateReq;
-  std::clog << std::endl
-            << "ReqRate: " << float(rateReq.bitrateKbps) / 1000.0 << " mbps"
-            << std::endl;
+  if (!(packet >> rateReq)) {
+    return;
+  }
+
+  auto& queue = egressQueue(packet->getSrc());
+  queue.setRate(fromVarInt(rateReq.bitrateKbps) * 1000);
+
+  QUICR_LOG_DEBUG("rate request: {} mbps queued: {} dropped: {}",
+                  float(fromVarInt(rateReq.bitrateKbps)) / 1000.0f,
+                  queue.size(),
+                  queue.getDropCount());
 }
 
 void
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace MediaNet {
+
+///
+/// ImpairmentConfig
+///
+
+// What ImpairmentPipe does to packets going one way. The defaults leave
+// them alone. Chances are per million packets.
+struct ImpairmentConfig
+{
+  uint64_t bitrateBps = 0;       // 0 is unlimited
+  uint32_t queueBytes = 100000;  // waiting for the bitrate, dropped past it
+  uint32_t delayMs = 0;
+  uint32_t jitterMs = 0;         // up to this much more, uniform
+
+  // Gilbert-Elliott loss: each packet may move the link between a good and
+  // a bad state, then is lost with the chance of the state it is in. Only
+  // lossGoodPerMillion gives independent loss; bursts average
+  // 1000000 / badToGoodPerMillion packets.
+  uint32_t goodToBadPerMillion = 0;
+  uint32_t badToGoodPerMillion = 1000000;
+  uint32_t lossGoodPerMillion = 0;
+  uint32_t lossBadPerMillion = 1000000;
+
+  uint32_t reorderPerMillion = 0; // held back reorderMs more
+  uint32_t reorderMs = 10;
+  uint32_t duplicatePerMillion = 0;
+
+  uint64_t seed = 1; // the same seed impairs the same packets
+
+  [[nodiscard]] bool active() const
+  {
+    return bitrateBps || delayMs || jitterMs || goodToBadPerMillion ||
+           lossGoodPerMillion || reorderPerMillion || duplicatePerMillion;
+  }
+};
+
+///
+/// ClientConfig
+///
+
+// Which optional stages QuicRClient builds and how the pipeline starts
+// out. The defaults give the same client as before there was a config.
+struct ClientConfig
+{
+  // ImpairmentPipe, built when either is active, on what is sent up to the
+  // relay and what comes down from it
+  ImpairmentConfig impairUp;
+  ImpairmentConfig impairDown;
+
+  // optional stages
+  bool spinBit = true;    // CrazyBitPipe
+  bool fec = true;        // FecPipe, resends packets marked for FEC
+  bool retransmit = true; // RetransmitPipe, resends reliable packets
+
+  // starting values, the rate control takes over from them
+  static constexpr uint16_t minMtu = 128;  // the headers and some payload
+  static constexpr uint16_t maxMtu = 1500; // what UdpPipe receives
+  uint16_t mtu = 1280;
+  uint32_t pps = 480;
+  uint16_t minRttMs = 20;
+  uint16_t bigRttMs = 50;
+
+  size_t sendQueueDepth = 1000; // per priority, oldest dropped past it
+  int cryptoThreads = 0;        // see QuicRClient::setCryptoThreads
+  uint32_t jitterMinMs = 0;     // see QuicRClient::setJitterBuffer
+  uint32_t jitterMaxMs = 0;
+
+  // kernel send and receive timestamps for the rate control, Linux only,
+  // hardware ones too if the NIC has them, see UdpPipe::setTimestamps
+  bool wireTimestamps = true;
+  bool hardwareTimestamps = false;
+};
+
+///
+/// RelayConfig
+///
+
+// Where the relay listens and what else it serves. The clients take
+// relayPort from it too, so both can share one file.
+struct RelayConfig
+{
+  uint16_t relayPort = 5004;
+  uint16_t metricsPort = 0; // relay serves /metrics here, 0 is off
+
+  // relay records its datagrams in this pcap file, see PacketCapture
+  std::string capture;
+  uint64_t captureFileBytes = 0; // past it the file rotates, 0 is no limit
+};
+
+// Reads "key = value" lines, # starts a comment. handler returns false for
+// a key it does not know or a value it can not use. Problems are logged
+// with their line number and make it return false.
+using ConfigHandler =
+  std::function<bool(const std::string& key, const std::string& value)>;
+bool
+parseConfigFile(const std::string& path, const ConfigHandler& handler);
+
+// sets the keys the file has, the rest of each config is left as it is.
+// The keys are the ClientConfig and RelayConfig member names,
+// impairUp.delayMs and the like for the impairments.
+bool
+loadConfig(const std::string& path, ClientConfig& client, RelayConfig& relay);
+
+// as loadConfig, for a program that only needs the one. The keys of the
+// other are still checked, so a shared file is read the same by both.
+bool
+loadClientConfig(const std::string& path, ClientConfig& config);
+bool
+loadRelayConfig(const std::string& path, RelayConfig& config);
+
+} // namespace MediaNet
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace MediaNet {
+
+///
+/// Logging
+///
+
+// Logging cheap enough for the data path. A log call copies its arguments
+// as raw bytes into a slot of a lock-free ring and returns; a background
+// thread formats the slots and writes them out. Levels below
+// QUICR_LOG_LEVEL are compiled out, and each call site lets through at
+// most a set number of messages a second, reporting how many it held back
+// with the next one it lets through.
+//
+//   QUICR_LOG_WARN("recv bad data size {} of {}", payloadSize, size);
+//
+// The format must be a string literal; each {} is replaced by the next
+// argument. Arguments are copied, not referenced: numbers, ShortName and
+// other trivially copyable types with an operator<<, and strings, which
+// are cut short if they do not fit the slot.
+
+enum struct LogLevel : uint8_t
+{
+  trace = 0,
+  debug,
+  info,
+  warn,
+  error,
+  off,
+};
+
+#ifndef QUICR_LOG_LEVEL
+#define QUICR_LOG_LEVEL 2 // info
+#endif
+
+constexpr LogLevel compiledLogLevel = LogLevel(QUICR_LOG_LEVEL);
+
+// One per call site, a function static made by the QUICR_LOG macros
+class LogSite
+{
+public:
+  constexpr LogSite(LogLevel level,
+                    const char* file,
+                    int line,
+                    uint32_t perSecond)
+    : level(level)
+    , file(file)
+    , line(line)
+    , perSecond(perSecond)
+  {}
+
+  // false if this second's allowance is used up. When true, suppressed is
+  // how many were held back since the last one let through.
+  bool admit(uint32_t& suppressed);
+
+  const LogLevel level;
+  const char* const file;
+  const int line;
+  const uint32_t perSecond; // 0 for no limit
+
+private:
+  std::atomic<uint64_t> window{ 0 }; // steady clock second
+  std::atomic<uint32_t> inWindow{ 0 };
+  std::atomic<uint32_t> held{ 0 };
+};
+
+///
+/// Logger
+///
+
+class Logger
+{
+public:
+  static constexpr size_t ringSize = 4096; // slots, power of 2
+  static constexpr size_t argBytes = 192;  // per slot
+
+  Logger();
+  ~Logger();
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // messages below level are dropped at run time too
+  void setLevel(LogLevel level) { minLevel.store(level); }
+  [[nodiscard]] LogLevel getLevel() const { return minLevel.load(); }
+
+  // where the drain thread writes, std::clog unless set
+  void setSink(std::ostream* out);
+
+  template<typename... Args>
+  void log(LogSite& site, const char* format, const Args&... args)
+  {
+    if (site.level < minLevel.load(std::memory_order_relaxed)) {
+      return;
+    }
+    uint32_t suppressed = 0;
+    if (!site.admit(suppressed)) {
+      return;
+    }
+
+    Slot* slot = claim();
+    if (!slot) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Record& record = slot->record;
+    record.site = &site;
+    record.format = format;
+    record.time = std::chrono::system_clock::now();
+    record.suppressed = suppressed;
+    record.used = 0;
+    record.truncated = false;
+    (capture(record, args), ...);
+    commit(slot);
+  }
+
+  // writes out everything logged so far, on the calling thread
+  void flush();
+
+  // messages lost because the ring was full
+  [[nodiscard]] uint64_t droppedCount() const { return dropped.load(); }
+
+  static Logger& global();
+
+private:
+  using Printer = void (*)(std::ostream&, const uint8_t*, size_t);
+
+  struct Record
+  {
+    const LogSite* site;
+    const char* format;
+    std::chrono::system_clock::time_point time;
+    uint32_t suppressed;
+    uint16_t used;
+    bool truncated;
+    // per argument: Printer, uint8_t length, then the bytes
+    std::array<uint8_t, argBytes> args;
+  };
+
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t> sequence;
+    Record record;
+  };
+
+  template<typename T>
+  static void print(std::ostream& out, const uint8_t* bytes, size_t)
+  {
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    if constexpr (std::is_integral_v<T> && sizeof(T) == 1 &&
+                  !std::is_same_v<T, char>) {
+      out << int(value);
+    } else {
+      out << value;
+    }
+  }
+  static void printString(std::ostream& out,
+                          const uint8_t* bytes,
+                          size_t length);
+
+  static constexpr size_t argHeader = sizeof(Printer) + 1;
+
+  static void captureBytes(Record& record,
+                           Printer printer,
+                           const void* bytes,
+                           size_t length,
+                           bool cut);
+
+  template<typename T>
+  static void capture(Record& record, const T& value)
+  {
+    if constexpr (std::is_convertible_v<const T&, const char*>) {
+      const char* str = value;
+      captureString(record, str, std::strlen(str));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      captureString(record, value.data(), value.size());
+    } else {
+      static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= 64,
+                    "log arguments are copied as bytes");
+      captureBytes(record, &print<T>, &value, sizeof(T), false);
+    }
+  }
+  static void captureString(Record& record, const char* str, size_t length)
+  {
+    captureBytes(record, &printString, str, length, true);
+  }
+
+  Slot* claim();
+  void commit(Slot* slot);
+  bool drainOne(std::ostream& out);
+  static void write(std::ostream& out, const Record& record);
+  void run();
+
+  std::atomic<LogLevel> minLevel;
+  std::atomic<uint64_t> dropped;
+
+  std::unique_ptr<Slot[]> slots;
+  alignas(64) std::atomic<uint64_t> enqueuePos;
+  alignas(64) uint64_t dequeuePos; // under drainMutex
+
+  std::mutex drainMutex;
+  std::ostream* sink; // under drainMutex
+  uint64_t droppedReported;
+
+  std::mutex runMutex;
+  std::condition_variable runCv;
+  bool shutDown;
+  std::thread thread;
+};
+
+} // namespace MediaNet
+
+// per site limit of the level macros, QUICR_LOG_RATE sets its own
+#define QUICR_LOG_PER_SECOND 10
+
+#define QUICR_LOG_RATE(lvl, perSecond, ...)                                    \
+  do {                                                                         \
+    if constexpr (MediaNet::LogLevel::lvl >= MediaNet::compiledLogLevel) {     \
+      static MediaNet::LogSite quicrLogSite(                                   \
+        MediaNet::LogLevel::lvl, __FILE__, __LINE__, perSecond);               \
+      MediaNet::Logger::global().log(quicrLogSite, __VA_ARGS__);               \
+    }                                                                          \
+  } while (0)
+
+#define QUICR_LOG_TRACE(...) QUICR_LOG_RATE(trace, QUICR_LOG_PER_SECOND, __VA_ARGS__)
+#define QUICR_LOG_DEBUG(...) QUICR_LOG_RATE(debug, QUICR_LOG_PER_SECOND, __VA_ARGS__)
+#define QUICR_LOG_INFO(...) QUICR_LOG_RATE(info, QUICR_LOG_PER_SECOND, __VA_ARGS__)
+#define QUICR_LOG_WARN(...) QUICR_LOG_RATE(warn, QUICR_LOG_PER_SECOND, __VA_ARGS__)
+#define QUICR_LOG_ERROR(...) QUICR_LOG_RATE(error, QUICR_LOG_PER_SECOND, __VA_ARGS__)
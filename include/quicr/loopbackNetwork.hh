@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MediaNet {
+
+class LoopbackEndpoint;
+
+///
+/// LoopbackNetwork
+///
+
+// Links clients and servers in one process without sockets, for tests and
+// full stack benchmarks. Build QuicRClient and QuicRServer with the same
+// network and they reach each other by port: a server opens its port as
+// it would with UDP, and a client opened with any relay name and that port
+// gets to it. Each endpoint is 127.0.0.1 with its port.
+//
+// Packets go through lock-free queues. Every link has the delay, bitrate
+// and loss of the config; the bitrate applies to what each endpoint sends,
+// which waits its turn in a queue that drops past queueMs. The network
+// must outlive the clients and servers on it.
+class LoopbackNetwork
+{
+public:
+  struct LinkConfig
+  {
+    uint32_t delayMs = 0;
+    uint64_t bitrateBps = 0; // 0 is unlimited
+    uint32_t queueMs = 100;  // most a packet waits for the bitrate
+    uint32_t lossPerMillion = 0;
+    uint64_t seed = 1; // which packets are lost, per endpoint
+  };
+
+  LoopbackNetwork();
+  explicit LoopbackNetwork(const LinkConfig& link);
+  ~LoopbackNetwork();
+  LoopbackNetwork(const LoopbackNetwork&) = delete;
+  LoopbackNetwork& operator=(const LoopbackNetwork&) = delete;
+
+  [[nodiscard]] const LinkConfig& link() const { return config; }
+
+  // port 0 picks a free one, nullptr if the port is taken
+  LoopbackEndpoint* bind(uint16_t port);
+  void unbind(LoopbackEndpoint* endpoint);
+
+  // safe from any thread, nullptr if nothing is bound there
+  [[nodiscard]] LoopbackEndpoint* find(uint16_t port) const
+  {
+    return (*ports)[port].load(std::memory_order_acquire);
+  }
+
+private:
+  const LinkConfig config;
+
+  std::unique_ptr<std::array<std::atomic<LoopbackEndpoint*>, 65536>> ports;
+
+  std::mutex bindMutex;
+  // kept until the network goes, packets on the way may still point at them
+  std::vector<std::unique_ptr<LoopbackEndpoint>> endpoints;
+  uint16_t nextEphemeral;
+};
+
+} // namespace MediaNet
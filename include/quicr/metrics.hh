@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MediaNet {
+
+///
+/// Metrics
+///
+
+// Counters, gauges and histograms the pipes update from their own threads
+// and a reporter thread reads. Updates are single relaxed atomic adds or
+// stores, and reading never takes a lock, so a scrape can not stall the
+// data path. Values read while updates are going on are each current but
+// not a consistent cut across metrics.
+
+// Monotonic count, spread over cache line sized shards picked per thread
+// so threads bumping the same counter do not fight over one line
+class Counter
+{
+public:
+  void add(uint64_t n = 1)
+  {
+    shards[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  [[nodiscard]] uint64_t value() const;
+
+  static constexpr size_t numShards = 16;
+
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<uint64_t> value{ 0 };
+  };
+
+  static size_t shardIndex();
+
+  std::array<Shard, numShards> shards;
+};
+
+// Last value set, or a running level moved with add()
+class Gauge
+{
+public:
+  void set(int64_t v) { val.store(v, std::memory_order_relaxed); }
+  void add(int64_t n) { val.fetch_add(n, std::memory_order_relaxed); }
+  [[nodiscard]] int64_t value() const
+  {
+    return val.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int64_t> val{ 0 };
+};
+
+// Count of values per fixed bucket, plus their sum. Bucket i holds values
+// up to and including bounds[i], the last one everything above.
+class Histogram
+{
+public:
+  explicit Histogram(std::vector<uint64_t> bounds);
+
+  void record(uint64_t v);
+
+  [[nodiscard]] const std::vector<uint64_t>& bounds() const { return limits; }
+  // per bucket, not cumulative, bounds().size() + 1 of them
+  [[nodiscard]] std::vector<uint64_t> buckets() const;
+  [[nodiscard]] uint64_t count() const;
+  [[nodiscard]] uint64_t sum() const
+  {
+    return total.load(std::memory_order_relaxed);
+  }
+
+  // 1, 2, 5, 10, 20, 50 ... up to max
+  static std::vector<uint64_t> decadeBounds(uint64_t max);
+
+private:
+  std::vector<uint64_t> limits;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts;
+  std::atomic<uint64_t> total{ 0 };
+};
+
+///
+/// MetricsRegistry
+///
+
+// Owns the metrics by name and labels. Asking again for the same name and
+// labels returns the same metric, so a pipe rebuilt with its client picks
+// its counters back up. Metrics live until removed with remove(), or as
+// long as the registry, and a removed metric's slot is taken again by a
+// later one. Labels are in exposition form without the braces, for
+// example client="1".
+class MetricsRegistry
+{
+public:
+  enum struct Type : uint8_t
+  {
+    counter = 0,
+    gauge,
+    histogram,
+  };
+
+  struct Sample
+  {
+    std::string name;
+    std::string help;
+    std::string labels;
+    Type type;
+    int64_t value; // counter or gauge
+
+    // histogram only
+    std::vector<uint64_t> bounds;
+    std::vector<uint64_t> buckets;
+    uint64_t count;
+    uint64_t sum;
+  };
+
+  explicit MetricsRegistry(size_t maxMetrics = 4096);
+  ~MetricsRegistry();
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // register or look up, takes a lock so do it once at setup, not per
+  // packet. Once full, further metrics work but are not reported.
+  Counter& counter(const std::string& name,
+                   const std::string& help,
+                   const std::string& labels = "");
+  Gauge& gauge(const std::string& name,
+               const std::string& help,
+               const std::string& labels = "");
+  Histogram& histogram(const std::string& name,
+                       const std::string& help,
+                       const std::vector<uint64_t>& bounds,
+                       const std::string& labels = "");
+
+  // drops every metric labelled with labels, alone or ahead of others as
+  // joinLabels() puts them, for an owner going away. Its references to
+  // them must not be used after this.
+  void remove(const std::string& labels);
+
+  // safe from any thread, takes no lock
+  [[nodiscard]] std::vector<Sample> snapshot() const;
+  // slots taken, including those of removed metrics not yet reused
+  [[nodiscard]] size_t size() const
+  {
+    return used.load(std::memory_order_acquire);
+  }
+
+  // the one the pipes register with
+  static MetricsRegistry& global();
+
+private:
+  struct Entry
+  {
+    std::string name;
+    std::string help;
+    std::string labels;
+    Type type = Type::counter;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    std::atomic<bool> live{ false }; // reported, set once the rest is
+  };
+
+  Entry& add(const std::string& name,
+             const std::string& help,
+             const std::string& labels,
+             Type type,
+             const std::vector<uint64_t>& bounds);
+
+  // A live entry in [0, used) does not change, which is what lets
+  // snapshot() read them without the lock. A removed one is only written
+  // again once no snapshot that could have seen it live is still going.
+  std::unique_ptr<Entry[]> entries;
+  size_t capacity;
+  std::atomic<size_t> used;
+  mutable std::atomic<uint32_t> readers; // snapshots going on
+
+  std::mutex registerMutex;
+  std::unordered_map<std::string, size_t> index; // name{labels}
+  std::vector<size_t> retired;   // removed, a snapshot may still read them
+  std::vector<size_t> freeSlots; // removed and no longer read
+  std::vector<std::unique_ptr<Entry>> overflow; // past capacity
+};
+
+///
+/// TripleBuffer
+///
+
+// Hands the latest of a series of values from one writer thread to one
+// reader thread without either waiting on the other. The writer fills
+// back() and calls publish(); the reader gets the newest value published,
+// or the one it had if nothing new came. For state that is not kept in
+// registry metrics, such as per connection stats built by a relay loop and
+// read by the exporter thread.
+template<typename T>
+class TripleBuffer
+{
+public:
+  T& back() { return buffers[backIndex]; }
+  void publish()
+  {
+    backIndex =
+      middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask;
+  }
+
+  const T& read()
+  {
+    if (middle.load(std::memory_order_relaxed) & fresh) {
+      frontIndex =
+        middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+    }
+    return buffers[frontIndex];
+  }
+
+private:
+  static constexpr uint8_t indexMask = 3;
+  static constexpr uint8_t fresh = 4;
+
+  std::array<T, 3> buffers{};
+  uint8_t backIndex = 0;             // writer only
+  std::atomic<uint8_t> middle{ 1 }; // index, plus fresh once published
+  uint8_t frontIndex = 2;            // reader only
+};
+
+// joins two label sets, either may be empty
+std::string
+joinLabels(const std::string& a, const std::string& b);
+
+} // namespace MediaNet
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.hh"
+
+namespace MediaNet {
+
+class WakeupEvent;
+
+///
+/// MetricsExporter
+///
+
+// Serves a registry over HTTP in OpenMetrics text format, which Prometheus
+// scrapes, on a thread of its own. Every scrape takes a fresh snapshot, and
+// snapshots read atomics only, so scraping never holds up the threads that
+// move packets. GET /metrics returns the metrics, anything else a 404.
+class MetricsExporter
+{
+public:
+  using Samples = std::vector<MetricsRegistry::Sample>;
+  // adds samples of state kept outside the registry. Called on the
+  // exporter thread, so it must not take locks the data path holds.
+  using Collector = std::function<void(Samples& samples)>;
+
+  explicit MetricsExporter(MetricsRegistry& registry = MetricsRegistry::global());
+  ~MetricsExporter();
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  // call before start()
+  void addCollector(Collector collector);
+
+  // port 0 picks a free one, see port()
+  bool start(uint16_t port, const std::string& address = "0.0.0.0");
+  void stop();
+  [[nodiscard]] uint16_t port() const { return boundPort; }
+
+  // the body of a /metrics response. Samples of one name are grouped
+  // together in the order the first of them came.
+  static std::string format(const Samples& samples);
+
+private:
+  void run();
+  void serve(int fd);
+
+  MetricsRegistry& registry;
+  std::vector<Collector> collectors;
+
+  int listenFd;
+  uint16_t boundPort;
+  std::unique_ptr<WakeupEvent> stopEvent;
+  std::atomic<bool> shutDown;
+  std::thread thread;
+};
+
+} // namespace MediaNet
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <sys/types.h>
+#include <utility>
 #include <vector>
 #if defined(__linux__) || defined(__APPLE__)
 #include <netinet/in.h>
@@ -16,6 +18,7 @@
 #endif
 
 #include "shortName.hh"
+#include "trace.hh"
 
 #include "../../src/packetTag.hh"
 
@@ -36,6 +39,32 @@ struct IpAddr
   bool operator<(const IpAddr& rhs) const;
 };
 
+// Allocator that leaves new elements uninitialized when a vector grows,
+// for buffers whose bytes are always written before they are read
+template<typename T>
+struct DefaultInitAllocator : std::allocator<T>
+{
+  template<typename U>
+  struct rebind
+  {
+    using other = DefaultInitAllocator<U>;
+  };
+
+  using std::allocator<T>::allocator;
+
+  template<typename U>
+  void construct(U* ptr)
+  {
+    ::new (static_cast<void*>(ptr)) U;
+  }
+
+  template<typename U, typename... Args>
+  void construct(U* ptr, Args&&... args)
+  {
+    ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+  }
+};
+
 static constexpr int QUICR_HEADER_SIZE_BYTES =
   6; // (1) magic + (4) pathToken + (1) tag
 
@@ -67,17 +96,29 @@ public:
   Packet();
   void copy(const Packet& p);
   [[nodiscard]] std::unique_ptr<Packet> clone() const;
+  // like clone() but only len bytes of the payload, starting at offset
+  [[nodiscard]] std::unique_ptr<Packet> cloneSlice(size_t offset,
+                                                   size_t len) const;
 
   uint8_t& data() { return buffer.at(headerSize); }
   uint8_t& fullData() { return buffer.at(0); }
 
   [[nodiscard]] size_t size() const;
   [[nodiscard]] size_t fullSize() const { return buffer.size(); }
-  void resize(int size) { buffer.resize(headerSize + size); }
+  // new payload bytes are zero
+  void resize(int size);
+  // new bytes are left as they are, for a buffer about to be filled
   void resizeFull(int size) { buffer.resize(size); }
 
   void reserve(int s) { buffer.reserve(headerSize + s); }
 
+  // Lets an encoder write an object straight into the packet: acquire()
+  // appends maxSize payload bytes, left uninitialized, and returns where
+  // they start; commit() then trims them to the size actually written.
+  // With the room reserved by createPacket() neither call reallocates.
+  uint8_t* acquire(size_t maxSize);
+  void commit(size_t size);
+
   void setReliable(bool reliable = true);
   [[nodiscard]] bool isReliable() const;
 
@@ -92,6 +133,22 @@ public:
   [[maybe_unused]] [[nodiscard]] const IpAddr& getDst() const;
   void setDst(const IpAddr& dst);
 
+  // when the transport sent or received it, from a kernel or NIC
+  // timestamp, the clock's epoch when there is none
+  [[nodiscard]] std::chrono::steady_clock::time_point getWireTime() const
+  {
+    return wireTime;
+  }
+  void setWireTime(std::chrono::steady_clock::time_point time)
+  {
+    wireTime = time;
+  }
+
+  // not 0 to have the transport report when it left, see
+  // PipeInterface::sentAt()
+  [[nodiscard]] uint32_t getSendId() const { return sendId; }
+  void setSendId(uint32_t id) { sendId = id; }
+
   [[nodiscard]] ShortName shortName() const { return name; };
 
   void setFragID(uint8_t fragmentID, bool lastFrag);
@@ -118,8 +175,13 @@ public:
   // Handy debugging function
   std::string to_hex();
 
+#if defined(QUICR_TRACING)
+  PacketTrace trace; // copied to clones and fragments
+#endif
+
 private:
-  std::vector<uint8_t> buffer;
+  std::vector<uint8_t, DefaultInitAllocator<uint8_t>> buffer;
+  size_t acquired = 0; // bytes from acquire() not yet committed
   int headerSize = QUICR_HEADER_SIZE_BYTES;
 
   MediaNet::ShortName name;
@@ -133,6 +195,9 @@ private:
 
   MediaNet::IpAddr src;
   MediaNet::IpAddr dst;
+
+  std::chrono::steady_clock::time_point wireTime;
+  uint32_t sendId = 0;
 };
 
 bool
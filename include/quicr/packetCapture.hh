@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "packet.hh"
+
+namespace MediaNet {
+
+///
+/// PacketCapture
+///
+
+// Records datagrams with their time and addresses in a pcap file, each
+// behind a made up IPv4 and UDP header so Wireshark and tcpdump can read
+// it, and so can CaptureReader and qreplay. record() only copies the
+// datagram into a buffer under a lock; a background thread writes the
+// buffer out. What does not fit the buffer before the thread gets to it
+// is dropped and counted, capturing never holds up the data path.
+//
+// With maxFileBytes set the file is a ring of two: once path would go
+// past it, path is renamed to path.1, replacing the one before, and a new
+// path is started.
+class PacketCapture
+{
+public:
+  static constexpr size_t bufferBytes = 4 << 20; // waiting to be written
+
+  explicit PacketCapture(const std::string& path, uint64_t maxFileBytes = 0);
+  ~PacketCapture();
+  PacketCapture(const PacketCapture&) = delete;
+  PacketCapture& operator=(const PacketCapture&) = delete;
+
+  // false if the file could not be opened, or reopened when rotating,
+  // after which nothing more is captured
+  [[nodiscard]] bool ok() const { return opened.load(); }
+
+  // safe from any thread
+  void record(const IpAddr& src,
+              const IpAddr& dst,
+              const uint8_t* data,
+              size_t size);
+
+  // writes out everything recorded so far, on the calling thread
+  void flush();
+
+  [[nodiscard]] uint64_t capturedCount() const { return captured.load(); }
+  // datagrams lost because the buffer was full
+  [[nodiscard]] uint64_t droppedCount() const { return dropped.load(); }
+
+private:
+  bool openFile();
+  bool rotate(); // false if it stopped capturing
+  void run();
+
+  const std::string path;
+  const uint64_t maxFileBytes;
+  std::atomic<bool> opened; // read by record() on any thread
+
+  using Buffer = std::vector<uint8_t, DefaultInitAllocator<uint8_t>>;
+
+  std::mutex fillMutex;
+  Buffer filling; // under fillMutex
+  std::atomic<uint64_t> captured;
+  std::atomic<uint64_t> dropped;
+
+  std::mutex writeMutex;
+  Buffer writing;     // under writeMutex
+  std::ofstream file; // under writeMutex
+  uint64_t fileBytes;
+
+  std::mutex runMutex;
+  std::condition_variable runCv;
+  bool shutDown;
+  std::thread thread;
+};
+
+///
+/// CaptureReader
+///
+
+struct CapturedPacket
+{
+  std::chrono::nanoseconds time; // since the Unix epoch
+  IpAddr src;
+  IpAddr dst;
+  std::vector<uint8_t> data; // the UDP payload
+};
+
+// Reads back the UDP over IPv4 datagrams of a pcap file, one at a time so
+// a long capture is never all in memory
+class CaptureReader
+{
+public:
+  explicit CaptureReader(const std::string& path);
+
+  // false if the file could not be opened or is not a pcap we can read
+  [[nodiscard]] bool ok() const { return valid; }
+
+  // false at the end of the file, other packets are skipped
+  bool next(CapturedPacket& packet);
+
+private:
+  std::ifstream file;
+  bool valid;
+  bool nanoseconds; // else microseconds
+  std::vector<uint8_t> record;
+};
+
+} // namespace MediaNet
@@ -1,26 +1,36 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 //#include <utility> // for pair
 
+#include "config.hh"
 #include "packet.hh"       // TODO - remove and replace with Buffer
 #include <sframe/sframe.h> // TODO - rethink this
 
 namespace MediaNet {
 
+class LoopbackNetwork;
 class PipeInterface;
 class SubscribePipe;
 class EncryptPipe;
+class JitterBufferPipe;
 class ClientConnectionPipe;
 class PacerPipe;
+class WakeupEvent;
 
 class QuicRClient
 {
 public:
   QuicRClient();
+  explicit QuicRClient(const ClientConfig& config);
+  // on network instead of UDP, see LoopbackNetwork
+  QuicRClient(const ClientConfig& config, LoopbackNetwork& network);
   virtual ~QuicRClient();
   virtual bool open(uint32_t clientID,
                     std::string relayName,
@@ -35,6 +45,18 @@ public:
   void setCryptoKey(sframe::MLSContext::EpochID epoch,
                     const sframe::bytes& mls_epoch_secret);
 
+  // encrypt and decrypt on numThreads worker threads instead of the
+  // publishing and receiving threads, 0 (the default) runs it inline.
+  // Call before open().
+  void setCryptoThreads(int numThreads);
+  // percent busy of each crypto worker over the last second
+  std::vector<uint32_t> getCryptoUtilization() const;
+
+  // hold received objects and hand them out in mediaTime (ms) order at
+  // their playout time, with a depth that adapts to the measured jitter
+  // between the two bounds. maxDepthMs 0 (the default) turns it off.
+  void setJitterBuffer(uint32_t minDepthMs, uint32_t maxDepthMs);
+
   void setBitrateUp(uint64_t minBps, uint64_t startBps, uint64_t maxBps);
   void setRttEstimate(uint32_t minRttMs, uint32_t bigRttMs = 0);
   void setPacketsUp(uint16_t pps, uint16_t mtu = 1280);
@@ -49,13 +71,26 @@ void setDecryptionKey(uint32_t clientID, std::vector<uint8_t> salt,
   virtual std::unique_ptr<Packet> createPacket(const ShortName& name,
                                                int reservedPayloadSize);
   virtual bool publish(std::unique_ptr<Packet>);
+  // publishes all the packets, leaving the vector empty. Each pipe handles
+  // the run in one go, so the queue locks are taken once per batch.
+  bool publishBatch(std::vector<std::unique_ptr<Packet>>& packets);
 
   bool subscribe(ShortName);
 
   /// non blocking, return nullptr if no buffer
   virtual std::unique_ptr<Packet> recv();
+  // waits up to timeout for a packet, nullptr if none came or on close()
+  std::unique_ptr<Packet> recv(std::chrono::milliseconds timeout);
+  // readable when recv() may have a packet, for apps with their own poll
+  // loop, -1 where not supported. Call recv() until it returns nullptr
+  // once it is readable. Objects held by the jitter buffer do not make it
+  // readable when they come due, recv(timeout) does wait for those.
+  int getRecvFd();
 
   uint64_t getTargetUpstreamBitrate(); // in bps
+
+  // the pipes the config built, top of the chain first
+  [[nodiscard]] std::vector<const PipeInterface*> pipes() const;
   // uint64_t getTargetDownstreamBitrate(); // in bps
   // uint64_t getMaxBandwidth();
 
@@ -64,6 +99,10 @@ void setDecryptionKey(uint32_t clientID, std::vector<uint8_t> salt,
   //               uint32_t senderID=0, uint8_t sourceID=0 );
 
 private:
+  QuicRClient(const ClientConfig& config, PipeInterface* transport);
+
+  static void addPublishHeaders(std::unique_ptr<Packet>& packet);
+
 	// timer thread
 	// TODO: if app can provide its own timepoint, this
 	// thread shouldn't be run
@@ -72,7 +111,6 @@ private:
 
 #if 0
   UdpPipe udpPipe;
-  FakeLossPipe fakeLossPipe;
   CrazyBitPipe crazyBitPipe;
   ClientConnectionPipe connectionPipe;
   PacerPipe pacerPipe;
@@ -86,14 +124,17 @@ private:
 #endif
 
   PipeInterface* firstPipe;
+  std::string metricsLabels; // removed from the registry with the chain
   SubscribePipe* subscribePipe;         // TODO remove
   EncryptPipe* encryptPipe;             // TODO remove
+  JitterBufferPipe* jitterBufferPipe;   // TODO remove
   ClientConnectionPipe* connectionPipe; // TODO remove
   PacerPipe* pacerPipe;                 // TODO remove
+  std::unique_ptr<WakeupEvent> recvEvent;
 
   // uint32_t pubClientID;
   // uint64_t secToken;
-  bool shutDown = false;
+  std::atomic<bool> shutDown{ false };
 };
 
 } // namespace MediaNet
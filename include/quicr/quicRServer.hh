@@ -1,23 +1,29 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
 
 #include "../../src/connectionPipe.hh"
-#include "../../src/fakeLossPipe.hh"
 #include "../../src/pipeInterface.hh"
-#include "../../src/udpPipe.hh"
+#include "../../src/statsPipe.hh"
+#include "../../src/transportPipe.hh"
+#include "config.hh"
 #include "packet.hh"
 
 namespace MediaNet {
 
-// class UdpPipe;
+class ImpairmentPipe;
+class LoopbackNetwork;
+class PacketCapture;
 
 class QuicRServer
 {
 public:
   QuicRServer();
+  // on network instead of UDP, see LoopbackNetwork
+  explicit QuicRServer(LoopbackNetwork& network);
   virtual ~QuicRServer();
 
   virtual bool open(uint16_t port);
@@ -25,13 +31,41 @@ public:
   virtual void close();
   // Packet might be null
   virtual std::unique_ptr<Packet> recv();
+  // waits up to timeout for a packet, nullptr if none came
+  std::unique_ptr<Packet> recv(std::chrono::milliseconds timeout);
+  // readable when recv() may have a packet, for apps with their own poll
+  // loop. Call recv() until it returns nullptr once it is readable.
+  int getRecvFd() const;
   virtual bool send(std::unique_ptr<Packet>);
 
+  // impairs what is sent to and received from all clients, see
+  // ImpairmentPipe. Call before open(). Held packets are let go from
+  // recv(timeout), which then polls every ms; apps with their own poll loop
+  // have to call recv() that often too.
+  void setImpairment(const ImpairmentConfig& toClients,
+                     const ImpairmentConfig& fromClients);
+
+  // records every datagram to and from the clients in a pcap file, see
+  // PacketCapture. Call before open(), false if path can not be written.
+  bool startCapture(const std::string& path, uint64_t maxFileBytes = 0);
+
+  // called from recv() with the address of each connection that was reset
+  // by its client or timed out
+  void setClosedCallback(ServerConnectionPipe::ClosedCallback callback);
+  uint64_t getStat(PipeInterface::StatName stat) const;
+
 private:
-  UdpPipe udpPipe;
-  FakeLossPipe fakeLossPipe;
-  ServerConnectionPipe connectionPipe;
+  explicit QuicRServer(TransportPipe* transport);
+
+  // the chain owns them, firstPipe at the top
+  TransportPipe* transport;
+  ImpairmentPipe* impairmentPipe;
+  ServerConnectionPipe* connectionPipe;
+  StatsPipe* statsPipe;
   PipeInterface* firstPipe;
+  std::string metricsLabels; // removed from the registry with the chain
+
+  std::unique_ptr<PacketCapture> capture; // outlives the chain
 };
 
 } // namespace MediaNet
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <iostream>
 
 namespace MediaNet {
@@ -29,3 +30,9 @@ bool
 operator==(const ShortName&, const ShortName&);
 
 } // namespace MediaNet
+
+template<>
+struct std::hash<MediaNet::ShortName>
+{
+  size_t operator()(const MediaNet::ShortName& name) const noexcept;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "metrics.hh"
+#include "shortName.hh"
+
+namespace MediaNet {
+
+///
+/// Tracing
+///
+
+// Per stage latency of packets through the pipeline. Built with
+// -DTRACING=ON (which defines QUICR_TRACING), every packet carries a
+// PacketTrace that the pipes stamp with QUICR_TRACE() as it passes each
+// point below, and the end of each path hands the stamps to the
+// TraceRecorder. Without it QUICR_TRACE() compiles to nothing and packets
+// carry no trace.
+
+enum struct TracePoint : uint8_t
+{
+  // publish path
+  publish = 0, // QuicRClient::publish
+  sealed,      // EncryptPipe, after protect
+  fragmented,  // FragmentPipe
+  queued,      // PriorityPipe send queue
+  dequeued,    // PriorityPipe, taken by the pacer
+  sent,        // UdpPipe::send
+
+  // receive path
+  received,     // UdpPipe::recv
+  recvQueued,   // PriorityPipe receive queue
+  recvDequeued, // PriorityPipe::recv
+  reassembled,  // FragmentPipe, whole object
+  opened,       // EncryptPipe, after unprotect
+  delivered,    // QuicRClient::recv
+
+  count
+};
+
+// steady clock ns of each point passed, 0 for the ones not passed
+struct PacketTrace
+{
+  std::array<uint64_t, size_t(TracePoint::count)> ns{};
+
+  void stamp(TracePoint point) { ns[size_t(point)] = now(); }
+  [[nodiscard]] uint64_t at(TracePoint point) const
+  {
+    return ns[size_t(point)];
+  }
+
+  static uint64_t now()
+  {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+  }
+};
+
+///
+/// TraceRecorder
+///
+
+// Turns finished traces into a latency histogram per stage, registered as
+// quicr_stage_latency_ns{stage="..."}, and keeps the last maxRecords
+// traces for a Chrome trace-event dump (load it in chrome://tracing or
+// Perfetto). A stage is only recorded when both of its points were
+// stamped.
+class TraceRecorder
+{
+public:
+  struct Stage
+  {
+    const char* name;
+    TracePoint from;
+    TracePoint to;
+  };
+
+  explicit TraceRecorder(MetricsRegistry& registry);
+
+  // called at the end of the publish or receive path
+  void finish(const PacketTrace& trace, const ShortName& name);
+
+  // count, mean and percentiles per stage, as of now
+  void dumpText(std::ostream& out) const;
+  // the kept traces as a JSON array of complete ("X") events
+  void dumpChromeTrace(std::ostream& out) const;
+
+  static const std::vector<Stage>& stages();
+  static TraceRecorder& global();
+
+  static constexpr size_t maxRecords = 4096;
+
+private:
+  struct Record
+  {
+    PacketTrace trace;
+    ShortName name;
+  };
+
+  std::vector<Histogram*> histograms; // one per stages() entry
+
+  mutable std::mutex recordMutex;
+  std::vector<Record> records; // ring once full
+  size_t nextRecord;
+};
+
+} // namespace MediaNet
+
+#if defined(QUICR_TRACING)
+#define QUICR_TRACE(packet, point)                                             \
+  ((packet)->trace.stamp(MediaNet::TracePoint::point))
+#define QUICR_TRACE_FINISH(packet)                                             \
+  (MediaNet::TraceRecorder::global().finish((packet)->trace,                   \
+                                            (packet)->shortName()))
+#else
+#define QUICR_TRACE(packet, point) ((void)0)
+#define QUICR_TRACE_FINISH(packet) ((void)0)
+#endif
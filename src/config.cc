@@ -0,0 +1,277 @@
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "encryptPipe.hh"
+#include "quicr/config.hh"
+
+using namespace MediaNet;
+
+static std::string
+trim(const std::string& str)
+{
+  const char* space = " \t\r";
+  auto start = str.find_first_not_of(space);
+  if (start == std::string::npos) {
+    return std::string();
+  }
+  auto end = str.find_last_not_of(space);
+  return str.substr(start, end - start + 1);
+}
+
+static bool
+toBool(const std::string& value, bool& out)
+{
+  if (value == "true" || value == "on" || value == "1") {
+    out = true;
+    return true;
+  }
+  if (value == "false" || value == "off" || value == "0") {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+template<typename T>
+static bool
+toNumber(const std::string& value, T& out)
+{
+  try {
+    size_t used = 0;
+    long long num = std::stoll(value, &used);
+    if (used != value.size() || num < 0 ||
+        uint64_t(num) > uint64_t(std::numeric_limits<T>::max())) {
+      return false;
+    }
+    out = T(num);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+bool
+MediaNet::parseConfigFile(const std::string& path,
+                          const ConfigHandler& handler)
+{
+  std::ifstream file(path);
+  if (!file) {
+    std::clog << "config: can not open " << path << std::endl;
+    return false;
+  }
+
+  bool ok = true;
+  int lineNum = 0;
+  std::string line;
+  while (std::getline(file, line)) {
+    lineNum++;
+
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    line = trim(line);
+    if (line.empty()) {
+      continue;
+    }
+
+    auto equals = line.find('=');
+    if (equals == std::string::npos) {
+      std::clog << path << ":" << lineNum << ": expected key = value"
+                << std::endl;
+      ok = false;
+      continue;
+    }
+
+    auto key = trim(line.substr(0, equals));
+    auto value = trim(line.substr(equals + 1));
+    if (!handler(key, value)) {
+      std::clog << path << ":" << lineNum << ": bad setting " << key << " = "
+                << value << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+static bool
+toPerMillion(const std::string& value, uint32_t& out)
+{
+  return toNumber(value, out) && out <= 1000000;
+}
+
+// key is what follows "impairUp." or "impairDown."
+static bool
+setImpairment(const std::string& key,
+              const std::string& value,
+              ImpairmentConfig& config)
+{
+  if (key == "bitrateBps") {
+    return toNumber(value, config.bitrateBps);
+  }
+  if (key == "queueBytes") {
+    return toNumber(value, config.queueBytes);
+  }
+  if (key == "delayMs") {
+    return toNumber(value, config.delayMs);
+  }
+  if (key == "jitterMs") {
+    return toNumber(value, config.jitterMs);
+  }
+  if (key == "goodToBadPerMillion") {
+    return toPerMillion(value, config.goodToBadPerMillion);
+  }
+  if (key == "badToGoodPerMillion") {
+    return toPerMillion(value, config.badToGoodPerMillion);
+  }
+  if (key == "lossGoodPerMillion") {
+    return toPerMillion(value, config.lossGoodPerMillion);
+  }
+  if (key == "lossBadPerMillion") {
+    return toPerMillion(value, config.lossBadPerMillion);
+  }
+  if (key == "reorderPerMillion") {
+    return toPerMillion(value, config.reorderPerMillion);
+  }
+  if (key == "reorderMs") {
+    return toNumber(value, config.reorderMs);
+  }
+  if (key == "duplicatePerMillion") {
+    return toPerMillion(value, config.duplicatePerMillion);
+  }
+  if (key == "seed") {
+    return toNumber(value, config.seed);
+  }
+  return false;
+}
+
+// a key of ClientConfig, false if not one or its value can not be used
+static bool
+setClientKey(const std::string& key,
+             const std::string& value,
+             ClientConfig& config)
+{
+  const std::string up = "impairUp.";
+  const std::string down = "impairDown.";
+  if (key.compare(0, up.size(), up) == 0) {
+    return setImpairment(key.substr(up.size()), value, config.impairUp);
+  }
+  if (key.compare(0, down.size(), down) == 0) {
+    return setImpairment(key.substr(down.size()), value, config.impairDown);
+  }
+  if (key == "spinBit") {
+    return toBool(value, config.spinBit);
+  }
+  if (key == "fec") {
+    return toBool(value, config.fec);
+  }
+  if (key == "retransmit") {
+    return toBool(value, config.retransmit);
+  }
+  if (key == "mtu") {
+    uint16_t mtu = 0;
+    if (!toNumber(value, mtu) || mtu < ClientConfig::minMtu ||
+        mtu > ClientConfig::maxMtu) {
+      return false;
+    }
+    config.mtu = mtu;
+    return true;
+  }
+  if (key == "pps") {
+    return toNumber(value, config.pps);
+  }
+  if (key == "minRttMs") {
+    return toNumber(value, config.minRttMs);
+  }
+  if (key == "bigRttMs") {
+    return toNumber(value, config.bigRttMs);
+  }
+  if (key == "sendQueueDepth") {
+    size_t depth = 0;
+    if (!toNumber(value, depth) || depth == 0) {
+      return false;
+    }
+    config.sendQueueDepth = depth;
+    return true;
+  }
+  if (key == "cryptoThreads") {
+    int threads = 0;
+    if (!toNumber(value, threads) ||
+        threads > EncryptPipe::maxCryptoThreads) {
+      return false;
+    }
+    config.cryptoThreads = threads;
+    return true;
+  }
+  if (key == "jitterMinMs") {
+    return toNumber(value, config.jitterMinMs);
+  }
+  if (key == "jitterMaxMs") {
+    return toNumber(value, config.jitterMaxMs);
+  }
+  if (key == "wireTimestamps") {
+    return toBool(value, config.wireTimestamps);
+  }
+  if (key == "hardwareTimestamps") {
+    return toBool(value, config.hardwareTimestamps);
+  }
+  return false;
+}
+
+// a key of RelayConfig, as setClientKey
+static bool
+setRelayKey(const std::string& key,
+            const std::string& value,
+            RelayConfig& config)
+{
+  if (key == "relayPort") {
+    return toNumber(value, config.relayPort);
+  }
+  if (key == "metricsPort") {
+    return toNumber(value, config.metricsPort);
+  }
+  if (key == "capture") {
+    config.capture = value;
+    return true;
+  }
+  if (key == "captureFileBytes") {
+    return toNumber(value, config.captureFileBytes);
+  }
+  return false;
+}
+
+bool
+MediaNet::loadConfig(const std::string& path,
+                     ClientConfig& client,
+                     RelayConfig& relay)
+{
+  bool ok = parseConfigFile(
+    path,
+    [&client, &relay](const std::string& key, const std::string& value) {
+      return setClientKey(key, value, client) ||
+             setRelayKey(key, value, relay);
+    });
+
+  if (client.jitterMinMs > client.jitterMaxMs) {
+    std::clog << path << ": jitterMinMs is over jitterMaxMs" << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+
+bool
+MediaNet::loadClientConfig(const std::string& path, ClientConfig& config)
+{
+  RelayConfig unused;
+  return loadConfig(path, config, unused);
+}
+
+bool
+MediaNet::loadRelayConfig(const std::string& path, RelayConfig& config)
+{
+  ClientConfig unused;
+  return loadConfig(path, unused, config);
+}
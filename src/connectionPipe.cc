@@ -1,5 +1,4 @@
 #include <cassert>
-#include <random>
 
 #include "connectionPipe.hh"
 #include "encode.hh"
@@ -19,8 +18,11 @@ bool ConnectionPipe::start(const uint16_t port, const std::string& server,
 bool
 ConnectionPipe::ready() const
 {
-  if (!std::holds_alternative<Connected>(state)) {
-    return false;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (!std::holds_alternative<Connected>(state)) {
+      return false;
+    }
   }
   return PipeInterface::ready();
 }
@@ -28,9 +30,14 @@ ConnectionPipe::ready() const
 void
 ConnectionPipe::stop()
 {
-  state = Start{};
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    state = Start{};
+  }
+  // a header for the path token, and the tag the server looks at
   auto packet = std::make_unique<Packet>();
   assert(packet);
+  packet << Packet::Header(PacketTag::headerRst);
   packet << PacketTag::headerRst;
   std::clog << "ConnectionPipe:Stop: Reset: " << packet->to_hex() << std::endl;
   send(move(packet));
@@ -76,6 +83,7 @@ ClientConnectionPipe::recv()
     NetSyncAck syncAck{};
     packet >> syncAck;
 
+    std::lock_guard<std::mutex> lock(stateMutex);
     state = Connected{};
     // don't need to report syncAck up in the chain
     return nullptr;
@@ -84,7 +92,10 @@ ClientConnectionPipe::recv()
     packet >> rstRetry;
     std::clog << "ConnectionPipe: Got resetRetry: cookie " << rstRetry.cookie
               << std::endl;
-    cookie = rstRetry.cookie;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      cookie = rstRetry.cookie;
+    }
     sendSync();
     return nullptr;
   }
@@ -93,20 +104,34 @@ ClientConnectionPipe::recv()
 }
 
 void ClientConnectionPipe::runUpdates(const std::chrono::time_point<std::chrono::steady_clock>& now) {
-  // verify if time expired since last sync point
-  auto expended = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_sync_point).count();
-	if (expended >= syn_timeout_msec) {
-		if (std::holds_alternative<ConnectionPending>(state)) {
-			if (syncs_awaiting_response >= max_connection_retry_cnt) {
-				stop();
-				return;
-			}
-			syncs_awaiting_response++;
-			return;
-		}
-		// trigger new sync point
-		sendSync();
-	}
+  // the stages below, such as ImpairmentPipe, have timers of their own
+  PipeInterface::runUpdates(now);
+
+  bool giveUp = false;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    // verify if time expired since last sync point
+    auto expended = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      now - last_sync_point)
+                      .count();
+    if (expended < syn_timeout_msec) {
+      return;
+    }
+    if (std::holds_alternative<ConnectionPending>(state)) {
+      if (syncs_awaiting_response < max_connection_retry_cnt) {
+        syncs_awaiting_response++;
+        return;
+      }
+      giveUp = true;
+    }
+  }
+
+  if (giveUp) {
+    stop();
+    return;
+  }
+  // trigger new sync point
+  sendSync();
 }
 
 void ClientConnectionPipe::setAuthInfo(uint32_t sender, uint64_t token_in) {
@@ -124,19 +149,23 @@ ClientConnectionPipe::sendSync()
   packet << header;
   NetSyncReq synReq{};
   const auto now = std::chrono::steady_clock::now();
-	last_sync_point = now;
   const auto duration = now.time_since_epoch();
   synReq.clientTimeMs =
       std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
   synReq.senderId = senderID;
   synReq.supportedFeaturesVec = 1;
-  synReq.cookie = cookie;
   synReq.origin = "example.com";
+  {
+    // pending before it goes, the syncAck can be back before send returns
+    std::lock_guard<std::mutex> lock(stateMutex);
+    last_sync_point = now;
+    synReq.cookie = cookie;
+    state = ConnectionPending{};
+  }
   // std::clog << "syncConnection: cookie:" << synReq.cookie << std::endl;
   packet << synReq;
   // std::clog <<"sync Packet: " << packet->to_hex() << std::endl;
   send(move(packet));
-  state = ConnectionPending{};
 }
 
 ///
@@ -144,19 +173,12 @@ ClientConnectionPipe::sendSync()
 ///
 bool dont_send_sync_ack = false;
 
-ServerConnectionPipe::Connection::Connection(uint32_t relaySeq,
-                                             uint64_t cookie_in)
-  : relaySeqNum(relaySeq)
-  , cookie(cookie_in)
-{}
-
 ServerConnectionPipe::ServerConnectionPipe(PipeInterface* t)
   : ConnectionPipe(t)
-{
-  std::random_device randDev;
-  randomGen.seed(randDev()); // TODO - should use crypto random
-  getRandom = std::bind(randomDist, randomGen);
-}
+  , idleTimers(std::chrono::milliseconds(idle_tick_msec),
+               idle_wheel_slots,
+               std::chrono::steady_clock::now())
+{}
 
 bool ServerConnectionPipe::start(uint16_t port, const std::string& server,
                                  PipeInterface *upStream) {
@@ -171,35 +193,50 @@ bool
 ServerConnectionPipe::send(std::unique_ptr<Packet> packet)
 {
   // insert path token
-  packet->setPathToken(pathTokens.at(packet->getDst()));
+  auto con = connections.find(packet->getDst());
+  if (con) {
+    packet->setPathToken(con->pathToken);
+  }
   return ConnectionPipe::send(std::move(packet));
 }
 
+void
+ServerConnectionPipe::runUpdates(const timepoint& now)
+{
+  expireIdle(now);
+  PipeInterface::runUpdates(now);
+}
+
 std::unique_ptr<Packet>
 ServerConnectionPipe::recv()
 {
   auto packet = PipeInterface::recv();
+
+  auto now = std::chrono::steady_clock::now();
+  expireIdle(now);
+
   if (packet == nullptr) {
     return packet;
   }
 
-  auto token = packet->getPathToken();
-  auto it = pathTokens.find(packet->getSrc());
-  if (it != pathTokens.end()) {
-    if (token != it->second) {
-      std::clog << IpAddr::toString(packet->getSrc()) << " token changed\n";
-    }
-  }
-
-  // overwrite by default
-  pathTokens[packet->getSrc()] = token;
-
   auto tag = nextTag(packet);
 
   if (tag == PacketTag::sync) {
-    processSyn(packet);
+    processSyn(packet, now);
     return nullptr;
-  } else if (tag == PacketTag::headerRst) {
+  }
+
+  auto con = connections.find(packet->getSrc());
+  if (con) {
+    auto token = packet->getPathToken();
+    if (token != con->pathToken) {
+      std::clog << IpAddr::toString(packet->getSrc()) << " token changed\n";
+      con->pathToken = token;
+    }
+    con->lastSeen = now;
+  }
+
+  if (tag == PacketTag::headerRst) {
     processRst(packet);
     return nullptr;
   }
@@ -209,64 +246,42 @@ ServerConnectionPipe::recv()
 }
 
 void
-ServerConnectionPipe::processSyn(std::unique_ptr<MediaNet::Packet>& packet)
+ServerConnectionPipe::processSyn(std::unique_ptr<MediaNet::Packet>& packet,
+                                 const timepoint& now)
 {
-  std::clog << "Got a Syn"
-            << " from=" << IpAddr::toString(packet->getSrc())
-            << " len=" << packet->fullSize() << std::endl;
-
+  auto token = packet->getPathToken();
   NetSyncReq sync = {};
   packet >> sync;
 
-  auto conIndex = connectionMap.find(packet->getSrc());
-  if (conIndex != connectionMap.end()) {
+  auto con = connections.find(packet->getSrc());
+  if (con) {
     // existing connection
-    std::unique_ptr<Connection>& con = connectionMap[packet->getSrc()];
-    con->lastSyn = std::chrono::steady_clock::now();
+    con->pathToken = token;
+    con->lastSeen = now;
     sendSyncAck(packet->getSrc(), {});
     return;
   }
 
-  // new connection or retry with cookie
-  auto it = cookies.find(packet->getSrc());
-  if (it == cookies.end()) {
+  // new connection, nothing is stored until the cookie comes back
+  if (!retryCookie.verify(packet->getSrc(), sync.cookie, now)) {
     // send a reset with retry cookie
-    auto cookie = random();
-    cookies.emplace(packet->getSrc(),
-                    std::make_tuple(std::chrono::steady_clock::now(), cookie));
-
     auto rstPkt = std::make_unique<Packet>();
-    auto header =
-      Packet::Header(PacketTag::headerRst, pathTokens.at(packet->getSrc()));
+    auto header = Packet::Header(PacketTag::headerRst, token);
     NetResetRetry rstRetry{};
-    rstRetry.cookie = cookie;
+    rstRetry.cookie = retryCookie.make(packet->getSrc(), now);
     rstPkt << header;
     rstPkt << rstRetry;
     rstPkt->setDst(packet->getSrc());
-    std::clog << "new connection attempt, generate cookie:" << cookie
-              << std::endl;
-    send(std::move(rstPkt));
-    return;
-  }
-
-  // cookie exists, verify it matches
-  auto& [when, cookie] = it->second;
-  // TODO: verify now() - when is within in acceptable limits
-  if (sync.cookie != cookie) {
-    // bad cookie, reset the connection
-    auto rstPkt = std::make_unique<Packet>();
-    rstPkt << PacketTag::headerRst;
-    rstPkt->setDst(packet->getSrc());
-    std::clog << "incorrect cookie: found:" << sync.cookie
-              << ", expected:" << cookie << std::endl;
     send(std::move(rstPkt));
     return;
   }
 
   // good sync new connection
-  connectionMap[packet->getSrc()] =
-    std::make_unique<Connection>(getRandom(), cookie);
-  cookies.erase(it);
+  auto& newCon = connections.insert(packet->getSrc(), now);
+  newCon.pathToken = token;
+  idleTimers.schedule(IdleTimer{ packet->getSrc(), newCon.id },
+                      now + std::chrono::milliseconds(idle_timeout_msec));
+  reportConnections();
   std::clog << "Added connection:"
             << MediaNet::IpAddr::toString(packet->getSrc()) << std::endl;
   sendSyncAck(packet->getSrc(), {});
@@ -275,14 +290,68 @@ ServerConnectionPipe::processSyn(std::unique_ptr<MediaNet::Packet>& packet)
 void
 ServerConnectionPipe::processRst(std::unique_ptr<MediaNet::Packet>& packet)
 {
-  auto conIndex = connectionMap.find(packet->getSrc());
-  if (conIndex == connectionMap.end()) {
+  if (!connections.find(packet->getSrc())) {
     std::clog << "Reset receieved for unknown connection\n";
     return;
   }
-  connectionMap.erase(conIndex);
   std::clog << "Reset recieved for connection: "
             << IpAddr::toString(packet->getSrc()) << "\n";
+  closeConnection(packet->getSrc());
+}
+
+void
+ServerConnectionPipe::setClosedCallback(ClosedCallback callback)
+{
+  closedCallback = std::move(callback);
+}
+
+void
+ServerConnectionPipe::expireIdle(const timepoint& now)
+{
+  idleTimers.advance(now,
+                     [this, &now](const IdleTimer& timer) {
+                       processIdle(timer, now);
+                     });
+}
+
+void
+ServerConnectionPipe::processIdle(const IdleTimer& timer, const timepoint& now)
+{
+  auto con = connections.find(timer.remote);
+  if (!con || con->id != timer.id) {
+    // reset and maybe reconnected since, that has its own timer
+    return;
+  }
+
+  auto idleTime = std::chrono::milliseconds(idle_timeout_msec);
+  if (now - con->lastSeen < idleTime) {
+    idleTimers.schedule(timer, con->lastSeen + idleTime);
+    return;
+  }
+
+  std::clog << "Connection idle, removing: "
+            << IpAddr::toString(timer.remote) << "\n";
+  expiredCount++;
+  closeConnection(timer.remote);
+}
+
+// the one way out for a connection, so the app always hears of it
+void
+ServerConnectionPipe::closeConnection(const MediaNet::IpAddr& remote)
+{
+  connections.erase(remote);
+  reportConnections();
+
+  if (closedCallback) {
+    closedCallback(remote);
+  }
+}
+
+void
+ServerConnectionPipe::reportConnections()
+{
+  updateStat(StatName::connectionsActive, connections.size());
+  updateStat(StatName::connectionsExpired, expiredCount);
 }
 
 void
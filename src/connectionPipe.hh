@@ -4,12 +4,15 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <random>
 #include <string>
 #include <variant>
 
+#include "connectionTable.hh"
 #include "pipeInterface.hh"
+#include "retryCookie.hh"
+#include "timerWheel.hh"
 #include "quicr/packet.hh"
 
 namespace MediaNet {
@@ -45,6 +48,7 @@ protected:
   {};
   using State = std::variant<Start, ConnectionPending, Connected>;
 
+  mutable std::mutex stateMutex; // the receive and timer threads both move it
   State state = Start{};
 };
 
@@ -86,37 +90,46 @@ class ServerConnectionPipe : public ConnectionPipe
   using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
 
 public:
-  class Connection
-  {
-  public:
-    Connection(uint32_t relaySeq, uint64_t cookie_in);
-    uint32_t relaySeqNum;
-    uint64_t cookie;
-    timepoint lastSyn;
-  };
-
   explicit ServerConnectionPipe(PipeInterface *t);
   bool start(uint16_t port, const std::string& server,
              PipeInterface *upStream) override;
   // Overrides from PipelineInterface
   bool send(std::unique_ptr<Packet>) override;
   std::unique_ptr<Packet> recv() override;
+  // expires idle connections, which recv() also does as it goes
+  void runUpdates(const timepoint& now) override;
+
+  // called from recv() when a connection is gone, reset by the client or
+  // idle too long
+  using ClosedCallback = std::function<void(const MediaNet::IpAddr&)>;
+  void setClosedCallback(ClosedCallback callback);
 
 private:
-  void processSyn(std::unique_ptr<MediaNet::Packet>& packet);
+  struct IdleTimer
+  {
+    MediaNet::IpAddr remote;
+    uint32_t id;
+  };
+
+  void processSyn(std::unique_ptr<MediaNet::Packet>& packet,
+                  const timepoint& now);
   void processRst(std::unique_ptr<MediaNet::Packet>& packet);
   void sendSyncAck(const MediaNet::IpAddr& to, uint32_t authSecret);
-
-  // TODO: need to timeout on the entries in this map to
-  // avoid DOS attacks
-  std::map<MediaNet::IpAddr, std::tuple<timepoint, uint32_t>> cookies;
-  std::map<MediaNet::IpAddr, std::unique_ptr<Connection>> connectionMap;
-  std::map<MediaNet::IpAddr, uint32_t> pathTokens;
-
-  // TODO revisit this (use cryptographic random)
-  std::mt19937 randomGen;
-  std::uniform_int_distribution<uint32_t> randomDist;
-  std::function<uint32_t()> getRandom;
+  void expireIdle(const timepoint& now);
+  void processIdle(const IdleTimer& timer, const timepoint& now);
+  void closeConnection(const MediaNet::IpAddr& remote);
+  void reportConnections();
+
+  // clients sync every second while connected
+  static constexpr int idle_timeout_msec = 10 * 1000;
+  static constexpr int idle_tick_msec = 100;
+  static constexpr size_t idle_wheel_slots = 128;
+
+  ConnectionTable connections;
+  RetryCookie retryCookie;
+  TimerWheel<IdleTimer> idleTimers;
+  ClosedCallback closedCallback;
+  uint64_t expiredCount = 0;
 };
 
 } // namespace MediaNet
\ No newline at end of file
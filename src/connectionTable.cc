@@ -0,0 +1,136 @@
+#include <cassert>
+#include <random>
+
+#include "connectionTable.hh"
+
+using namespace MediaNet;
+
+ConnectionTable::ConnectionTable(size_t initialCapacity)
+  : count(0)
+  , nextId(0)
+{
+  size_t cap = 16;
+  while (cap < initialCapacity) {
+    cap *= 2;
+  }
+  slots.resize(cap, Connection{});
+  mask = cap - 1;
+
+  std::random_device randDev;
+  hashSeed = (uint64_t(randDev()) << 32) | randDev();
+}
+
+ConnectionTable::Connection*
+ConnectionTable::find(const IpAddr& remote)
+{
+  size_t slot = findSlot(remote.addr.sin_addr.s_addr, remote.addr.sin_port);
+  if (slots[slot].state == State::free) {
+    return nullptr;
+  }
+  return &slots[slot];
+}
+
+ConnectionTable::Connection&
+ConnectionTable::insert(const IpAddr& remote, const timepoint& now)
+{
+  uint32_t addr = remote.addr.sin_addr.s_addr;
+  uint16_t port = remote.addr.sin_port;
+
+  size_t slot = findSlot(addr, port);
+  if (slots[slot].state != State::free) {
+    return slots[slot];
+  }
+
+  if ((count + 1) * 100 > slots.size() * maxLoadPercent) {
+    grow();
+    slot = findSlot(addr, port);
+  }
+
+  Connection& con = slots[slot];
+  con = Connection{};
+  con.addr = addr;
+  con.port = port;
+  con.state = State::connected;
+  con.id = nextId++;
+  con.lastSeen = now;
+  count++;
+
+  return con;
+}
+
+bool
+ConnectionTable::erase(const IpAddr& remote)
+{
+  size_t slot = findSlot(remote.addr.sin_addr.s_addr, remote.addr.sin_port);
+  if (slots[slot].state == State::free) {
+    return false;
+  }
+  eraseSlot(slot);
+  return true;
+}
+
+///
+/// Private Implementation
+///
+
+size_t
+ConnectionTable::home(uint32_t addr, uint16_t port) const
+{
+  // murmur3 finalizer
+  uint64_t h = ((uint64_t(addr) << 16) | port) ^ hashSeed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return size_t(h) & mask;
+}
+
+size_t
+ConnectionTable::findSlot(uint32_t addr, uint16_t port) const
+{
+  size_t slot = home(addr, port);
+  while (true) {
+    const Connection& con = slots[slot];
+    if (con.state == State::free || (con.addr == addr && con.port == port)) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+}
+
+void
+ConnectionTable::eraseSlot(size_t slot)
+{
+  assert(slots[slot].state != State::free);
+  count--;
+
+  // backward shift delete: pull later entries of the same probe run back
+  // into the hole unless that would move them in front of their home slot
+  size_t hole = slot;
+  size_t next = (hole + 1) & mask;
+  while (slots[next].state != State::free) {
+    size_t want = home(slots[next].addr, slots[next].port);
+    if (((next - want) & mask) >= ((next - hole) & mask)) {
+      slots[hole] = slots[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  slots[hole].state = State::free;
+}
+
+void
+ConnectionTable::grow()
+{
+  std::vector<Connection> old(slots.size() * 2, Connection{});
+  old.swap(slots);
+  mask = slots.size() - 1;
+
+  for (const auto& con : old) {
+    if (con.state == State::free) {
+      continue;
+    }
+    slots[findSlot(con.addr, con.port)] = con;
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "quicr/packet.hh"
+
+namespace MediaNet {
+
+///
+/// ConnectionTable
+///
+
+// Open addressing hash table of the connections a server knows about, keyed
+// by the remote address and port. Linear probing over a flat array of
+// records keeps a lookup to one or two cache lines at low load, and deletes
+// shift entries back so no tombstones build up.
+class ConnectionTable
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  enum struct State : uint8_t
+  {
+    free = 0,
+    connected
+  };
+
+  struct Connection
+  {
+    uint32_t addr; // network byte order
+    uint16_t port; // network byte order
+    State state;
+    uint32_t pathToken;
+    uint32_t id; // new for each insert, stale idle timers check it
+    timepoint lastSeen;
+  };
+
+  explicit ConnectionTable(size_t initialCapacity = 64);
+
+  // pointers are valid until the next insert or erase
+  Connection* find(const IpAddr& remote);
+  // returns the existing record or a new connected one
+  Connection& insert(const IpAddr& remote, const timepoint& now);
+  bool erase(const IpAddr& remote);
+
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t capacity() const { return slots.size(); }
+
+private:
+  static constexpr size_t maxLoadPercent = 50;
+
+  [[nodiscard]] size_t home(uint32_t addr, uint16_t port) const;
+  [[nodiscard]] size_t findSlot(uint32_t addr, uint16_t port) const;
+  void eraseSlot(size_t slot);
+  void grow();
+
+  std::vector<Connection> slots;
+  size_t mask;
+  size_t count;
+  uint32_t nextId;
+  uint64_t hashSeed; // so remote peers can not pick colliding addresses
+};
+
+} // namespace MediaNet
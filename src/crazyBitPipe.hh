@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
@@ -8,6 +10,54 @@
 
 namespace MediaNet {
 
+// Flips the spin bit once per RTT on the way out and clears it on the way
+// in. CrazyBitPipe and CrazyBitStage both keep their state in one.
+class SpinBit
+{
+public:
+  SpinBit()
+    : rttMs(100)
+    , spinBitVal(false)
+    , lastSpinTimeMs(nowMs())
+  {}
+
+  void mark(Packet& packet)
+  {
+    uint32_t now = nowMs();
+    if (now > lastSpinTimeMs + rttMs) {
+      spinBitVal = !spinBitVal;
+      lastSpinTimeMs = now;
+    }
+
+    if (spinBitVal) {
+      assert(packet.fullSize() >= 1);
+      packet.fullData() |= 0x01; // set the spin bit
+    }
+  }
+
+  static void clear(Packet& packet)
+  {
+    // clear the spin bit in first byte of incoming packet
+    assert(packet.fullSize() >= 1);
+    packet.fullData() &= 0xFE;
+  }
+
+  void setRtt(uint16_t minRttMs) { rttMs = minRttMs; }
+  [[nodiscard]] bool value() const { return spinBitVal; }
+
+private:
+  static uint32_t nowMs()
+  {
+    auto dn = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(dn)
+      .count();
+  }
+
+  uint16_t rttMs;
+  bool spinBitVal;
+  uint32_t lastSpinTimeMs;
+};
+
 class CrazyBitPipe : public PipeInterface
 {
 public:
@@ -22,9 +72,7 @@ public:
     override; // tells downstream things the current RTT
 
 private:
-  uint16_t rttMs;
-  bool spinBitVal;
-  uint32_t lastSpinTimeMs;
+  SpinBit spinBit;
 };
 
 } // namespace MediaNet
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cassert>
+
+#include "cryptoWorkerPool.hh"
+
+using namespace MediaNet;
+
+CryptoWorkerPool::CryptoWorkerPool(int numWorkers, Work w)
+  : work(std::move(w))
+  , workerStats(numWorkers)
+  , lastStats(std::chrono::steady_clock::now())
+  , shutDown(false)
+{
+  assert(numWorkers > 0);
+  assert(work);
+  for (int i = 0; i < numWorkers; i++) {
+    threads.emplace_back([this, i]() { this->runWorker(i); });
+  }
+}
+
+CryptoWorkerPool::~CryptoWorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shutDown = true;
+  }
+  jobReady.notify_all();
+  spaceReady.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void
+CryptoWorkerPool::setSink(Lane lane, Sink sink)
+{
+  setSink(lane, [sink = std::move(sink)](Batch& packets) {
+    for (auto& packet : packets) {
+      sink(std::move(packet));
+    }
+  });
+}
+
+void
+CryptoWorkerPool::setSink(Lane lane, BatchSink sink)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  lanes[int(lane)].sink = std::move(sink);
+}
+
+void
+CryptoWorkerPool::setNotify(Lane lane, Notify notify)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  lanes[int(lane)].notify = std::move(notify);
+}
+
+void
+CryptoWorkerPool::submit(Lane laneId, std::unique_ptr<Packet> packet)
+{
+  assert(packet);
+  std::unique_lock<std::mutex> lock(mutex);
+  LaneState& lane = lanes[int(laneId)];
+
+  // a lane without a sink only drains through pop() on this same thread
+  if (lane.sink) {
+    spaceReady.wait(
+      lock, [&]() { return shutDown || lane.slots.size() < maxPending; });
+  }
+
+  lane.slots.push_back(Slot{ false, nullptr });
+  jobs.push_back(Job{ laneId, lane.nextSeq++, std::move(packet) });
+  lock.unlock();
+  jobReady.notify_one();
+}
+
+void
+CryptoWorkerPool::submitBatch(Lane laneId, Batch& packets)
+{
+  if (packets.empty()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  LaneState& lane = lanes[int(laneId)];
+
+  if (lane.sink) {
+    spaceReady.wait(
+      lock, [&]() { return shutDown || lane.slots.size() < maxPending; });
+  }
+
+  for (auto& packet : packets) {
+    assert(packet);
+    lane.slots.push_back(Slot{ false, nullptr });
+    jobs.push_back(Job{ laneId, lane.nextSeq++, std::move(packet) });
+  }
+  lock.unlock();
+  packets.clear();
+  jobReady.notify_all();
+}
+
+std::unique_ptr<Packet>
+CryptoWorkerPool::pop(Lane laneId)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  LaneState& lane = lanes[int(laneId)];
+  assert(!lane.sink);
+
+  while (!lane.slots.empty() && lane.slots.front().done) {
+    auto packet = std::move(lane.slots.front().packet);
+    lane.slots.pop_front();
+    lane.headSeq++;
+    if (packet) {
+      return packet;
+    }
+  }
+  return nullptr;
+}
+
+bool
+CryptoWorkerPool::full(Lane laneId) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return lanes[int(laneId)].slots.size() >= maxPending;
+}
+
+CryptoWorkerPool::Stats
+CryptoWorkerPool::stats()
+{
+  auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats stats{};
+  stats.queueDepth = jobs.size();
+  stats.reorderDepth =
+    lanes[0].slots.size() + lanes[1].slots.size() - jobs.size();
+
+  auto elapsed = now - lastStats;
+  lastStats = now;
+
+  for (auto& worker : workerStats) {
+    auto busy = worker.busy - worker.reportedBusy;
+    worker.reportedBusy = worker.busy;
+
+    uint32_t percent = 0;
+    if (elapsed.count() > 0) {
+      percent = uint32_t(std::min<int64_t>(100, busy * 100 / elapsed));
+    }
+    stats.workers.push_back(
+      WorkerStats{ worker.packets, worker.batches, percent });
+  }
+  return stats;
+}
+
+///
+/// Private Implementation
+///
+
+void
+CryptoWorkerPool::runWorker(int worker)
+{
+  std::vector<Job> batch;
+  batch.reserve(maxBatch);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    jobReady.wait(lock, [this]() { return shutDown || !jobs.empty(); });
+    if (jobs.empty()) {
+      return; // shut down with nothing left to do
+    }
+
+    // leave some of a short queue for the other workers
+    size_t numWorkers = workerStats.size();
+    size_t take = (jobs.size() + numWorkers - 1) / numWorkers;
+    take = std::min(take, maxBatch);
+    for (size_t i = 0; i < take; i++) {
+      batch.push_back(std::move(jobs.front()));
+      jobs.pop_front();
+    }
+    lock.unlock();
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& job : batch) {
+      if (!work(worker, job.lane, job.packet)) {
+        job.packet.reset();
+      }
+    }
+    auto busy = std::chrono::steady_clock::now() - start;
+
+    lock.lock();
+    complete(worker, batch, busy, lock);
+    batch.clear();
+  }
+}
+
+void
+CryptoWorkerPool::complete(int worker,
+                           std::vector<Job>& batch,
+                           std::chrono::nanoseconds busy,
+                           std::unique_lock<std::mutex>& lock)
+{
+  Worker& stats = workerStats[worker];
+  stats.packets += batch.size();
+  stats.batches++;
+  stats.busy += busy;
+
+  bool touched[2] = { false, false };
+  for (auto& job : batch) {
+    LaneState& lane = lanes[int(job.lane)];
+    Slot& slot = lane.slots[job.seq - lane.headSeq];
+    slot.done = true;
+    slot.packet = std::move(job.packet);
+    touched[int(job.lane)] = true;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    if (touched[i] && lanes[i].sink) {
+      deliver(lanes[i], lock);
+    } else if (touched[i] && lanes[i].notify) {
+      lanes[i].notify();
+    }
+  }
+}
+
+// Hands the done prefix of the reorder buffer to the sink. Only one thread
+// delivers at a time; one that finishes work meanwhile just leaves its
+// results for the deliverer, which checks the head again before it stops.
+void
+CryptoWorkerPool::deliver(LaneState& lane, std::unique_lock<std::mutex>& lock)
+{
+  if (lane.delivering) {
+    return;
+  }
+  lane.delivering = true;
+
+  Batch ready;
+  while (true) {
+    while (!lane.slots.empty() && lane.slots.front().done) {
+      auto packet = std::move(lane.slots.front().packet);
+      lane.slots.pop_front();
+      lane.headSeq++;
+      if (packet) {
+        ready.push_back(std::move(packet));
+      }
+    }
+    if (ready.empty()) {
+      break;
+    }
+
+    lock.unlock();
+    spaceReady.notify_all();
+    lane.sink(ready);
+    ready.clear();
+    lock.lock();
+  }
+
+  lane.delivering = false;
+  spaceReady.notify_all();
+}
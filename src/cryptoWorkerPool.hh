@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "quicr/packet.hh"
+
+namespace MediaNet {
+
+///
+/// CryptoWorkerPool
+///
+
+// Runs packet crypto on a set of worker threads. Packets are submitted to
+// one of two lanes, protect for the publish path and unprotect for the
+// receive path, and each lane hands its results on in the order they were
+// submitted no matter which worker finished first. Workers take a run of
+// consecutive packets per wakeup so the fragments of one object mostly stay
+// together and the queue lock is taken once per batch, not per packet.
+class CryptoWorkerPool
+{
+public:
+  enum struct Lane : uint8_t
+  {
+    protect = 0,
+    unprotect,
+  };
+
+  // runs on worker thread number worker, returns false to drop the packet
+  using Work =
+    std::function<bool(int worker, Lane lane, std::unique_ptr<Packet>& packet)>;
+  using Sink = std::function<void(std::unique_ptr<Packet> packet)>;
+  using Batch = std::vector<std::unique_ptr<Packet>>;
+  using BatchSink = std::function<void(Batch& packets)>;
+  using Notify = std::function<void()>;
+
+  struct WorkerStats
+  {
+    uint64_t packets;
+    uint64_t batches;
+    uint32_t utilizationPercent; // busy time since the previous stats()
+  };
+
+  struct Stats
+  {
+    size_t queueDepth;   // waiting for a worker
+    size_t reorderDepth; // done or in progress but not yet handed on
+    std::vector<WorkerStats> workers;
+  };
+
+  CryptoWorkerPool(int numWorkers, Work work);
+  // finishes the queued work before the workers exit
+  ~CryptoWorkerPool();
+
+  // results of the lane are passed to sink instead of waiting for pop(),
+  // the calls are serialized but can come from any worker thread
+  void setSink(Lane lane, Sink sink);
+  // same, with each run of results that became ready together
+  void setSink(Lane lane, BatchSink sink);
+
+  // called from a worker, with the pool locked, each time results of a
+  // lane without a sink become ready for pop()
+  void setNotify(Lane lane, Notify notify);
+
+  // blocks while the lane has maxPending packets outstanding and a sink
+  void submit(Lane lane, std::unique_ptr<Packet> packet);
+  // takes all the packets under one lock, the lane can go over
+  // maxPending by one batch
+  void submitBatch(Lane lane, Batch& packets);
+
+  // next result of a lane without a sink, nullptr if it is not done yet
+  std::unique_ptr<Packet> pop(Lane lane);
+
+  [[nodiscard]] bool full(Lane lane) const;
+  [[nodiscard]] int size() const { return int(threads.size()); }
+
+  Stats stats();
+
+  static constexpr size_t maxBatch = 16;
+  static constexpr size_t maxPending = 1024;
+
+private:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  struct Job
+  {
+    Lane lane;
+    uint64_t seq;
+    std::unique_ptr<Packet> packet;
+  };
+
+  struct Slot
+  {
+    bool done;
+    std::unique_ptr<Packet> packet; // null when the work dropped it
+  };
+
+  struct LaneState
+  {
+    uint64_t nextSeq = 0;
+    uint64_t headSeq = 0;    // seq of slots.front()
+    std::deque<Slot> slots; // reorder buffer in submission order
+    BatchSink sink;
+    Notify notify;
+    bool delivering = false;
+  };
+
+  struct Worker
+  {
+    uint64_t packets = 0;
+    uint64_t batches = 0;
+    std::chrono::nanoseconds busy{ 0 };
+    std::chrono::nanoseconds reportedBusy{ 0 };
+  };
+
+  void runWorker(int worker);
+  void complete(int worker,
+                std::vector<Job>& batch,
+                std::chrono::nanoseconds busy,
+                std::unique_lock<std::mutex>& lock);
+  void deliver(LaneState& lane, std::unique_lock<std::mutex>& lock);
+
+  Work work;
+
+  mutable std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable spaceReady;
+  std::deque<Job> jobs;
+  LaneState lanes[2];
+  std::vector<Worker> workerStats;
+  timepoint lastStats;
+  bool shutDown;
+
+  std::vector<std::thread> threads;
+};
+
+} // namespace MediaNet
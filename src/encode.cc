@@ -159,6 +159,7 @@ MediaNet::operator>>(std::unique_ptr<Packet>& p, RelayData& msg)
 std::unique_ptr<Packet>&
 MediaNet::operator<<(std::unique_ptr<Packet>& p, const NetAck& msg)
 {
+  p << msg.ackDelayUs;
   p << msg.ecnVec;
   p << msg.ackVec;
   p << msg.clientSeqNum;
@@ -183,6 +184,7 @@ MediaNet::operator>>(std::unique_ptr<Packet>& p, NetAck& msg)
   ok &= p >> msg.clientSeqNum;
   ok &= p >> msg.ackVec;
   ok &= p >> msg.ecnVec;
+  ok &= p >> msg.ackDelayUs;
 
   if (!ok) {
     std::cerr << "problem parsing NetAck" << std::endl;
@@ -812,6 +814,7 @@ std::unique_ptr<Packet>&
 MediaNet::operator<<(std::unique_ptr<Packet>& p, const NamedDataChunk& data)
 {
 
+  p << data.priority;
   p << data.lifetime;
   p << data.shortName;
 
@@ -826,6 +829,7 @@ MediaNet::operator>>(std::unique_ptr<Packet>& p, NamedDataChunk& data)
 
   ok &= p >> data.shortName;
   ok &= p >> data.lifetime;
+  ok &= p >> data.priority;
 
   if (!ok) {
     std::cerr << "problem parsing NamedDataChunk" << std::endl;
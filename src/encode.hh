@@ -158,8 +158,9 @@ struct NetAck
 {
   uint32_t clientSeqNum;
   uint32_t recvTimeUs;
-  uint32_t ackVec;
-  uint32_t ecnVec;
+  uint32_t ackVec;     // bit i set if clientSeqNum-1-i was received
+  uint32_t ecnVec;     // same layout as ackVec, for packets marked congested
+  uint32_t ackDelayUs; // time clientSeqNum waited before this ack was sent
 };
 
 std::unique_ptr<Packet>&
@@ -249,6 +250,7 @@ struct NamedDataChunk
 {
   ShortName shortName;
   uintVar_t lifetime;
+  uint8_t priority; // same scale as Packet::getPriority, lower is more important
 };
 std::unique_ptr<Packet>&
 operator<<(std::unique_ptr<Packet>& p, const NamedDataChunk& msg);
@@ -2,8 +2,11 @@
 
 #include "encryptPipe.hh"
 #include "encode.hh"
+#include "quicr/log.hh"
 #include "quicr/packet.hh"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 using namespace MediaNet;
@@ -12,25 +15,218 @@ using namespace MediaNet;
 static const auto FIXED_CIPHER_SUITE = sframe::CipherSuite::AES_GCM_128_SHA256;
 static const size_t SFRAME_EPOCH_BITS = 8;
 
-template<typename T>
-sframe::bytes static to_bytes(const T& range)
-{
-  return sframe::bytes(range.begin(), range.end());
-}
+// low bits of the sframe sender id pick the worker context
+static const int SENDER_WORKER_BITS = 4;
+
+EncryptPipe::CryptoContext::CryptoContext()
+  : mls_context(FIXED_CIPHER_SUITE, SFRAME_EPOCH_BITS)
+{}
 
 EncryptPipe::EncryptPipe(PipeInterface* t)
   : PipeInterface(t)
-  , mls_context(FIXED_CIPHER_SUITE, SFRAME_EPOCH_BITS)
-{}
+{
+  static_assert(maxCryptoThreads <= (1 << SENDER_WORKER_BITS));
+  contexts.push_back(std::make_unique<CryptoContext>());
+}
+
+EncryptPipe::~EncryptPipe()
+{
+  // workers may still be handing packets to nextPipe
+  pool.reset();
+}
 
 bool
 EncryptPipe::send(std::unique_ptr<Packet> packet)
 {
+  assert(nextPipe);
 
-  // TODO: figure out right AAD bits
+  if (pool) {
+    pool->submit(CryptoWorkerPool::Lane::protect, std::move(packet));
+    return true;
+  }
+
+  if (!seal(0, packet)) {
+    return false;
+  }
+  return nextPipe->send(move(packet));
+}
+
+bool
+EncryptPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+
+  if (pool) {
+    pool->submitBatch(CryptoWorkerPool::Lane::protect, packets);
+    return true;
+  }
+
+  bool ok = true;
+  for (auto& packet : packets) {
+    if (!seal(0, packet)) {
+      packet.reset();
+      ok = false;
+    }
+  }
+  packets.erase(std::remove(packets.begin(), packets.end(), nullptr),
+                packets.end());
+  return nextPipe->sendBatch(packets) && ok;
+}
+
+std::unique_ptr<Packet>
+EncryptPipe::recv()
+{
   assert(nextPipe);
-  // return nextPipe->send(std::move(packet));
 
+  if (pool) {
+    // everything goes through the pool, even packets that need no
+    // decryption, so nothing overtakes what is still being worked on
+    while (!pool->full(CryptoWorkerPool::Lane::unprotect)) {
+      auto packet = nextPipe->recv();
+      if (!packet) {
+        break;
+      }
+      pool->submit(CryptoWorkerPool::Lane::unprotect, std::move(packet));
+    }
+    return pool->pop(CryptoWorkerPool::Lane::unprotect);
+  }
+
+  auto packet = nextPipe->recv();
+  if (packet && !open(0, packet)) {
+    return std::unique_ptr<Packet>(nullptr);
+  }
+  return packet;
+}
+
+void
+EncryptPipe::setCryptoKey(sframe::MLSContext::EpochID epoch,
+                          const sframe::bytes& mls_epoch_secret)
+{
+  epochSecrets[epoch] = mls_epoch_secret;
+  for (auto& context : contexts) {
+    std::lock_guard<std::mutex> lock(context->mutex);
+    context->current_epoch = epoch;
+    context->mls_context.add_epoch(epoch, mls_epoch_secret);
+  }
+  std::cout << "SetCryptoKey : epoch:" << epoch << "\n";
+}
+
+void
+EncryptPipe::setCryptoThreads(int numThreads)
+{
+  assert(numThreads >= 0 && numThreads <= maxCryptoThreads);
+
+  // the old workers finish what they have queued first
+  pool.reset();
+  {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    utilization.clear();
+  }
+  if (numThreads == 0) {
+    return;
+  }
+
+  // contexts are kept once made, a fresh one for a sender id that was
+  // already used would start its nonces over
+  while (int(contexts.size()) < numThreads) {
+    auto context = std::make_unique<CryptoContext>();
+    for (const auto& [epoch, secret] : epochSecrets) {
+      context->mls_context.add_epoch(epoch, secret);
+    }
+    context->current_epoch = contexts[0]->current_epoch;
+    contexts.push_back(std::move(context));
+  }
+
+  pool = std::make_unique<CryptoWorkerPool>(
+    numThreads,
+    [this](int worker,
+           CryptoWorkerPool::Lane lane,
+           std::unique_ptr<Packet>& packet) {
+      if (lane == CryptoWorkerPool::Lane::protect) {
+        return seal(worker, packet);
+      }
+      return open(worker, packet);
+    });
+  pool->setSink(CryptoWorkerPool::Lane::protect,
+                [this](CryptoWorkerPool::Batch& packets) {
+                  nextPipe->sendBatch(packets);
+                });
+  if (recvEvent) {
+    pool->setNotify(CryptoWorkerPool::Lane::unprotect,
+                    [this]() { recvEvent->notify(); });
+  }
+}
+
+void
+EncryptPipe::setRecvEvent(WakeupEvent* event)
+{
+  recvEvent = event;
+  if (pool && recvEvent) {
+    pool->setNotify(CryptoWorkerPool::Lane::unprotect,
+                    [this]() { recvEvent->notify(); });
+  }
+}
+
+std::vector<uint32_t>
+EncryptPipe::getCryptoUtilization() const
+{
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return utilization;
+}
+
+void
+EncryptPipe::runUpdates(
+  const std::chrono::time_point<std::chrono::steady_clock>& now)
+{
+  if (pool && now - lastStatsTime >= std::chrono::seconds(1)) {
+    lastStatsTime = now;
+    auto stats = pool->stats();
+
+    uint32_t busiest = 0;
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      utilization.clear();
+      for (const auto& worker : stats.workers) {
+        utilization.push_back(worker.utilizationPercent);
+        busiest = std::max(busiest, worker.utilizationPercent);
+      }
+    }
+
+    updateStat(StatName::cryptoQueueDepth,
+               stats.queueDepth + stats.reorderDepth);
+    updateStat(StatName::cryptoUtilPercent, busiest);
+  }
+
+  PipeInterface::runUpdates(now);
+}
+
+void
+EncryptPipe::registerMetrics(MetricsRegistry& registry,
+                             const std::string& labels)
+{
+  auto bounds = Histogram::decadeBounds(1000000);
+  sealTime = &registry.histogram("quicr_crypto_time_ns",
+                                 "time to protect or unprotect one payload",
+                                 bounds,
+                                 joinLabels(labels, "op=\"protect\""));
+  openTime = &registry.histogram("quicr_crypto_time_ns",
+                                 "time to protect or unprotect one payload",
+                                 bounds,
+                                 joinLabels(labels, "op=\"unprotect\""));
+  failCounter = &registry.counter(
+    "quicr_crypto_failures_total", "payloads that failed crypto", labels);
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+///
+/// Private Implementation
+///
+
+bool
+EncryptPipe::seal(int worker, std::unique_ptr<Packet>& packet)
+{
+  // TODO: figure out right AAD bits
   ClientData clientData;
   NamedDataChunk namedDataChunk;
   DataBlock dataBlock;
@@ -47,18 +243,32 @@ EncryptPipe::send(std::unique_ptr<Packet> packet)
   assert(fromVarInt(dataBlock.metaDataLen) == 0);
   uint16_t payloadSize = fromVarInt(dataBlock.dataLen);
 
-  auto encrypted = protect(packet, payloadSize);
+  uint64_t senderID =
+    (uint64_t(packet->name.senderID) << SENDER_WORKER_BITS) | worker;
+  size_t encryptedSize = 0;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    encryptedSize =
+      protect(*contexts[worker], packet, senderID, payloadSize);
+  } catch (const std::exception& e) {
+    QUICR_LOG_WARN("EncryptPipe protect failed: {}", e.what());
+    if (failCounter) {
+      failCounter->add();
+    }
+    return false;
+  }
+  QUICR_TRACE(packet, sealed);
+  if (sealTime) {
+    sealTime->record(uint64_t(std::chrono::nanoseconds(
+                                std::chrono::steady_clock::now() - start)
+                                .count()));
+  }
   // std::cout << "Payload Original Size/Encrypted Size:" << payloadSize << "/"
-  // << encrypted.size() << "\n";
-
-  // re-insert encrypted portion
-  uint8_t* dst = &(packet->data());
-  packet->resize(encrypted.size());
-  std::copy(encrypted.begin(), encrypted.end(), dst);
+  // << encryptedSize << "\n";
 
   EncryptedDataBlock encryptedDataBlock;
   encryptedDataBlock.metaDataLen = dataBlock.metaDataLen;
-  encryptedDataBlock.cipherDataLen = toVarInt(encrypted.size());
+  encryptedDataBlock.cipherDataLen = toVarInt(encryptedSize);
   encryptedDataBlock.authTagLen = 0;
 
   packet << encryptedDataBlock;
@@ -68,95 +278,110 @@ EncryptPipe::send(std::unique_ptr<Packet> packet)
   // std::cout << "Full Encrypted Packet with header: "<< packet->size() << "
   // bytes\n";
 
-  return nextPipe->send(move(packet));
+  return true;
 }
 
-std::unique_ptr<Packet>
-EncryptPipe::recv()
+bool
+EncryptPipe::open(int worker, std::unique_ptr<Packet>& packet)
 {
+  if (nextTag(packet) != PacketTag::shortName) {
+    return true;
+  }
 
-  // TODO check packet integrity and decrypt
-
-  assert(nextPipe);
-  // return nextPipe->recv();
-
-  auto packet = nextPipe->recv();
-  if (packet) {
-    auto tag = nextTag(packet);
-    if (tag == PacketTag::shortName) {
-
-      NamedDataChunk namedDataChunk;
-      EncryptedDataBlock encryptedDataBlock;
-
-      bool ok = true;
-
-      ok &= packet >> namedDataChunk;
-      ok &= packet >> encryptedDataBlock;
-
-      if (!ok) {
-        // todo should log bad packet
-        return std::unique_ptr<Packet>(nullptr);
-      }
-
-      assert(fromVarInt(encryptedDataBlock.metaDataLen) == 0); // TODO
-      uint16_t payloadSize = fromVarInt(encryptedDataBlock.cipherDataLen);
-      assert(payloadSize > 0);
-      packet->headerSize = QUICR_HEADER_SIZE_BYTES; // TODO make it constant
-      auto decrypted = unprotect(packet, payloadSize);
-
-      // TODO - how does decrypt auth error get hangled
+  NamedDataChunk namedDataChunk;
+  EncryptedDataBlock encryptedDataBlock;
 
-      packet->resize(decrypted.size());
-      std::copy(decrypted.begin(), decrypted.end(), &packet->data());
+  bool ok = true;
 
-      DataBlock dataBlock;
-      dataBlock.metaDataLen = encryptedDataBlock.metaDataLen;
-      dataBlock.dataLen = toVarInt(decrypted.size());
+  ok &= packet >> namedDataChunk;
+  ok &= packet >> encryptedDataBlock;
 
-      packet << dataBlock;
-      packet << namedDataChunk;
+  if (!ok) {
+    // todo should log bad packet
+    return false;
+  }
 
-      return packet;
+  assert(fromVarInt(encryptedDataBlock.metaDataLen) == 0); // TODO
+  uint16_t payloadSize = fromVarInt(encryptedDataBlock.cipherDataLen);
+  assert(payloadSize > 0);
+  packet->headerSize = QUICR_HEADER_SIZE_BYTES; // TODO make it constant
+
+  size_t decryptedSize = 0;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    decryptedSize = unprotect(*contexts[worker], packet, payloadSize);
+  } catch (const std::exception& e) {
+    QUICR_LOG_WARN("EncryptPipe unprotect failed: {}", e.what());
+    if (failCounter) {
+      failCounter->add();
     }
+    return false;
+  }
+  QUICR_TRACE(packet, opened);
+  if (openTime) {
+    openTime->record(uint64_t(std::chrono::nanoseconds(
+                                std::chrono::steady_clock::now() - start)
+                                .count()));
   }
-  return packet;
-}
 
-void
-EncryptPipe::setCryptoKey(sframe::MLSContext::EpochID epoch,
-                          const sframe::bytes& mls_epoch_secret)
-{
-  current_epoch = epoch;
-  mls_context.add_epoch(epoch, std::move(mls_epoch_secret));
-  std::cout << "SetCryptoKey : epoch:" << current_epoch << "\n";
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = encryptedDataBlock.metaDataLen;
+  dataBlock.dataLen = toVarInt(decryptedSize);
+
+  packet << dataBlock;
+  packet << namedDataChunk;
+
+  return true;
 }
 
-sframe::bytes
-EncryptPipe::protect(const std::unique_ptr<Packet>& packet,
+// sframe can not work over the payload in place: the ciphertext starts
+// with a header whose length is only known once protect has picked the
+// counter, and the cipher takes input and output that are the same bytes
+// or do not overlap at all. So each direction writes into the context's
+// scratch buffer, which stops growing after the largest payload, and
+// copies the result back over the payload.
+size_t
+EncryptPipe::protect(CryptoContext& context,
+                     const std::unique_ptr<Packet>& packet,
+                     uint64_t senderID,
                      uint16_t payloadSize)
 {
-  assert(current_epoch >= 0);
-
-  gsl::span<const uint8_t> buffer_ref = packet->buffer;
-  // encrypt from header onwards
-  auto plaintext = buffer_ref.subspan(packet->headerSize, payloadSize);
-  auto ct_out = sframe::bytes(plaintext.size() + sframe::max_overhead);
-  auto ct = mls_context.protect(
-    current_epoch, packet->name.senderID, ct_out, plaintext);
-  // TODO see if we can reuse ct_out
-  return to_bytes(ct);
+  std::lock_guard<std::mutex> lock(context.mutex);
+
+  auto& buffer = packet->buffer;
+  size_t payloadStart = packet->headerSize;
+  assert(buffer.size() >= payloadStart + payloadSize);
+
+  context.scratch.resize(payloadSize + sframe::max_overhead);
+  gsl::span<uint8_t> buffer_ref = buffer;
+  auto plaintext = buffer_ref.subspan(payloadStart, payloadSize);
+  auto ct = context.mls_context.protect(
+    context.current_epoch, senderID, context.scratch, plaintext);
+
+  // nothing after the payload is kept
+  packet->resize(int(ct.size()));
+  std::memcpy(buffer.data() + payloadStart, ct.data(), ct.size());
+  return ct.size();
 }
 
-sframe::bytes
-EncryptPipe::unprotect(const std::unique_ptr<Packet>& packet,
+size_t
+EncryptPipe::unprotect(CryptoContext& context,
+                       const std::unique_ptr<Packet>& packet,
                        uint16_t payloadSize)
 {
-
-  gsl::span<uint8_t> buffer_ref = packet->buffer;
+  std::lock_guard<std::mutex> lock(context.mutex);
+  auto& buffer = packet->buffer;
+  size_t payloadStart = packet->headerSize;
+  assert(buffer.size() >= payloadStart + payloadSize);
+
+  // plaintext is never longer than the ciphertext
+  context.scratch.resize(payloadSize);
+  gsl::span<uint8_t> buffer_ref = buffer;
   // start decryption from data (excluding header)
-  auto ciphertext = buffer_ref.subspan(packet->headerSize, payloadSize);
-  auto pt_out = sframe::bytes(ciphertext.size());
-  auto pt = mls_context.unprotect(pt_out, ciphertext);
-  // TODO see if we can reuse pt_out
-  return to_bytes(pt);
-}
\ No newline at end of file
+  auto ciphertext = buffer_ref.subspan(payloadStart, payloadSize);
+  auto pt = context.mls_context.unprotect(context.scratch, ciphertext);
+
+  packet->resize(int(pt.size()));
+  std::memcpy(buffer.data() + payloadStart, pt.data(), pt.size());
+  return pt.size();
+}
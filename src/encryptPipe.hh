@@ -1,10 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "cryptoWorkerPool.hh"
 #include "pipeInterface.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
+#include "wakeupEvent.hh"
 
 #include <sframe/sframe.h>
 
@@ -14,8 +21,10 @@ class EncryptPipe : public PipeInterface
 {
 public:
   explicit EncryptPipe(PipeInterface* t);
+  ~EncryptPipe() override;
 
   bool send(std::unique_ptr<Packet> packet) override;
+  bool sendBatch(Batch& packets) override;
 
   /// non blocking, return nullptr if no buffer
   std::unique_ptr<Packet> recv() override;
@@ -25,14 +34,63 @@ public:
   void setCryptoKey(sframe::MLSContext::EpochID epoch,
                     const sframe::bytes& mls_epoch_secret);
 
+  // run the crypto on numThreads worker threads, 0 runs it inline on the
+  // calling thread. Not safe to change while packets are flowing.
+  void setCryptoThreads(int numThreads);
+
+  // notified when the crypto workers have received packets ready
+  void setRecvEvent(WakeupEvent* event);
+
+  // percent busy of each crypto worker over the last stats interval
+  [[nodiscard]] std::vector<uint32_t> getCryptoUtilization() const;
+
+  void runUpdates(
+    const std::chrono::time_point<std::chrono::steady_clock>& now) override;
+
+  // call before packets flow, the workers read the metrics unlocked
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+  static constexpr int maxCryptoThreads = 16;
+
 private:
-  sframe::bytes protect(const std::unique_ptr<Packet>& packet,
+  // each worker encrypts with its own context and sender id so no two
+  // threads ever share a key and nonce counter
+  struct CryptoContext
+  {
+    CryptoContext();
+
+    std::mutex mutex;
+    sframe::MLSContext::EpochID current_epoch = -1;
+    sframe::MLSContext mls_context;
+    sframe::bytes scratch; // output of the last protect or unprotect
+  };
+
+  bool seal(int worker, std::unique_ptr<Packet>& packet);
+  bool open(int worker, std::unique_ptr<Packet>& packet);
+
+  // replace the payload with its ciphertext or plaintext within the packet
+  // buffer and return the new payload size
+  static size_t protect(CryptoContext& context,
+                        const std::unique_ptr<Packet>& packet,
+                        uint64_t senderID,
                         uint16_t payloadSize);
-  sframe::bytes unprotect(const std::unique_ptr<Packet>& packet,
+  static size_t unprotect(CryptoContext& context,
+                          const std::unique_ptr<Packet>& packet,
                           uint16_t payloadSize);
 
-  sframe::MLSContext::EpochID current_epoch = -1;
-  sframe::MLSContext mls_context;
+  std::map<sframe::MLSContext::EpochID, sframe::bytes> epochSecrets;
+  std::vector<std::unique_ptr<CryptoContext>> contexts; // [0] is inline
+  std::unique_ptr<CryptoWorkerPool> pool;
+  WakeupEvent* recvEvent = nullptr;
+
+  mutable std::mutex statsMutex;
+  std::chrono::time_point<std::chrono::steady_clock> lastStatsTime;
+  std::vector<uint32_t> utilization;
+
+  Histogram* sealTime = nullptr; // ns
+  Histogram* openTime = nullptr;
+  Counter* failCounter = nullptr;
 };
 
 } // namespace MediaNet
@@ -19,40 +19,41 @@ FecPipe::send(std::unique_ptr<Packet> packet)
   assert(packet);
   assert(nextPipe);
 
-  std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
-  std::chrono::steady_clock::duration dn = tp.time_since_epoch();
-  uint32_t nowMs =
-    (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(dn).count();
-
-  if (packet->getFEC()) {
-    // TODO for packets with FEC enabled, save them and send them again in 10 ms
-
-    {
-      std::unique_ptr<Packet> fecPacket = packet->clone();
-      fecPacket->setFEC(false);
-      fecPacket->setReliable(false);
-      fecPacket->setPriority(0);
-      sendList.emplace_back(nowMs + 10, std::move(fecPacket));
-    }
-
-    {
-      std::unique_ptr<Packet> fecPacket = packet->clone();
-      fecPacket->setFEC(false);
-      fecPacket->setReliable(false);
-      fecPacket->setPriority(0);
-      sendList.emplace_back(nowMs + 50, std::move(fecPacket));
-    }
+  uint32_t nowMs = nowMsec();
+  Batch due;
+  {
+    std::lock_guard<std::mutex> lock(sendListMutex);
+    queueRepairs(*packet, nowMs);
+    takeDue(nowMs, due);
   }
+  for (auto& fecPacket : due) {
+    nextPipe->send(move(fecPacket));
+  }
+
+  return nextPipe->send(move(packet));
+}
 
-  if (!sendList.empty()) {
-    while (sendList.front().first <= nowMs) {
-      std::unique_ptr<Packet> fecPacket = std::move(sendList.front().second);
-      sendList.pop_front();
-      nextPipe->send(move(fecPacket));
+bool
+FecPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+
+  uint32_t nowMs = nowMsec();
+  Batch out;
+  out.reserve(packets.size());
+  {
+    std::lock_guard<std::mutex> lock(sendListMutex);
+    for (auto& packet : packets) {
+      queueRepairs(*packet, nowMs);
     }
+    takeDue(nowMs, out);
   }
+  for (auto& packet : packets) {
+    out.push_back(move(packet));
+  }
+  packets.clear();
 
-  return nextPipe->send(move(packet));
+  return nextPipe->sendBatch(out);
 }
 
 std::unique_ptr<Packet>
@@ -69,4 +70,43 @@ FecPipe::~FecPipe()
     std::unique_ptr<Packet> fecPacket = std::move(sendList.front().second);
     sendList.pop_front();
   }
-}
\ No newline at end of file
+}
+
+///
+/// Private Implementation
+///
+
+uint32_t
+FecPipe::nowMsec()
+{
+  std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration dn = tp.time_since_epoch();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(dn)
+    .count();
+}
+
+void
+FecPipe::queueRepairs(const Packet& packet, uint32_t nowMs)
+{
+  if (!packet.getFEC()) {
+    return;
+  }
+
+  // TODO for packets with FEC enabled, save them and send them again in 10 ms
+  for (uint32_t delayMs : { 10, 50 }) {
+    std::unique_ptr<Packet> fecPacket = packet.clone();
+    fecPacket->setFEC(false);
+    fecPacket->setReliable(false);
+    fecPacket->setPriority(0);
+    sendList.emplace_back(nowMs + delayMs, std::move(fecPacket));
+  }
+}
+
+void
+FecPipe::takeDue(uint32_t nowMs, Batch& out)
+{
+  while (!sendList.empty() && sendList.front().first <= nowMs) {
+    out.push_back(std::move(sendList.front().second));
+    sendList.pop_front();
+  }
+}
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <utility> // for pair
 
 #include "pipeInterface.hh"
@@ -17,11 +18,20 @@ public:
   ~FecPipe() override;
 
   bool send(std::unique_ptr<Packet> packet) override;
+  bool sendBatch(Batch& packets) override;
 
   /// non blocking, return nullptr if no buffer
   std::unique_ptr<Packet> recv() override;
 
 private:
+  static uint32_t nowMsec();
+  // call with sendListMutex held
+  void queueRepairs(const Packet& packet, uint32_t nowMs);
+  void takeDue(uint32_t nowMs, Batch& out);
+
+  // the app thread's control sends and a crypto worker's batches both
+  // come through here
+  std::mutex sendListMutex;
   // This is a list of FEC packets to send and time in ms to send them
   std::list<std::pair<uint32_t /*sendTime*/, std::unique_ptr<Packet>>> sendList;
 };
@@ -6,6 +6,7 @@
 
 #include "encode.hh"
 #include "fragmentPipe.hh"
+#include "quicr/log.hh"
 #include "quicr/packet.hh"
 
 using namespace MediaNet;
@@ -13,6 +14,9 @@ using namespace MediaNet;
 FragmentPipe::FragmentPipe(PipeInterface* t)
   : PipeInterface(t)
   , mtu(1200)
+  , deadlines(std::chrono::milliseconds(100),
+              64,
+              std::chrono::steady_clock::now())
 {}
 
 void
@@ -31,16 +35,179 @@ FragmentPipe::send(std::unique_ptr<Packet> packet)
   assert(nextPipe);
   // std::clog << "Frag::Send packet " << *packet << std::endl;
 
+  Batch fragments;
+  fragment(std::move(packet), fragments);
+  return nextPipe->sendBatch(fragments);
+}
+
+bool
+FragmentPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+
+  Batch fragments;
+  fragments.reserve(packets.size());
+  for (auto& packet : packets) {
+    fragment(std::move(packet), fragments);
+  }
+  packets.clear();
+  return nextPipe->sendBatch(fragments);
+}
+
+std::unique_ptr<Packet>
+FragmentPipe::recv()
+{
+  // TODO - cache fragments and reassemble then pass on the when full packet is
+  // received
+  assert(nextPipe);
+
+  while (true) {
+
+    auto packet = nextPipe->recv();
+    if (!packet) {
+      return packet;
+    }
+
+    packet = processRxPacket(std::move(packet));
+    if (packet) {
+      QUICR_TRACE(packet, reassembled);
+    }
+    return packet;
+  }
+}
+
+std::unique_ptr<Packet>
+FragmentPipe::processRxPacket(std::unique_ptr<Packet> packet)
+{
+  if (nextTag(packet) != PacketTag::shortName) {
+    return packet;
+  }
+
+  NamedDataChunk namedDataChunk;
+  EncryptedDataBlock encryptedDataBlock;
+  DataBlock datablock;
+
+  bool ok = true;
+  bool encrypted = true;
+  ok &= packet >> namedDataChunk;
+  if (nextTag(packet) == PacketTag::encDataBlock) {
+    ok &= packet >> encryptedDataBlock;
+  } else if (nextTag(packet) == PacketTag::dataBlock) {
+    ok &= packet >> datablock;
+    encrypted = false;
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    //  TODO log bad packet
+    return std::unique_ptr<Packet>(nullptr);
+  }
+
+  if (namedDataChunk.shortName.fragmentID == 0) {
+    // packet wasn't fragmented, set the contents back
+    // TODO (1): add explicit marking instead of checking fragmentID?
+    // TODO (2): hide the pop and push back tag semantics behind an api
+    if (encrypted) {
+      packet << encryptedDataBlock;
+    } else {
+      packet << datablock;
+    }
+    packet << namedDataChunk;
+    return packet;
+  }
+
+  size_t payloadSize = (encrypted)
+                         ? fromVarInt(encryptedDataBlock.cipherDataLen)
+                         : fromVarInt(datablock.dataLen);
+  if (payloadSize == 0 || payloadSize > packet->size()) {
+    QUICR_LOG_WARN("frag recv bad fragment size {}", payloadSize);
+    return std::unique_ptr<Packet>(nullptr);
+  }
+
+  auto result =
+    addFragment(std::move(packet), namedDataChunk, encrypted, payloadSize);
+  if (!result) {
+    return result;
+  }
+
+  namedDataChunk.shortName.fragmentID = 0;
+  if (encrypted) {
+    encryptedDataBlock.cipherDataLen = toVarInt(result->size());
+    result << encryptedDataBlock;
+  } else {
+    datablock.dataLen = toVarInt(result->size());
+    result << datablock;
+  }
+  result << namedDataChunk;
+
+  result->name = namedDataChunk.shortName;
+  result->setFragID(0, true);
+  return result;
+}
+
+void
+FragmentPipe::runUpdates(
+  const std::chrono::time_point<std::chrono::steady_clock>& now)
+{
+  {
+    std::lock_guard<std::mutex> lock(reassemblyMutex);
+    deadlines.advance(now, [this, &now](const ShortName& name) {
+      auto it = reassembly.find(name);
+      if (it == reassembly.end()) {
+        return; // completed in time
+      }
+      if (it->second.deadline > now) {
+        // same name came back after the one this timer was for completed
+        deadlines.schedule(name, it->second.deadline);
+        return;
+      }
+      reassembly.erase(it);
+    });
+  }
+
+  PipeInterface::runUpdates(now);
+}
+
+size_t
+FragmentPipe::pendingObjects()
+{
+  std::lock_guard<std::mutex> lock(reassemblyMutex);
+  return reassembly.size();
+}
+
+void
+FragmentPipe::updateMTU(uint16_t val, uint32_t pps)
+{
+  mtu = val;
+
+  PipeInterface::updateMTU(val, pps);
+}
+
+///
+/// Private Implementation
+///
+
+// Appends the packet to out, or its fragments when it is over the mtu.
+// Fragments carry no check of their own: EncryptPipe has already sealed
+// the whole object, so a damaged or forged fragment fails the object's
+// decrypt once it is reassembled, and UDP's checksum drops datagrams
+// damaged on the way before they get here.
+void
+FragmentPipe::fragment(std::unique_ptr<Packet> packet, Batch& out)
+{
   // TODO  break packets larger than mtu bytes into equal size fragments less
 
   const int extraHeaderSizeBytes = 25; // TODO tune and move
   const int minPacketPayload = 56;     // TODO move
 
   if (packet->fullSize() + extraHeaderSizeBytes <= mtu) {
-    std::clog << "\t" << packet->shortName()
-              << "[Send: not fragmented,  as size=" << packet->fullSize()
-              << " mtu=" << mtu << "]" << std::endl;
-    return nextPipe->send(move(packet));
+    // std::clog << "\t" << packet->shortName()
+    //           << "[Send: not fragmented,  as size=" << packet->fullSize()
+    //           << " mtu=" << mtu << "]" << std::endl;
+    QUICR_TRACE(packet, fragmented);
+    out.push_back(move(packet));
+    return;
   }
 
   ClientData clientData;
@@ -81,12 +248,8 @@ FragmentPipe::send(std::unique_ptr<Packet> packet)
 
   while (numLeft > 0) {
     size_t numUse = std::min(size_t(dataSize), numLeft);
-    std::unique_ptr<Packet> fragPacket = packet->clone();
-
-    fragPacket->resize(numUse);
-    std::copy(&(packet->data()) + numDone,
-              &(packet->data()) + numDone + numUse,
-              &(fragPacket->data()));
+    // only this fragment's slice is copied, not the whole object
+    std::unique_ptr<Packet> fragPacket = packet->cloneSlice(numDone, numUse);
     numDone += numUse;
     numLeft -= numUse;
 
@@ -107,210 +270,115 @@ FragmentPipe::send(std::unique_ptr<Packet> packet)
     //					<< ", Size" << fragPacket->size() <<
     //std::endl;
 
-    ok &= nextPipe->send(move(fragPacket));
+    QUICR_TRACE(fragPacket, fragmented);
+    out.push_back(move(fragPacket));
 
     frag++;
 
     assert(frag < 64);
   }
-
-  return ok;
 }
 
+// Takes one fragment whose tags have been read off, so its payload is the
+// last payloadSize bytes of the buffer. Returns the whole object, without
+// its tags, once the last missing fragment comes in.
 std::unique_ptr<Packet>
-FragmentPipe::recv()
+FragmentPipe::addFragment(std::unique_ptr<Packet> packet,
+                          const NamedDataChunk& namedDataChunk,
+                          bool encrypted,
+                          size_t payloadSize)
 {
-  // TODO - cache fragments and reassemble then pass on the when full packet is
-  // received
-  assert(nextPipe);
-
-  while (true) {
-
-    auto packet = nextPipe->recv();
-    if (!packet) {
-      return packet;
-    }
-
-    return processRxPacket(std::move(packet));
+  size_t index = namedDataChunk.shortName.fragmentID / 2; // 1 based
+  bool isLast = (namedDataChunk.shortName.fragmentID & 1) != 0;
+  if (index == 0 || index > maxFragments) {
+    return std::unique_ptr<Packet>(nullptr); // from the wire, up to 127
   }
-}
 
-std::unique_ptr<Packet>
-FragmentPipe::processRxPacket(std::unique_ptr<Packet> packet)
-{
-  // TODO - this is broken now, need to looka at shortname to decide if this
-  // is a fragment or not
-
-  if (nextTag(packet) != PacketTag::shortName) {
-    return packet;
+  ShortName objectName = namedDataChunk.shortName;
+  objectName.fragmentID = 0;
+
+  // everything in front of the payload is header from here on
+  packet->headerSize = (int)(packet->fullSize() - payloadSize);
+
+  std::lock_guard<std::mutex> lock(reassemblyMutex);
+
+  auto [it, isNew] = reassembly.try_emplace(objectName);
+  Reassembly& object = it->second;
+  if (isNew) {
+    uint64_t lifetimeMs = fromVarInt(namedDataChunk.lifetime);
+    auto lifetime = (lifetimeMs > 0) ? std::chrono::milliseconds(lifetimeMs)
+                                     : defaultLifetime;
+    object.packet = packet->cloneSlice(0, 0);
+    object.received = 0;
+    object.expected = 0;
+    object.numFrag = 0;
+    object.fragSize = 0;
+    object.lastSize = 0;
+    object.encrypted = encrypted;
+    object.deadline = std::chrono::steady_clock::now() + lifetime;
+    deadlines.schedule(objectName, object.deadline);
   }
 
-  auto next_tag = nextTag(packet);
-  while (next_tag == PacketTag::shortName) {
-    NamedDataChunk namedDataChunk;
-    EncryptedDataBlock encryptedDataBlock;
-    DataBlock datablock;
-
-    bool ok = true;
-    bool encrypted = true;
-    ok &= packet >> namedDataChunk;
-    if (nextTag(packet) == PacketTag::encDataBlock) {
-      ok &= packet >> encryptedDataBlock;
-    } else if (nextTag(packet) == PacketTag::dataBlock) {
-      ok &= packet >> datablock;
-      encrypted = false;
-    }
+  uint64_t bit = uint64_t(1) << (index - 1);
+  if ((object.received & bit) || object.encrypted != encrypted) {
+    return std::unique_ptr<Packet>(nullptr); // duplicate or bogus
+  }
+  if (object.expected && !(object.expected & bit)) {
+    return std::unique_ptr<Packet>(nullptr); // past the last fragment
+  }
 
-    if (!ok) {
-      //  TODO log bad packet
+  if (isLast) {
+    if (object.fragSize && payloadSize > object.fragSize) {
       return std::unique_ptr<Packet>(nullptr);
     }
-
-    // put the content back
-    if (encrypted) {
-      packet << encryptedDataBlock;
-    } else {
-      packet << datablock;
-    }
-
-    if (namedDataChunk.shortName.fragmentID == 0) {
-      // packet wasn't fragmented
-      // TODO (1): add explicit marking instead of checking fragmentID?
-      // TODO (2): hide the pop and push back tag semantics behind an api
-      // std::clog << "frag recv: unfragmented:" << namedDataChunk.shortName
-      //						<< std::endl;
-      // set the contents back
-      packet << namedDataChunk;
-
-      return packet;
-    }
-
-    uint16_t payloadSize = (encrypted)
-                             ? fromVarInt(encryptedDataBlock.cipherDataLen)
-                             : fromVarInt(datablock.dataLen);
-    assert(packet->size() >= payloadSize); // TODO - change log error
-
-    auto packetCopy = packet->clone();
-    packetCopy->name = namedDataChunk.shortName;
-
-    // TODO - set lifetime in packetCopy
-
-    // std::clog << "\t [Frag Recv:" << namedDataChunk.shortName << " size=" <<
-    //					packet->size() << std::endl;
-
-    {
-      std::lock_guard<std::mutex> lock(fragListMutex);
-      // std::clog << "\t [fragList: added:" << namedDataChunk.shortName <<
-      // std::endl;
-      fragList.emplace(namedDataChunk.shortName, move(packetCopy));
+    object.expected = (bit << 1) - 1;
+    object.numFrag = index;
+    object.lastSize = payloadSize;
+  } else {
+    if (object.fragSize && payloadSize != object.fragSize) {
+      return std::unique_ptr<Packet>(nullptr);
     }
+    object.fragSize = payloadSize;
+  }
+  object.received |= bit;
 
-    // TODO - clear out old fragments
-
-    // check if we have all the fragments
-    bool haveAll = true;
-    int frag = 0;
-    int numFrag = 0;
-    while (haveAll) {
-      frag++;
-      // std::cerr << "\t [recv:processing frag: " << frag << std::endl;
-      ShortName fragName = namedDataChunk.shortName;
-      fragName.fragmentID = frag * 2;
-      if (fragList.find(fragName) != fragList.end()) {
-        // exists but is not the last fragment
-        // std::cerr << "\t [recv: not last frag: " << frag << std::endl;
-        continue;
-      }
-      fragName.fragmentID = frag * 2 + 1;
-      if (fragList.find(fragName) != fragList.end()) {
-        // exists and is the last element
-        numFrag = frag;
-        // std::cerr << "\t [recv: last frag: numFrags:" << numFrag <<
-        // std::endl;
-        break;
-      }
-      haveAll = false;
+  if (isLast && index > 1 && !object.fragSize) {
+    // its offset is not known until some other fragment shows the size
+    object.last = std::move(packet);
+  } else {
+    place(object, *packet, index);
+    if (object.last && object.fragSize) {
+      place(object, *object.last, object.numFrag);
+      object.last.reset();
     }
+  }
 
-    if (haveAll) {
-      // form the new packet from all fragments and return
-      // std::cerr << "\t [HAVE ALL for: " << namedDataChunk.shortName <<
-      //					std::endl;
-      ShortName fragName = namedDataChunk.shortName;
-
-      auto result = std::unique_ptr<Packet>(nullptr);
-
-      for (int i = 1; i <= numFrag; i++) {
-        fragName.fragmentID = i * 2 + ((i == numFrag) ? 1 : 0);
-        auto fragPair = fragList.find(fragName);
-        assert(fragPair != fragList.end());
-        std::unique_ptr<Packet> fragPacket = move(fragPair->second);
-        assert(fragPacket);
-        fragList.erase(fragPair);
-
-        EncryptedDataBlock encryptedDataBlock;
-        DataBlock datablock;
-        if (encrypted) {
-          fragPacket >> encryptedDataBlock;
-        } else {
-          fragPacket >> datablock;
-        }
-
-        uint32_t dataSize = (encrypted)
-                              ? fromVarInt(encryptedDataBlock.cipherDataLen)
-                              : fromVarInt(datablock.dataLen);
-        assert(fragPacket->size() > 0);
-        assert(dataSize > 0);
-        assert(dataSize <= fragPacket->size());
-
-        if (i == 1) {
-          // use the first fragment as the result packet
-          result = move(fragPacket);
-          result->setFragID(0, true);
-          assert(dataSize <= result->fullSize());
-          result->headerSize = (int)(result->fullSize()) - dataSize;
-          continue;
-        }
-
-        assert(result);
-        assert(fragPacket);
-        result->resize((int)(result->size()) + dataSize);
-
-        uint8_t* src = &(fragPacket->data()) + fragPacket->size() - dataSize;
-        uint8_t* end = &(fragPacket->data()) + fragPacket->size();
-        uint8_t* dst = &(result->data()) + result->size() - dataSize;
-
-        std::copy(src, end, dst);
-      }
-
-      assert(result);
-      namedDataChunk.shortName.fragmentID = 0;
-
-      if (encrypted) {
-        encryptedDataBlock.cipherDataLen = toVarInt(result->size());
-        result << encryptedDataBlock;
-      } else {
-        datablock.dataLen = toVarInt(result->size());
-        result << datablock;
-      }
-
-      result << namedDataChunk;
-
-      result->name = namedDataChunk.shortName;
-      result->setFragID(0, true);
-      return result;
-    }
-    next_tag = nextTag(packet);
+  if (!object.expected || object.received != object.expected ||
+      object.last) {
+    return std::unique_ptr<Packet>(nullptr);
   }
-  return nullptr;
+
+  auto result = std::move(object.packet);
+  reassembly.erase(it);
+  return result;
 }
 
 void
-FragmentPipe::updateMTU(uint16_t val, uint32_t pps)
+FragmentPipe::place(Reassembly& object, Packet& fragment, size_t index)
 {
-  mtu = val;
+  size_t payloadSize = fragment.size();
+  size_t offset = (index - 1) * object.fragSize;
+  Packet& out = *object.packet;
+
+  if (object.numFrag && out.size() < offset + payloadSize) {
+    // size is known now, grow once to the whole object
+    out.resize(
+      int((object.numFrag - 1) * object.fragSize + object.lastSize));
+  } else if (out.size() < offset + payloadSize) {
+    out.resize(int(offset + payloadSize));
+  }
 
-  PipeInterface::updateMTU(val, pps);
+  std::copy(&fragment.data(),
+            &fragment.data() + payloadSize,
+            &out.data() + offset);
 }
-
-// TODO - need unit test for de-fragment
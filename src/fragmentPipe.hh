@@ -1,12 +1,15 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
+#include "encode.hh"
 #include "pipeInterface.hh"
 #include "quicr/packet.hh"
+#include "timerWheel.hh"
 
 namespace MediaNet {
 
@@ -16,6 +19,7 @@ public:
   explicit FragmentPipe(PipeInterface* t);
 
   bool send(std::unique_ptr<Packet> packet) override;
+  bool sendBatch(Batch& packets) override;
 
   void updateStat(StatName stat, uint64_t value) override;
 
@@ -26,11 +30,47 @@ public:
 
   std::unique_ptr<Packet> processRxPacket(std::unique_ptr<Packet> packet);
 
+  // drops objects whose lifetime ran out before all fragments came
+  void runUpdates(
+    const std::chrono::time_point<std::chrono::steady_clock>& now) override;
+
+  [[nodiscard]] size_t pendingObjects();
+
+  static constexpr std::chrono::milliseconds defaultLifetime{ 2000 };
+
 private:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  // An object being put back together. Fragments are written straight to
+  // their offset in one output packet and the bitmap says which are in,
+  // so an arrival and the completion check are O(1).
+  static constexpr size_t maxFragments = 64; // bits in Reassembly::received
+
+  struct Reassembly
+  {
+    std::unique_ptr<Packet> packet; // first fragment's headers, then payload
+    std::unique_ptr<Packet> last;   // held until the fragment size is known
+    uint64_t received;              // bit i set once fragment i+1 is in
+    uint64_t expected;              // every bit, once the last one is seen
+    size_t numFrag;                 // 0 until the last one is seen
+    size_t fragSize;                // payload of all but the last fragment
+    size_t lastSize;
+    bool encrypted;
+    timepoint deadline;
+  };
+
+  void fragment(std::unique_ptr<Packet> packet, Batch& out);
+  std::unique_ptr<Packet> addFragment(std::unique_ptr<Packet> packet,
+                                      const NamedDataChunk& namedDataChunk,
+                                      bool encrypted,
+                                      size_t payloadSize);
+  static void place(Reassembly& object, Packet& fragment, size_t index);
+
   uint16_t mtu;
 
-  std::mutex fragListMutex;
-  std::map<MediaNet::ShortName, std::unique_ptr<Packet>> fragList;
+  std::mutex reassemblyMutex;
+  std::unordered_map<ShortName, Reassembly> reassembly; // fragmentID 0
+  TimerWheel<ShortName> deadlines;
 };
 
 } // namespace MediaNet
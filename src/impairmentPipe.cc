@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cassert>
+
+#include "impairmentPipe.hh"
+
+using namespace MediaNet;
+
+ImpairmentPipe::ImpairmentPipe(PipeInterface* t,
+                               const ImpairmentConfig& sendConfig,
+                               const ImpairmentConfig& recvConfig)
+  : PipeInterface(t)
+{
+  setImpairment(sendConfig, recvConfig);
+}
+
+void
+ImpairmentPipe::setImpairment(const ImpairmentConfig& sendConfig,
+                              const ImpairmentConfig& recvConfig)
+{
+  sendSide.configure(sendConfig);
+  recvSide.configure(recvConfig);
+}
+
+bool
+ImpairmentPipe::active() const
+{
+  return !sendSide.idle() || !recvSide.idle();
+}
+
+void
+ImpairmentPipe::registerMetrics(MetricsRegistry& registry,
+                                const std::string& labels)
+{
+  for (auto* side : { &sendSide, &recvSide }) {
+    std::string dir = side == &sendSide ? "dir=\"send\"" : "dir=\"recv\"";
+    std::string sideLabels = labels.empty() ? dir : labels + "," + dir;
+
+    std::lock_guard<std::mutex> lock(side->mutex);
+    side->lost = &registry.counter("quicr_impairment_lost_packets_total",
+                                   "packets the impairment lost",
+                                   sideLabels);
+    side->queueDrops =
+      &registry.counter("quicr_impairment_queue_drops_total",
+                        "packets dropped from a full impairment queue",
+                        sideLabels);
+    side->duplicated =
+      &registry.counter("quicr_impairment_duplicated_packets_total",
+                        "extra copies the impairment sent",
+                        sideLabels);
+    side->reordered =
+      &registry.counter("quicr_impairment_reordered_packets_total",
+                        "packets the impairment held back",
+                        sideLabels);
+  }
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+bool
+ImpairmentPipe::send(std::unique_ptr<Packet> packet)
+{
+  assert(nextPipe);
+  if (sendSide.idle()) {
+    return nextPipe->send(std::move(packet));
+  }
+
+  sendDue(std::move(packet), std::chrono::steady_clock::now());
+  return true; // lost ones too, as with UDP
+}
+
+std::unique_ptr<Packet>
+ImpairmentPipe::recv()
+{
+  assert(nextPipe);
+  if (recvSide.idle()) {
+    return nextPipe->recv();
+  }
+
+  // takes all there is, so a lost packet does not hide the ones behind it
+  std::vector<std::unique_ptr<Packet>> arrived;
+  while (auto packet = nextPipe->recv()) {
+    arrived.push_back(std::move(packet));
+  }
+  auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(recvSide.mutex);
+  for (auto& packet : arrived) {
+    recvSide.impair(std::move(packet), now);
+  }
+  return recvSide.takeDue(now);
+}
+
+void
+ImpairmentPipe::runUpdates(
+  const std::chrono::time_point<std::chrono::steady_clock>& now)
+{
+  if (!sendSide.idle()) {
+    sendDue(std::unique_ptr<Packet>(nullptr), now);
+  }
+
+  PipeInterface::runUpdates(now);
+}
+
+void
+ImpairmentPipe::sentAt(
+  uint32_t sendId,
+  const std::chrono::time_point<std::chrono::steady_clock>& when)
+{
+  if (!sendSide.idle()) {
+    return;
+  }
+  PipeInterface::sentAt(sendId, when);
+}
+
+///
+/// Private Implementation
+///
+
+bool
+ImpairmentPipe::later(const Held& a, const Held& b)
+{
+  return a.due > b.due || (a.due == b.due && a.order > b.order);
+}
+
+void
+ImpairmentPipe::sendDue(std::unique_ptr<Packet> packet, timepoint now)
+{
+  // sent on under the lock too, or the timer and the sending thread could
+  // go down together and out of order
+  std::lock_guard<std::mutex> lock(sendSide.mutex);
+  if (packet) {
+    sendSide.impair(std::move(packet), now);
+  }
+  while (auto next = sendSide.takeDue(now)) {
+    nextPipe->send(std::move(next));
+  }
+}
+
+void
+ImpairmentPipe::Direction::configure(const ImpairmentConfig& impairment)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  config = impairment;
+  rng.seed(config.seed);
+  bad = false;
+  impairing = config.active();
+}
+
+void
+ImpairmentPipe::Direction::impair(std::unique_ptr<Packet> packet,
+                                  timepoint now)
+{
+  // turned off while this one was on its way, it still waits its turn
+  if (!config.active()) {
+    hold(std::move(packet), now);
+    return;
+  }
+
+  // the link state moves per packet, then decides its fate
+  if (bad) {
+    bad = !chance(config.badToGoodPerMillion);
+  } else {
+    bad = chance(config.goodToBadPerMillion);
+  }
+  if (chance(bad ? config.lossBadPerMillion : config.lossGoodPerMillion)) {
+    if (lost) {
+      lost->add();
+    }
+    return;
+  }
+
+  // waits behind what the bitrate has not sent yet
+  timepoint due = now;
+  if (config.bitrateBps) {
+    auto start = std::max(linkFree, now);
+    auto queuedUs = uint64_t(
+      std::chrono::duration_cast<std::chrono::microseconds>(start - now)
+        .count());
+    auto queuedBytes = queuedUs * config.bitrateBps / 8000000;
+    if (queuedBytes + packet->fullSize() > config.queueBytes) {
+      if (queueDrops) {
+        queueDrops->add();
+      }
+      return;
+    }
+    linkFree = start + std::chrono::nanoseconds(packet->fullSize() * 8 *
+                                                1000000000 / config.bitrateBps);
+    due = linkFree;
+  }
+
+  due += std::chrono::milliseconds(config.delayMs);
+  if (config.jitterMs) {
+    auto jitterUs = uint64_t(config.jitterMs) * 1000;
+    due += std::chrono::microseconds(rng() % (jitterUs + 1));
+  }
+  if (chance(config.reorderPerMillion)) {
+    due += std::chrono::milliseconds(config.reorderMs);
+    if (reordered) {
+      reordered->add();
+    }
+  }
+
+  if (chance(config.duplicatePerMillion)) {
+    hold(packet->clone(), due);
+    if (duplicated) {
+      duplicated->add();
+    }
+  }
+  hold(std::move(packet), due);
+}
+
+std::unique_ptr<Packet>
+ImpairmentPipe::Direction::takeDue(timepoint now)
+{
+  if (held.empty() || held.front().due > now) {
+    return std::unique_ptr<Packet>(nullptr);
+  }
+
+  std::pop_heap(held.begin(), held.end(), later);
+  auto packet = std::move(held.back().packet);
+  packet->setWireTime(held.back().due);
+  held.pop_back();
+  holding = !held.empty();
+  return packet;
+}
+
+bool
+ImpairmentPipe::Direction::chance(uint32_t perMillion)
+{
+  // what is off or certain takes no draw
+  if (perMillion == 0) {
+    return false;
+  }
+  if (perMillion >= 1000000) {
+    return true;
+  }
+  return rng() % 1000000 < perMillion;
+}
+
+void
+ImpairmentPipe::Direction::hold(std::unique_ptr<Packet> packet, timepoint due)
+{
+  held.push_back(Held{ due, numHeld++, std::move(packet) });
+  std::push_heap(held.begin(), held.end(), later);
+  holding = true;
+}
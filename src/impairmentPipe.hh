@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pipeInterface.hh"
+#include "quicr/config.hh"
+#include "quicr/metrics.hh"
+#include "quicr/packet.hh"
+
+namespace MediaNet {
+
+// Impairs packets the way a real network would, for reproducible tests and
+// benchmarks on one box: a bitrate cap behind a finite queue, fixed and
+// jittered delay, Gilbert-Elliott burst loss, reordering and duplication,
+// each direction with its own config and seeded RNG. Held packets go on
+// when due, sent ones from send() and runUpdates(), received ones from
+// recv(), so something has to keep calling them. Sent ones go on under
+// the send side's lock, one thread at a time and in due order.
+class ImpairmentPipe : public PipeInterface
+{
+public:
+  ImpairmentPipe(PipeInterface* t,
+                 const ImpairmentConfig& sendConfig,
+                 const ImpairmentConfig& recvConfig);
+
+  // safe while running, packets already held still go on when due
+  void setImpairment(const ImpairmentConfig& sendConfig,
+                     const ImpairmentConfig& recvConfig);
+  // impairing or holding packets in either direction
+  [[nodiscard]] bool active() const;
+
+  bool send(std::unique_ptr<Packet> packet) override;
+
+  /// non blocking, return nullptr if no buffer
+  std::unique_ptr<Packet> recv() override;
+
+  void runUpdates(const std::chrono::time_point<std::chrono::steady_clock>&
+                    now) override;
+
+  // dropped while sends are impaired, the held time is part of the path
+  void sentAt(uint32_t sendId,
+              const std::chrono::time_point<std::chrono::steady_clock>& when)
+    override;
+
+  // call before start()
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+private:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  struct Held
+  {
+    timepoint due;
+    uint64_t order;
+    std::unique_ptr<Packet> packet;
+  };
+  static bool later(const Held& a, const Held& b); // heap order
+
+  // impairs packet unless null, then sends on all that is due
+  void sendDue(std::unique_ptr<Packet> packet, timepoint now);
+
+  // one way through the pipe, guarded by its mutex
+  struct Direction
+  {
+    void configure(const ImpairmentConfig& impairment);
+    // nothing to impair or hold, so packets can go straight through
+    [[nodiscard]] bool idle() const { return !impairing && !holding; }
+    // holds packet until due, a copy too if duplicated, unless it is lost
+    void impair(std::unique_ptr<Packet> packet, timepoint now);
+    // the earliest packet due by now, nullptr if none. Its wire time is
+    // when it was due, when it got over the impaired link.
+    std::unique_ptr<Packet> takeDue(timepoint now);
+    bool chance(uint32_t perMillion);
+    void hold(std::unique_ptr<Packet> packet, timepoint due);
+
+    std::mutex mutex;
+    ImpairmentConfig config;
+    std::mt19937_64 rng;
+    bool bad = false;  // Gilbert-Elliott state
+    timepoint linkFree; // when the bitrate has sent what is queued
+    std::vector<Held> held;
+    uint64_t numHeld = 0;
+    // read without the lock on the data path
+    std::atomic<bool> impairing{ false }; // config.active()
+    std::atomic<bool> holding{ false };   // !held.empty()
+
+    Counter* lost = nullptr;
+    Counter* queueDrops = nullptr;
+    Counter* duplicated = nullptr;
+    Counter* reordered = nullptr;
+  };
+
+  Direction sendSide;
+  Direction recvSide;
+};
+
+} // namespace MediaNet
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cassert>
+
+#include "encode.hh"
+#include "jitterBufferPipe.hh"
+
+using namespace MediaNet;
+
+JitterBufferPipe::JitterBufferPipe(PipeInterface* t)
+  : PipeInterface(t)
+  , minDepth(0)
+  , maxDepth(0)
+  , jitterMs(0)
+  , late(0)
+{}
+
+void
+JitterBufferPipe::setDepth(uint32_t minDepthMs, uint32_t maxDepthMs)
+{
+  assert(minDepthMs <= maxDepthMs);
+  minDepth = minDepthMs;
+  maxDepth = maxDepthMs;
+}
+
+uint32_t
+JitterBufferPipe::depthMs() const
+{
+  // twice the jitter covers most of the spread of arrival times
+  return std::clamp(2 * jitterMs.load(), minDepth.load(), maxDepth.load());
+}
+
+void
+JitterBufferPipe::updateStat(PipeInterface::StatName stat, uint64_t value)
+{
+  if (stat == PipeInterface::StatName::jitterDownMs) {
+    jitterMs = uint32_t(std::min<uint64_t>(value, UINT32_MAX / 2));
+  }
+
+  PipeInterface::updateStat(stat, value);
+}
+
+void
+JitterBufferPipe::registerMetrics(MetricsRegistry& registry,
+                                  const std::string& labels)
+{
+  lateCounter = &registry.counter(
+    "quicr_jitter_late_total", "objects dropped as too late to play", labels);
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+bool
+JitterBufferPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+  return nextPipe->sendBatch(packets);
+}
+
+std::unique_ptr<Packet>
+JitterBufferPipe::recv()
+{
+  return recv(std::chrono::steady_clock::now());
+}
+
+std::unique_ptr<Packet>
+JitterBufferPipe::recv(const timepoint& now)
+{
+  assert(nextPipe);
+
+  if (maxDepth == 0 && streams.empty()) {
+    return nextPipe->recv();
+  }
+
+  while (auto packet = nextPipe->recv()) {
+    if (nextTag(packet) != PacketTag::shortName) {
+      return packet; // not media, nothing to hold back
+    }
+    add(std::move(packet), now);
+  }
+  if (now >= nextEviction) {
+    evictIdle(now);
+    nextEviction = now + std::chrono::seconds(1);
+  }
+
+  // of the streams with an object due, the one that has waited longest
+  uint32_t depth = depthMs();
+  Stream* due = nullptr;
+  timepoint dueTime;
+  for (auto& [name, stream] : streams) {
+    if (stream.pending.empty()) {
+      continue;
+    }
+    auto playout = playoutTime(stream, stream.pending.begin()->first, depth);
+    if (playout <= now && (!due || playout < dueTime)) {
+      due = &stream;
+      dueTime = playout;
+    }
+  }
+  if (!due) {
+    return nullptr;
+  }
+
+  auto head = due->pending.begin();
+  auto packet = std::move(head->second);
+  due->haveReleased = true;
+  due->lastReleased = head->first;
+  due->pending.erase(head);
+  return packet;
+}
+
+JitterBufferPipe::timepoint
+JitterBufferPipe::nextPlayout() const
+{
+  uint32_t depth = depthMs();
+  timepoint next = timepoint::max();
+  for (const auto& [name, stream] : streams) {
+    if (!stream.pending.empty()) {
+      next = std::min(
+        next, playoutTime(stream, stream.pending.begin()->first, depth));
+    }
+  }
+  return next;
+}
+
+///
+/// Private Implementation
+///
+
+void
+JitterBufferPipe::add(std::unique_ptr<Packet> packet, const timepoint& now)
+{
+  ShortName streamName = packet->shortName();
+  uint32_t mediaTime = streamName.mediaTime;
+  streamName.mediaTime = 0;
+  streamName.fragmentID = 0;
+
+  auto [it, isNew] = streams.try_emplace(streamName);
+  Stream& stream = it->second;
+
+  if (isNew) {
+    stream.baseTime = now;
+    stream.baseMediaTime = mediaTime;
+  }
+  stream.lastArrival = now;
+
+  if (stream.haveReleased && int32_t(mediaTime - stream.lastReleased) <= 0) {
+    late++; // already played past it
+    if (lateCounter) {
+      lateCounter->add();
+    }
+    return;
+  }
+
+  // an object that came sooner than the base predicts becomes the base,
+  // so the base tracks the least delayed path
+  auto offset =
+    std::chrono::milliseconds(int32_t(mediaTime - stream.baseMediaTime));
+  if (now < stream.baseTime + offset) {
+    stream.baseTime = now;
+    stream.baseMediaTime = mediaTime;
+  }
+
+  stream.pending.emplace(mediaTime, std::move(packet));
+  if (stream.pending.size() > maxPerStream) {
+    // never going to play these in time
+    stream.haveReleased = true;
+    stream.lastReleased = stream.pending.begin()->first;
+    stream.pending.erase(stream.pending.begin());
+    late++;
+    if (lateCounter) {
+      lateCounter->add();
+    }
+  }
+}
+
+JitterBufferPipe::timepoint
+JitterBufferPipe::playoutTime(const Stream& stream,
+                              uint32_t mediaTime,
+                              uint32_t depth) const
+{
+  return stream.baseTime +
+         std::chrono::milliseconds(int32_t(mediaTime - stream.baseMediaTime)) +
+         std::chrono::milliseconds(depth);
+}
+
+void
+JitterBufferPipe::evictIdle(const timepoint& now)
+{
+  for (auto it = streams.begin(); it != streams.end();) {
+    const Stream& stream = it->second;
+    if (stream.pending.empty() &&
+        now - stream.lastArrival >= streamIdleTimeout) {
+      it = streams.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
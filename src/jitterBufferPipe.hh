@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include "pipeInterface.hh"
+#include "quicr/metrics.hh"
+#include "quicr/packet.hh"
+
+namespace MediaNet {
+
+///
+/// JitterBufferPipe
+///
+
+// Receive side playout buffer. Objects are held per stream, meaning per
+// name without mediaTime and fragmentID, and released in mediaTime order
+// once their playout time comes. The playout time of an object is when
+// the earliest arriving object of the stream says it was sent, plus its
+// mediaTime offset, plus a depth that follows the downstream jitter
+// reported by the rate control. An object still missing when a later one
+// is due is skipped, and dropped as late if it shows up after all.
+// mediaTime is taken to be in milliseconds and ordered across its wrap. A
+// stream with nothing held that has not seen an object for
+// streamIdleTimeout is forgotten. Disabled, which is the default, it
+// passes everything straight through.
+class JitterBufferPipe : public PipeInterface
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  explicit JitterBufferPipe(PipeInterface* t);
+
+  // depth stays between minDepthMs and maxDepthMs, maxDepthMs 0 disables
+  void setDepth(uint32_t minDepthMs, uint32_t maxDepthMs);
+
+  bool sendBatch(Batch& packets) override;
+
+  /// non blocking, return nullptr if no buffer
+  std::unique_ptr<Packet> recv() override;
+  std::unique_ptr<Packet> recv(const timepoint& now);
+
+  void updateStat(StatName stat, uint64_t value) override;
+
+  // call before packets flow
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+  [[nodiscard]] uint32_t depthMs() const;
+  [[nodiscard]] uint64_t lateCount() const { return late; }
+  [[nodiscard]] size_t streamCount() const { return streams.size(); }
+
+  // earliest playout time of a held object, timepoint::max() if none.
+  // Call from the thread that calls recv().
+  [[nodiscard]] timepoint nextPlayout() const;
+
+  static constexpr size_t maxPerStream = 256;
+  static constexpr std::chrono::seconds streamIdleTimeout{ 10 };
+
+private:
+  // sooner first across the 32 bit wrap, which holds as the held objects of
+  // a stream are well within half the range of each other
+  struct MediaTimeOrder
+  {
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+      return int32_t(a - b) < 0;
+    }
+  };
+
+  struct Stream
+  {
+    std::map<uint32_t, std::unique_ptr<Packet>, MediaTimeOrder> pending;
+    timepoint baseTime; // local arrival time that baseMediaTime maps to
+    uint32_t baseMediaTime = 0;
+    bool haveReleased = false;
+    uint32_t lastReleased = 0;
+    timepoint lastArrival;
+  };
+
+  void add(std::unique_ptr<Packet> packet, const timepoint& now);
+  void evictIdle(const timepoint& now);
+  [[nodiscard]] timepoint playoutTime(const Stream& stream,
+                                      uint32_t mediaTime,
+                                      uint32_t depth) const;
+
+  // set from the app and the rate control threads
+  std::atomic<uint32_t> minDepth;
+  std::atomic<uint32_t> maxDepth;
+  std::atomic<uint32_t> jitterMs;
+
+  std::unordered_map<ShortName, Stream> streams;
+  timepoint nextEviction;
+  uint64_t late;
+  Counter* lateCounter = nullptr;
+};
+
+} // namespace MediaNet
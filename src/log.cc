@@ -0,0 +1,240 @@
+#include <cassert>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include "quicr/log.hh"
+
+using namespace MediaNet;
+
+bool
+LogSite::admit(uint32_t& suppressed)
+{
+  if (perSecond == 0) {
+    suppressed = 0;
+    return true;
+  }
+
+  auto second = uint64_t(std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count());
+  uint64_t current = window.load(std::memory_order_relaxed);
+  if (second != current &&
+      window.compare_exchange_strong(
+        current, second, std::memory_order_relaxed)) {
+    inWindow.store(0, std::memory_order_relaxed);
+  }
+
+  if (inWindow.fetch_add(1, std::memory_order_relaxed) >= perSecond) {
+    held.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  suppressed = held.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+Logger::Logger()
+  : minLevel(compiledLogLevel)
+  , dropped(0)
+  , slots(new Slot[ringSize])
+  , enqueuePos(0)
+  , dequeuePos(0)
+  , sink(&std::clog)
+  , droppedReported(0)
+  , shutDown(false)
+{
+  static_assert((ringSize & (ringSize - 1)) == 0, "ringSize is a power of 2");
+  for (size_t i = 0; i < ringSize; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  thread = std::thread([this]() { run(); });
+}
+
+Logger::~Logger()
+{
+  {
+    std::lock_guard<std::mutex> lock(runMutex);
+    shutDown = true;
+  }
+  runCv.notify_one();
+  thread.join();
+  flush();
+}
+
+void
+Logger::setSink(std::ostream* out)
+{
+  assert(out);
+  std::lock_guard<std::mutex> lock(drainMutex);
+  sink = out;
+}
+
+void
+Logger::flush()
+{
+  std::lock_guard<std::mutex> lock(drainMutex);
+  while (drainOne(*sink)) {
+  }
+
+  uint64_t lost = dropped.load(std::memory_order_relaxed);
+  if (lost != droppedReported) {
+    *sink << "log ring full, dropped " << lost - droppedReported
+          << " messages" << std::endl;
+    droppedReported = lost;
+  }
+  sink->flush();
+}
+
+Logger&
+Logger::global()
+{
+  static Logger logger;
+  return logger;
+}
+
+///
+/// Private Implementation
+///
+
+// A bounded multi producer ring: each slot's sequence says whose turn it
+// is. A producer owns slot pos once it moves enqueuePos past it, and hands
+// it to the reader by setting the sequence to pos + 1.
+Logger::Slot*
+Logger::claim()
+{
+  uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots[pos & (ringSize - 1)];
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto diff = int64_t(sequence - pos);
+    if (diff == 0) {
+      if (enqueuePos.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_relaxed)) {
+        return slot;
+      }
+    } else if (diff < 0) {
+      return nullptr; // full, the reader has not got to it yet
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void
+Logger::commit(Slot* slot)
+{
+  uint64_t pos = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool
+Logger::drainOne(std::ostream& out)
+{
+  Slot* slot = &slots[dequeuePos & (ringSize - 1)];
+  if (slot->sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+    return false;
+  }
+  write(out, slot->record);
+  slot->sequence.store(dequeuePos + ringSize, std::memory_order_release);
+  dequeuePos++;
+  return true;
+}
+
+void
+Logger::captureBytes(Record& record,
+                     Printer printer,
+                     const void* bytes,
+                     size_t length,
+                     bool cut)
+{
+  size_t room = record.args.size() - record.used;
+  if (room < argHeader + (cut ? 0 : length)) {
+    record.truncated = true;
+    return;
+  }
+  if (length > room - argHeader) {
+    length = room - argHeader;
+    record.truncated = true;
+  }
+
+  uint8_t* at = record.args.data() + record.used;
+  std::memcpy(at, &printer, sizeof(Printer));
+  at[sizeof(Printer)] = uint8_t(length);
+  std::memcpy(at + argHeader, bytes, length);
+  record.used = uint16_t(record.used + argHeader + length);
+}
+
+void
+Logger::printString(std::ostream& out, const uint8_t* bytes, size_t length)
+{
+  out.write(reinterpret_cast<const char*>(bytes), std::streamsize(length));
+}
+
+void
+Logger::write(std::ostream& out, const Record& record)
+{
+  static const char levels[] = "TDIWE";
+
+  auto since = record.time.time_since_epoch();
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since);
+  auto millis =
+    std::chrono::duration_cast<std::chrono::milliseconds>(since - seconds);
+  std::time_t t = std::time_t(seconds.count());
+  std::tm utc{};
+#if defined(_WIN32)
+  gmtime_s(&utc, &t);
+#else
+  gmtime_r(&t, &utc);
+#endif
+
+  const char* file = record.site->file;
+  for (const char* p = file; *p; p++) {
+    if (*p == '/' || *p == '\\') {
+      file = p + 1;
+    }
+  }
+
+  out << std::setfill('0') << std::setw(2) << utc.tm_hour << ":"
+      << std::setw(2) << utc.tm_min << ":" << std::setw(2) << utc.tm_sec
+      << "." << std::setw(3) << millis.count() << std::setfill(' ') << " "
+      << levels[size_t(record.site->level)] << " " << file << ":"
+      << record.site->line << " ";
+
+  size_t at = 0;
+  for (const char* f = record.format; *f; f++) {
+    if (f[0] == '{' && f[1] == '}') {
+      f++;
+      if (at < record.used) {
+        Printer printer;
+        std::memcpy(&printer, record.args.data() + at, sizeof(Printer));
+        size_t length = record.args[at + sizeof(Printer)];
+        printer(out, record.args.data() + at + argHeader, length);
+        at += argHeader + length;
+      } else {
+        out << "{}";
+      }
+      continue;
+    }
+    out << *f;
+  }
+
+  if (record.truncated) {
+    out << " ...";
+  }
+  if (record.suppressed) {
+    out << " (" << record.suppressed << " more not logged)";
+  }
+  out << "\n";
+}
+
+void
+Logger::run()
+{
+  std::unique_lock<std::mutex> lock(runMutex);
+  while (!shutDown) {
+    lock.unlock();
+    flush();
+    lock.lock();
+    runCv.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
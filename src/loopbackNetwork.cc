@@ -0,0 +1,57 @@
+#include <cassert>
+
+#include "loopbackPipe.hh"
+#include "quicr/loopbackNetwork.hh"
+
+using namespace MediaNet;
+
+LoopbackNetwork::LoopbackNetwork()
+  : LoopbackNetwork(LinkConfig())
+{}
+
+LoopbackNetwork::LoopbackNetwork(const LinkConfig& link)
+  : config(link)
+  , ports(std::make_unique<std::array<std::atomic<LoopbackEndpoint*>, 65536>>())
+  , nextEphemeral(49152)
+{
+  for (auto& port : *ports) {
+    port.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+LoopbackNetwork::~LoopbackNetwork() = default;
+
+LoopbackEndpoint*
+LoopbackNetwork::bind(uint16_t port)
+{
+  std::lock_guard<std::mutex> lock(bindMutex);
+
+  if (port == 0) {
+    // the ephemeral range, as a kernel would pick from
+    for (int tries = 0; tries < 16384 && port == 0; tries++) {
+      if (!find(nextEphemeral)) {
+        port = nextEphemeral;
+      }
+      nextEphemeral = nextEphemeral == 65535 ? 49152 : nextEphemeral + 1;
+    }
+    if (port == 0) {
+      return nullptr;
+    }
+  } else if (find(port)) {
+    return nullptr;
+  }
+
+  endpoints.push_back(std::make_unique<LoopbackEndpoint>(port));
+  (*ports)[port].store(endpoints.back().get(), std::memory_order_release);
+  return endpoints.back().get();
+}
+
+void
+LoopbackNetwork::unbind(LoopbackEndpoint* endpoint)
+{
+  assert(endpoint);
+  std::lock_guard<std::mutex> lock(bindMutex);
+  LoopbackEndpoint* bound = endpoint;
+  (*ports)[endpoint->port].compare_exchange_strong(
+    bound, nullptr, std::memory_order_release);
+}
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#elif defined(_WIN32)
+#include <winsock2.h>
+#endif
+
+#include "loopbackPipe.hh"
+#include "quicr/trace.hh"
+
+using namespace MediaNet;
+
+static IpAddr
+loopbackAddress(uint16_t port)
+{
+  IpAddr addr{};
+  addr.addr.sin_family = AF_INET;
+  addr.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.addr.sin_port = htons(port);
+  addr.addrLen = sizeof(addr.addr);
+  return addr;
+}
+
+static int64_t
+toNs(const LoopbackEndpoint::timepoint& tp)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           tp.time_since_epoch())
+    .count();
+}
+
+///
+/// LoopbackEndpoint
+///
+
+LoopbackEndpoint::LoopbackEndpoint(uint16_t port)
+  : port(port)
+  , address(loopbackAddress(port))
+  , head(new Node())
+  , numArrived(0)
+  , waiting(0)
+  , linkFreeNs(0)
+  , numSent(0)
+{
+  tail = head.load();
+}
+
+LoopbackEndpoint::~LoopbackEndpoint()
+{
+  while (tail) {
+    Node* next = tail->next.load();
+    delete tail;
+    tail = next;
+  }
+}
+
+// Vyukov's queue: a producer swaps itself in as head and then links the
+// old head to it. The owner follows the links from tail, which always
+// points at a node it has already taken the packet out of.
+void
+LoopbackEndpoint::deliver(std::unique_ptr<Packet> packet, timepoint arrival)
+{
+  auto node = new Node();
+  node->packet = std::move(packet);
+  node->arrival = arrival;
+
+  Node* prev = head.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node);
+
+  // pairs with waitArrival() counting itself in before it looks
+  if (waiting.load() > 0) {
+    event.notify();
+  }
+}
+
+std::unique_ptr<Packet>
+LoopbackEndpoint::take(timepoint now)
+{
+  collect();
+  if (arrived.empty() || arrived.front().arrival > now) {
+    return std::unique_ptr<Packet>(nullptr);
+  }
+
+  std::pop_heap(arrived.begin(), arrived.end(), later);
+  auto packet = std::move(arrived.back().packet);
+  arrived.pop_back();
+  return packet;
+}
+
+bool
+LoopbackEndpoint::waitArrival(timepoint deadline)
+{
+  while (true) {
+    collect();
+    auto now = std::chrono::steady_clock::now();
+    if (!arrived.empty() && arrived.front().arrival <= now) {
+      return true;
+    }
+    if (now >= deadline) {
+      return false;
+    }
+
+    timepoint wake = deadline;
+    if (!arrived.empty()) {
+      wake = std::min(wake, arrived.front().arrival);
+    }
+
+    event.clear();
+    waiting++;
+    if (!tail->next.load()) {
+      event.waitUntil(wake);
+    }
+    waiting--;
+  }
+}
+
+bool
+LoopbackEndpoint::depart(size_t bytes,
+                         const LoopbackNetwork::LinkConfig& link,
+                         timepoint now,
+                         timepoint& departure)
+{
+  if (link.bitrateBps == 0) {
+    departure = now;
+    return true;
+  }
+
+  int64_t nowNs = toNs(now);
+  auto sendNs = int64_t(bytes * 8 * 1000000000 / link.bitrateBps);
+  int64_t maxWaitNs = int64_t(link.queueMs) * 1000000;
+
+  int64_t free = linkFreeNs.load(std::memory_order_relaxed);
+  int64_t done;
+  do {
+    int64_t start = std::max(free, nowNs);
+    if (start - nowNs > maxWaitNs) {
+      return false; // queue full
+    }
+    done = start + sendNs;
+  } while (!linkFreeNs.compare_exchange_weak(
+    free, done, std::memory_order_relaxed));
+
+  departure = timepoint(std::chrono::nanoseconds(done));
+  return true;
+}
+
+bool
+LoopbackEndpoint::lose(const LoopbackNetwork::LinkConfig& link)
+{
+  if (link.lossPerMillion == 0) {
+    return false;
+  }
+
+  // splitmix64 of the seed, port and packet number, so a run loses the
+  // same packets every time
+  uint64_t x = link.seed ^ (uint64_t(port) << 40) ^
+               numSent.fetch_add(1, std::memory_order_relaxed);
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  x ^= x >> 31;
+  return x % 1000000 < link.lossPerMillion;
+}
+
+///
+/// LoopbackPipe
+///
+
+LoopbackPipe::LoopbackPipe(LoopbackNetwork& network)
+  : network(network)
+  , endpoint(nullptr)
+  , serverPort(0)
+{}
+
+LoopbackPipe::~LoopbackPipe()
+{
+  LoopbackPipe::stop();
+}
+
+bool
+LoopbackPipe::start(uint16_t port,
+                    const std::string& serverName,
+                    PipeInterface* upStream)
+{
+  prevPipe = upStream;
+
+  LoopbackEndpoint* bound = nullptr;
+  if (serverName.empty()) {
+    bound = network.bind(port);
+  } else {
+    bound = network.bind(0);
+    serverPort = port;
+  }
+  if (!bound) {
+    std::clog << "LoopbackPipe: port " << port << " is taken" << std::endl;
+    return false;
+  }
+
+  endpoint.store(bound);
+  return true;
+}
+
+bool
+LoopbackPipe::ready() const
+{
+  return endpoint.load() != nullptr;
+}
+
+void
+LoopbackPipe::stop()
+{
+  LoopbackEndpoint* bound = endpoint.exchange(nullptr);
+  if (bound) {
+    network.unbind(bound);
+  }
+}
+
+void
+LoopbackPipe::registerMetrics(MetricsRegistry& registry,
+                              const std::string& labels)
+{
+  packetsSent = &registry.counter(
+    "quicr_loopback_sent_packets_total", "packets sent", labels);
+  packetsReceived = &registry.counter(
+    "quicr_loopback_received_packets_total", "packets received", labels);
+  packetsLost = &registry.counter("quicr_loopback_lost_packets_total",
+                                  "packets lost to loss or a full queue",
+                                  labels);
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+bool
+LoopbackPipe::send(std::unique_ptr<Packet> packet)
+{
+  LoopbackEndpoint* from = endpoint.load();
+  if (!from || !packet || packet->fullSize() == 0) {
+    return false;
+  }
+
+  uint16_t toPort = serverPort;
+  if (packet->getDst().addrLen != 0) {
+    toPort = ntohs(packet->getDst().addr.sin_port);
+  }
+
+  if (capture) {
+    capture->record(from->address,
+                    loopbackAddress(toPort),
+                    &packet->fullData(),
+                    packet->fullSize());
+  }
+
+  if (packetsSent) {
+    packetsSent->add();
+  }
+  QUICR_TRACE(packet, sent);
+  QUICR_TRACE_FINISH(packet);
+
+  const auto& link = network.link();
+  auto now = std::chrono::steady_clock::now();
+  LoopbackEndpoint::timepoint departure;
+  if (!from->depart(packet->fullSize(), link, now, departure) ||
+      from->lose(link)) {
+    if (packetsLost) {
+      packetsLost->add();
+    }
+    return true;
+  }
+
+  LoopbackEndpoint* to = network.find(toPort);
+  if (!to) {
+    return true; // nobody there, as with UDP
+  }
+
+  // a fresh packet with just the bytes, as a socket would hand over
+  auto received = std::make_unique<Packet>();
+  received->resizeFull(int(packet->fullSize()));
+  std::memcpy(&received->fullData(), &packet->fullData(), packet->fullSize());
+  received->setSrc(from->address);
+
+  to->deliver(std::move(received),
+              departure + std::chrono::milliseconds(link.delayMs));
+  return true;
+}
+
+std::unique_ptr<Packet>
+LoopbackPipe::recv()
+{
+  LoopbackEndpoint* bound = endpoint.load();
+  if (!bound) {
+    return std::unique_ptr<Packet>(nullptr);
+  }
+
+  auto packet = bound->take(std::chrono::steady_clock::now());
+  if (!packet) {
+    return packet;
+  }
+
+  QUICR_TRACE(packet, received);
+  if (capture) {
+    capture->record(packet->getSrc(),
+                    bound->address,
+                    &packet->fullData(),
+                    packet->fullSize());
+  }
+  if (packetsReceived) {
+    packetsReceived->add();
+  }
+  return packet;
+}
+
+bool
+LoopbackPipe::waitReadable(std::chrono::milliseconds timeout) const
+{
+  LoopbackEndpoint* bound = endpoint.load();
+  if (!bound) {
+    return false;
+  }
+  return bound->waitArrival(std::chrono::steady_clock::now() + timeout);
+}
+
+///
+/// Private Implementation
+///
+
+void
+LoopbackEndpoint::collect()
+{
+  while (Node* next = tail->next.load(std::memory_order_acquire)) {
+    arrived.push_back(
+      Arrived{ next->arrival, numArrived++, std::move(next->packet) });
+    std::push_heap(arrived.begin(), arrived.end(), later);
+    delete tail;
+    tail = next;
+  }
+}
+
+bool
+LoopbackEndpoint::later(const Arrived& a, const Arrived& b)
+{
+  return a.arrival > b.arrival || (a.arrival == b.arrival && a.order > b.order);
+}
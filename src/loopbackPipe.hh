@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/metrics.hh"
+#include "quicr/packet.hh"
+#include "transportPipe.hh"
+#include "wakeupEvent.hh"
+
+namespace MediaNet {
+
+// One address on a LoopbackNetwork. Any thread may deliver() to it; only
+// the thread that owns it, its LoopbackPipe's receiver, may take().
+class LoopbackEndpoint
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  explicit LoopbackEndpoint(uint16_t port);
+  ~LoopbackEndpoint();
+  LoopbackEndpoint(const LoopbackEndpoint&) = delete;
+  LoopbackEndpoint& operator=(const LoopbackEndpoint&) = delete;
+
+  void deliver(std::unique_ptr<Packet> packet, timepoint arrival);
+
+  // the earliest packet that has arrived by now, nullptr if none
+  std::unique_ptr<Packet> take(timepoint now);
+  // false if nothing arrives by the deadline
+  bool waitArrival(timepoint deadline);
+
+  // when what this endpoint sends gets onto the link, given the link's
+  // bitrate, or false if it would wait past queueMs
+  bool depart(size_t bytes,
+              const LoopbackNetwork::LinkConfig& link,
+              timepoint now,
+              timepoint& departure);
+  // whether the link loses the next packet this endpoint sends
+  bool lose(const LoopbackNetwork::LinkConfig& link);
+
+  const uint16_t port;
+  const IpAddr address;
+
+private:
+  struct Node
+  {
+    std::unique_ptr<Packet> packet;
+    timepoint arrival;
+    std::atomic<Node*> next{ nullptr };
+  };
+
+  struct Arrived
+  {
+    timepoint arrival;
+    uint64_t order;
+    std::unique_ptr<Packet> packet;
+  };
+  static bool later(const Arrived& a, const Arrived& b); // heap order
+
+  // inbox, a queue many threads push on and the owner pops from
+  std::atomic<Node*> head;
+  Node* tail;
+  void collect();
+
+  // moved out of the inbox, earliest arrival first
+  std::vector<Arrived> arrived;
+  uint64_t numArrived;
+
+  WakeupEvent event;
+  std::atomic<int> waiting;
+
+  std::atomic<int64_t> linkFreeNs; // steady clock, when the link is idle
+  std::atomic<uint64_t> numSent;
+};
+
+// Stands in for UdpPipe on a LoopbackNetwork
+class LoopbackPipe : public TransportPipe
+{
+public:
+  explicit LoopbackPipe(LoopbackNetwork& network);
+  ~LoopbackPipe() override;
+
+  // a server binds port, a client (serverName not empty) binds a free one
+  // and sends to port
+  bool start(uint16_t port,
+             const std::string& serverName,
+             PipeInterface* upStream) override;
+  [[nodiscard]] bool ready() const override;
+  void stop() override;
+
+  bool send(std::unique_ptr<Packet> packet) override;
+  std::unique_ptr<Packet> recv() override; // non blocking
+
+  bool waitReadable(std::chrono::milliseconds timeout) const override;
+  [[nodiscard]] int getFd() const override { return -1; }
+
+  // call before start()
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+private:
+  LoopbackNetwork& network;
+  std::atomic<LoopbackEndpoint*> endpoint;
+  uint16_t serverPort;
+
+  Counter* packetsSent = nullptr;
+  Counter* packetsReceived = nullptr;
+  Counter* packetsLost = nullptr;
+};
+
+} // namespace MediaNet
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#include "quicr/metrics.hh"
+
+using namespace MediaNet;
+
+///
+/// Counter
+///
+
+uint64_t
+Counter::value() const
+{
+  uint64_t sum = 0;
+  for (const auto& shard : shards) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+// threads take shards round robin as they first touch any counter
+size_t
+Counter::shardIndex()
+{
+  static std::atomic<size_t> nextShard(0);
+  static thread_local const size_t shard =
+    nextShard.fetch_add(1, std::memory_order_relaxed) % numShards;
+  return shard;
+}
+
+///
+/// Histogram
+///
+
+Histogram::Histogram(std::vector<uint64_t> bounds)
+  : limits(std::move(bounds))
+  , counts(new std::atomic<uint64_t>[limits.size() + 1])
+{
+  assert(std::is_sorted(limits.begin(), limits.end()));
+  for (size_t i = 0; i <= limits.size(); i++) {
+    counts[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void
+Histogram::record(uint64_t v)
+{
+  size_t bucket =
+    std::lower_bound(limits.begin(), limits.end(), v) - limits.begin();
+  counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(v, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t>
+Histogram::buckets() const
+{
+  std::vector<uint64_t> out(limits.size() + 1);
+  for (size_t i = 0; i < out.size(); i++) {
+    out[i] = counts[i].load(std::memory_order_relaxed);
+  }
+  return out;
+}
+
+uint64_t
+Histogram::count() const
+{
+  uint64_t sum = 0;
+  for (size_t i = 0; i <= limits.size(); i++) {
+    sum += counts[i].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+std::vector<uint64_t>
+Histogram::decadeBounds(uint64_t max)
+{
+  std::vector<uint64_t> bounds;
+  for (uint64_t decade = 1; decade <= max; decade *= 10) {
+    for (uint64_t step : { 1, 2, 5 }) {
+      if (decade * step <= max) {
+        bounds.push_back(decade * step);
+      }
+    }
+  }
+  return bounds;
+}
+
+///
+/// MetricsRegistry
+///
+
+MetricsRegistry::MetricsRegistry(size_t maxMetrics)
+  : entries(new Entry[maxMetrics])
+  , capacity(maxMetrics)
+  , used(0)
+  , readers(0)
+{}
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+Counter&
+MetricsRegistry::counter(const std::string& name,
+                         const std::string& help,
+                         const std::string& labels)
+{
+  std::lock_guard<std::mutex> lock(registerMutex);
+  return *add(name, help, labels, Type::counter, {}).counter;
+}
+
+Gauge&
+MetricsRegistry::gauge(const std::string& name,
+                       const std::string& help,
+                       const std::string& labels)
+{
+  std::lock_guard<std::mutex> lock(registerMutex);
+  return *add(name, help, labels, Type::gauge, {}).gauge;
+}
+
+Histogram&
+MetricsRegistry::histogram(const std::string& name,
+                           const std::string& help,
+                           const std::vector<uint64_t>& bounds,
+                           const std::string& labels)
+{
+  std::lock_guard<std::mutex> lock(registerMutex);
+  return *add(name, help, labels, Type::histogram, bounds).histogram;
+}
+
+void
+MetricsRegistry::remove(const std::string& labels)
+{
+  std::lock_guard<std::mutex> lock(registerMutex);
+  auto labelled = [&labels](const Entry& entry) {
+    return entry.labels.compare(0, labels.size(), labels) == 0 &&
+           (entry.labels.size() == labels.size() ||
+            entry.labels[labels.size()] == ',');
+  };
+
+  size_t num = used.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < num; i++) {
+    Entry& entry = entries[i];
+    if (!entry.live.load() || !labelled(entry)) {
+      continue;
+    }
+    entry.live.store(false);
+    index.erase(entry.name + "{" + entry.labels + "}");
+    retired.push_back(i);
+  }
+
+  overflow.erase(std::remove_if(overflow.begin(),
+                                overflow.end(),
+                                [&labelled](const std::unique_ptr<Entry>& e) {
+                                  return labelled(*e);
+                                }),
+                 overflow.end());
+}
+
+std::vector<MetricsRegistry::Sample>
+MetricsRegistry::snapshot() const
+{
+  readers.fetch_add(1);
+  size_t num = used.load(std::memory_order_acquire);
+
+  std::vector<Sample> samples;
+  samples.reserve(num);
+  for (size_t i = 0; i < num; i++) {
+    const Entry& entry = entries[i];
+    if (!entry.live.load()) {
+      continue;
+    }
+    Sample sample{ entry.name, entry.help, entry.labels, entry.type, 0,
+                   {},         {},         0,            0 };
+    switch (entry.type) {
+      case Type::counter:
+        sample.value = int64_t(entry.counter->value());
+        break;
+      case Type::gauge:
+        sample.value = entry.gauge->value();
+        break;
+      case Type::histogram:
+        sample.bounds = entry.histogram->bounds();
+        sample.buckets = entry.histogram->buckets();
+        sample.sum = entry.histogram->sum();
+        for (auto bucket : sample.buckets) {
+          sample.count += bucket;
+        }
+        break;
+    }
+    samples.push_back(std::move(sample));
+  }
+  readers.fetch_sub(1);
+  return samples;
+}
+
+MetricsRegistry&
+MetricsRegistry::global()
+{
+  static MetricsRegistry registry;
+  return registry;
+}
+
+std::string
+MediaNet::joinLabels(const std::string& a, const std::string& b)
+{
+  if (a.empty()) {
+    return b;
+  }
+  if (b.empty()) {
+    return a;
+  }
+  return a + "," + b;
+}
+
+///
+/// Private Implementation
+///
+
+// called with registerMutex held
+MetricsRegistry::Entry&
+MetricsRegistry::add(const std::string& name,
+                     const std::string& help,
+                     const std::string& labels,
+                     Type type,
+                     const std::vector<uint64_t>& bounds)
+{
+  std::string key = name + "{" + labels + "}";
+  auto found = index.find(key);
+  if (found != index.end() && entries[found->second].type == type) {
+    return entries[found->second];
+  }
+  if (found != index.end()) {
+    std::clog << "metric " << key << " registered with two types" << std::endl;
+    assert(0);
+  }
+
+  // removed slots are safe to write once no snapshot is going on, one
+  // that starts after this sees them as not live until they are again
+  if (freeSlots.empty() && !retired.empty() && readers.load() == 0) {
+    freeSlots.swap(retired);
+  }
+
+  Entry* entry = nullptr;
+  size_t num = used.load(std::memory_order_relaxed);
+  size_t slot = num;
+  bool publish = found == index.end() && (!freeSlots.empty() || num < capacity);
+  if (publish) {
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    entry = &entries[slot];
+  } else {
+    if (found == index.end() && overflow.empty()) {
+      std::clog << "metrics registry full, not reporting " << key << std::endl;
+    }
+    overflow.push_back(std::make_unique<Entry>());
+    entry = overflow.back().get();
+  }
+
+  entry->name = name;
+  entry->help = help;
+  entry->labels = labels;
+  entry->type = type;
+  entry->counter.reset();
+  entry->gauge.reset();
+  entry->histogram.reset();
+  switch (type) {
+    case Type::counter:
+      entry->counter = std::make_unique<Counter>();
+      break;
+    case Type::gauge:
+      entry->gauge = std::make_unique<Gauge>();
+      break;
+    case Type::histogram:
+      entry->histogram = std::make_unique<Histogram>(bounds);
+      break;
+  }
+
+  if (publish) {
+    index[key] = slot;
+    entry->live.store(true);
+    if (slot == num) {
+      used.store(num + 1, std::memory_order_release);
+    }
+  }
+  return *entry;
+}
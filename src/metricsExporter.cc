@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "quicr/metricsExporter.hh"
+#include "wakeupEvent.hh"
+
+using namespace MediaNet;
+
+#if defined(__linux__)
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+MetricsExporter::MetricsExporter(MetricsRegistry& reg)
+  : registry(reg)
+  , listenFd(-1)
+  , boundPort(0)
+  , stopEvent(std::make_unique<WakeupEvent>())
+  , shutDown(false)
+{}
+
+MetricsExporter::~MetricsExporter()
+{
+  stop();
+}
+
+void
+MetricsExporter::addCollector(Collector collector)
+{
+  assert(!thread.joinable());
+  collectors.push_back(std::move(collector));
+}
+
+bool
+MetricsExporter::start(uint16_t port, const std::string& address)
+{
+  assert(!thread.joinable());
+#if defined(__linux__) || defined(__APPLE__)
+  if (stopEvent->fd() < 0) {
+    return false;
+  }
+
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    std::cerr << "metrics exporter could not create socket: "
+              << strerror(errno) << std::endl;
+    return false;
+  }
+
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr
+  {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+      bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(listenFd, 16) != 0) {
+    std::cerr << "metrics exporter could not listen on " << address << ":"
+              << port << ": " << strerror(errno) << std::endl;
+    ::close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+
+  socklen_t addrLen = sizeof(addr);
+  getsockname(listenFd, (struct sockaddr*)&addr, &addrLen);
+  boundPort = ntohs(addr.sin_port);
+
+  shutDown = false;
+  thread = std::thread([this]() { run(); });
+  return true;
+#else
+  std::cerr << "metrics exporter not supported on this platform" << std::endl;
+  return false;
+#endif
+}
+
+void
+MetricsExporter::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  shutDown = true;
+  stopEvent->notify();
+  thread.join();
+  stopEvent->clear();
+
+#if defined(__linux__) || defined(__APPLE__)
+  ::close(listenFd);
+#endif
+  listenFd = -1;
+}
+
+std::string
+MetricsExporter::format(const Samples& samples)
+{
+  // group by name, keeping the order each name first showed up in
+  std::map<std::string, size_t> firstSeen;
+  std::vector<const MetricsRegistry::Sample*> sorted;
+  for (const auto& sample : samples) {
+    firstSeen.emplace(sample.name, firstSeen.size());
+    sorted.push_back(&sample);
+  }
+  std::stable_sort(sorted.begin(),
+                   sorted.end(),
+                   [&firstSeen](const auto* a, const auto* b) {
+                     return firstSeen.at(a->name) < firstSeen.at(b->name);
+                   });
+
+  auto withLabels = [](const std::string& name, const std::string& labels) {
+    return labels.empty() ? name : name + "{" + labels + "}";
+  };
+
+  std::ostringstream out;
+  const std::string* family = nullptr;
+  for (const auto* sample : sorted) {
+    if (!family || *family != sample->name) {
+      family = &sample->name;
+
+      // counter samples are name_total, the family is the name without it
+      std::string familyName = sample->name;
+      const char* type = "gauge";
+      switch (sample->type) {
+        case MetricsRegistry::Type::counter:
+          type = "counter";
+          if (familyName.size() > 6 &&
+              familyName.compare(familyName.size() - 6, 6, "_total") == 0) {
+            familyName.resize(familyName.size() - 6);
+          }
+          break;
+        case MetricsRegistry::Type::gauge:
+          break;
+        case MetricsRegistry::Type::histogram:
+          type = "histogram";
+          break;
+      }
+      out << "# TYPE " << familyName << " " << type << "\n";
+      if (!sample->help.empty()) {
+        out << "# HELP " << familyName << " " << sample->help << "\n";
+      }
+    }
+
+    if (sample->type != MetricsRegistry::Type::histogram) {
+      out << withLabels(sample->name, sample->labels) << " " << sample->value
+          << "\n";
+      continue;
+    }
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < sample->buckets.size(); i++) {
+      cumulative += sample->buckets[i];
+      std::string le = i < sample->bounds.size()
+                         ? std::to_string(sample->bounds[i])
+                         : std::string("+Inf");
+      out << withLabels(sample->name + "_bucket",
+                        joinLabels(sample->labels, "le=\"" + le + "\""))
+          << " " << cumulative << "\n";
+    }
+    out << withLabels(sample->name + "_count", sample->labels) << " "
+        << sample->count << "\n";
+    out << withLabels(sample->name + "_sum", sample->labels) << " "
+        << sample->sum << "\n";
+  }
+  out << "# EOF\n";
+  return out.str();
+}
+
+///
+/// Private Implementation
+///
+
+void
+MetricsExporter::run()
+{
+#if defined(__linux__) || defined(__APPLE__)
+  struct pollfd fds[2];
+  fds[0].fd = listenFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = stopEvent->fd();
+  fds[1].events = POLLIN;
+
+  while (!shutDown) {
+    fds[0].revents = 0;
+    fds[1].revents = 0;
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "metrics exporter poll failed: " << strerror(errno)
+                << std::endl;
+      return;
+    }
+    if (!(fds[0].revents & POLLIN)) {
+      continue;
+    }
+
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    serve(fd);
+    ::close(fd);
+  }
+#endif
+}
+
+// one request per connection, a scraper that stalls is dropped after a
+// second rather than holding up the next one
+void
+MetricsExporter::serve(int fd)
+{
+#if defined(__linux__) || defined(__APPLE__)
+  struct timeval timeout
+  {};
+  timeout.tv_sec = 1;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#if defined(__APPLE__)
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+  std::string request;
+  char buf[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < 8192) {
+    auto len = ::recv(fd, buf, sizeof(buf), 0);
+    if (len <= 0) {
+      return;
+    }
+    request.append(buf, size_t(len));
+  }
+
+  std::string status = "404 Not Found";
+  std::string contentType = "text/plain";
+  std::string body = "not found\n";
+  if (request.compare(0, 13, "GET /metrics ") == 0 ||
+      request.compare(0, 13, "GET /metrics?") == 0) {
+    auto samples = registry.snapshot();
+    for (auto& collector : collectors) {
+      collector(samples);
+    }
+    status = "200 OK";
+    contentType =
+      "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    body = format(samples);
+  }
+
+  std::string response = "HTTP/1.1 " + status +
+                         "\r\nContent-Type: " + contentType +
+                         "\r\nContent-Length: " + std::to_string(body.size()) +
+                         "\r\nConnection: close\r\n\r\n" + body;
+  size_t sent = 0;
+  while (sent < response.size()) {
+    auto len =
+      ::send(fd, response.data() + sent, response.size() - sent, sendFlags);
+    if (len <= 0) {
+      return;
+    }
+    sent += size_t(len);
+  }
+#else
+  (void)fd;
+#endif
+}
@@ -7,6 +7,14 @@
 
 using namespace MediaNet;
 
+static uint32_t
+toUs(std::chrono::steady_clock::time_point tp)
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+           tp.time_since_epoch())
+    .count();
+}
+
 PacerPipe::PacerPipe(PipeInterface *t)
     : PipeInterface(t), rateCtrl(this), shutDown(false), oldPhase(-1),
       mtu(1200), targetPpsUp(500), useConstantPacketRate(true), nextSeqNum(1) {
@@ -44,6 +52,13 @@ bool PacerPipe::start(const uint16_t port, const std::string& server,
 void PacerPipe::stop() {
   assert(nextPipe);
   shutDown = true;
+
+  // before the pipes the threads call go away
+  for (auto* thread : { &recvThread, &sendThread }) {
+    if (thread->joinable() && thread->get_id() != std::this_thread::get_id()) {
+      thread->join();
+    }
+  }
   nextPipe->stop();
 }
 
@@ -110,12 +125,11 @@ PacerPipe::runNetSend()
     seqTag.clientSeqNum = nextSeqNum++;
 
     packet << seqTag;
+    // the transport may tell us when it really left, see sentAt()
+    packet->setSendId(seqTag.clientSeqNum);
 
     std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
-    std::chrono::steady_clock::duration dn = tp.time_since_epoch();
-    uint32_t nowUs =
-      (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn)
-        .count();
+    uint32_t nowUs = toUs(tp);
 
     uint16_t bits = (uint16_t)packet->fullSize() * 8 +
                     42 * 8; // Capture shows 42 byte header before UDP payload
@@ -162,11 +176,13 @@ PacerPipe::runNetRecv()
       continue;
     }
 
-    std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now();
-    std::chrono::steady_clock::duration dn = tp.time_since_epoch();
-    uint32_t nowUs =
-      (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(dn)
-        .count();
+    // when it arrived rather than when this thread got to it, if the
+    // transport knows
+    std::chrono::steady_clock::time_point tp = packet->getWireTime();
+    if (tp.time_since_epoch().count() == 0) {
+      tp = std::chrono::steady_clock::now();
+    }
+    uint32_t nowUs = toUs(tp);
 
     // look for ACKs
 
@@ -176,8 +192,13 @@ PacerPipe::runNetRecv()
       NetAck ackTag{};
       packet >> ackTag;
       bool congested = false; // TODO - add to ACK
-      rateCtrl.recvAck(
-        ackTag.clientSeqNum, ackTag.recvTimeUs, nowUs, congested, haveAck);
+      rateCtrl.recvAck(ackTag.clientSeqNum,
+                       ackTag.ackVec,
+                       ackTag.recvTimeUs,
+                       ackTag.ackDelayUs,
+                       nowUs,
+                       congested,
+                       haveAck);
       haveAck = false; // treat redundant ACK as received but not acks
     }
 
@@ -204,6 +225,15 @@ PacerPipe::runNetRecv()
   }
 }
 
+void
+PacerPipe::sentAt(
+  uint32_t sendId,
+  const std::chrono::time_point<std::chrono::steady_clock>& when)
+{
+  // called from the transport's recv, so on the recv thread like recvAck
+  rateCtrl.sentAt(sendId, toUs(when));
+}
+
 uint64_t
 PacerPipe::getTargetUpstreamBitrate()
 {
@@ -37,10 +37,14 @@ public:
                        uint64_t maxBps) override;
   void updateRTT(uint16_t minRttMs, uint16_t bigRttMs) override;
 
+  void sentAt(uint32_t sendId,
+              const std::chrono::time_point<std::chrono::steady_clock>& when)
+    override;
+
 private:
   RateCtrl rateCtrl;
 
-  bool shutDown;
+  std::atomic<bool> shutDown;
 
   void runNetRecv();
   std::thread recvThread;
@@ -18,6 +18,7 @@
 #endif
 
 #include "quicr/packet.hh"
+#include <algorithm>
 #include <array>
 #include <iomanip>
 #include <sstream>
@@ -86,6 +87,34 @@ Packet::setDst(const IpAddr& dstAddr)
   dst = dstAddr;
 }
 
+void
+Packet::resize(int size)
+{
+  size_t oldSize = buffer.size();
+  buffer.resize(headerSize + size);
+  if (buffer.size() > oldSize) {
+    std::fill(buffer.begin() + oldSize, buffer.end(), 0);
+  }
+}
+
+uint8_t*
+Packet::acquire(size_t maxSize)
+{
+  assert(acquired == 0);
+  size_t start = buffer.size();
+  buffer.resize(start + maxSize);
+  acquired = maxSize;
+  return buffer.data() + start;
+}
+
+void
+Packet::commit(size_t size)
+{
+  assert(size <= acquired);
+  buffer.resize(buffer.size() - acquired + size);
+  acquired = 0;
+}
+
 void
 Packet::copy(const Packet& p)
 {
@@ -98,6 +127,11 @@ Packet::copy(const Packet& p)
 
   src = p.src;
   dst = p.dst;
+  wireTime = p.wireTime;
+  sendId = p.sendId;
+#if defined(QUICR_TRACING)
+  trace = p.trace;
+#endif
 }
 
 std::string
@@ -121,6 +155,31 @@ Packet::clone() const
   return p;
 }
 
+std::unique_ptr<Packet>
+Packet::cloneSlice(size_t offset, size_t len) const
+{
+  assert(headerSize + offset + len <= buffer.size());
+  std::unique_ptr<Packet> p = std::make_unique<Packet>();
+
+  p->name = name;
+  p->headerSize = headerSize;
+  p->priority = priority;
+  p->reliable = reliable;
+  p->useFEC = useFEC;
+  p->src = src;
+  p->dst = dst;
+#if defined(QUICR_TRACING)
+  p->trace = trace;
+#endif
+
+  auto payload = buffer.begin() + headerSize + offset;
+  p->buffer.reserve(headerSize + len);
+  p->buffer.assign(buffer.begin(), buffer.begin() + headerSize);
+  p->buffer.insert(p->buffer.end(), payload, payload + len);
+
+  return p;
+}
+
 bool
 Packet::isReliable() const
 {
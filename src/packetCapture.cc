@@ -0,0 +1,322 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "quicr/packetCapture.hh"
+
+using namespace MediaNet;
+
+// pcap magic numbers, written in the host's byte order, which tells the
+// reader both the byte order and the timestamp resolution
+static constexpr uint32_t pcapMagicNs = 0xa1b23c4d;
+static constexpr uint32_t pcapMagicUs = 0xa1b2c3d4;
+static constexpr uint32_t linkTypeRaw = 101;
+static constexpr uint32_t linkTypeIpv4 = 228;
+
+static constexpr size_t fileHeaderBytes = 24;
+static constexpr size_t recordHeaderBytes = 16;
+static constexpr size_t ipHeaderBytes = 20;
+static constexpr size_t udpHeaderBytes = 8;
+static constexpr size_t maxDatagram = 0xffff - ipHeaderBytes - udpHeaderBytes;
+
+static void
+put16(uint8_t* at, uint16_t value)
+{
+  std::memcpy(at, &value, sizeof(value));
+}
+
+static void
+put32(uint8_t* at, uint32_t value)
+{
+  std::memcpy(at, &value, sizeof(value));
+}
+
+static uint32_t
+get32(const uint8_t* at)
+{
+  uint32_t value;
+  std::memcpy(&value, at, sizeof(value));
+  return value;
+}
+
+static void
+putNet16(uint8_t* at, uint16_t value)
+{
+  at[0] = uint8_t(value >> 8);
+  at[1] = uint8_t(value);
+}
+
+static uint16_t
+getNet16(const uint8_t* at)
+{
+  return uint16_t(at[0] << 8 | at[1]);
+}
+
+///
+/// PacketCapture
+///
+
+PacketCapture::PacketCapture(const std::string& path, uint64_t maxFileBytes)
+  : path(path)
+  , maxFileBytes(maxFileBytes)
+  , opened(false)
+  , captured(0)
+  , dropped(0)
+  , fileBytes(0)
+  , shutDown(false)
+{
+  // swapped back and forth, neither grows after this
+  filling.reserve(bufferBytes);
+  writing.reserve(bufferBytes);
+
+  opened = openFile();
+  if (!opened) {
+    std::clog << "capture: can not open " << path << std::endl;
+    return;
+  }
+  thread = std::thread([this]() { run(); });
+}
+
+PacketCapture::~PacketCapture()
+{
+  if (thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(runMutex);
+      shutDown = true;
+    }
+    runCv.notify_one();
+    thread.join();
+  }
+  flush();
+
+  if (dropped.load() != 0) {
+    std::clog << "capture: " << path << " dropped " << dropped.load()
+              << " packets, the writer fell behind" << std::endl;
+  }
+}
+
+void
+PacketCapture::record(const IpAddr& src,
+                      const IpAddr& dst,
+                      const uint8_t* data,
+                      size_t size)
+{
+  if (!opened) {
+    return;
+  }
+  if (size > maxDatagram) {
+    dropped++;
+    return;
+  }
+
+  auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  auto length = uint32_t(ipHeaderBytes + udpHeaderBytes + size);
+  size_t total = recordHeaderBytes + length;
+
+  std::lock_guard<std::mutex> lock(fillMutex);
+  size_t at = filling.size();
+  if (at + total > bufferBytes) {
+    dropped++;
+    return;
+  }
+  filling.resize(at + total);
+  uint8_t* out = filling.data() + at;
+
+  put32(out, uint32_t(since / 1000000000));
+  put32(out + 4, uint32_t(since % 1000000000));
+  put32(out + 8, length);
+  put32(out + 12, length);
+  out += recordHeaderBytes;
+
+  // IPv4, no options, don't fragment, UDP
+  std::memset(out, 0, ipHeaderBytes + udpHeaderBytes);
+  out[0] = 0x45;
+  putNet16(out + 2, uint16_t(length));
+  out[6] = 0x40;
+  out[8] = 64;
+  out[9] = 17;
+  std::memcpy(out + 12, &src.addr.sin_addr, 4);
+  std::memcpy(out + 16, &dst.addr.sin_addr, 4);
+  uint32_t sum = 0;
+  for (size_t i = 0; i < ipHeaderBytes; i += 2) {
+    sum += getNet16(out + i);
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  putNet16(out + 10, uint16_t(~sum));
+
+  // UDP, the checksum left out as IPv4 allows
+  uint8_t* udp = out + ipHeaderBytes;
+  std::memcpy(udp, &src.addr.sin_port, 2);
+  std::memcpy(udp + 2, &dst.addr.sin_port, 2);
+  putNet16(udp + 4, uint16_t(udpHeaderBytes + size));
+  std::memcpy(udp + udpHeaderBytes, data, size);
+  captured++;
+
+  // wake the writer well before the buffer fills
+  if (at < bufferBytes / 2 && at + total >= bufferBytes / 2) {
+    runCv.notify_one();
+  }
+}
+
+void
+PacketCapture::flush()
+{
+  std::lock_guard<std::mutex> lock(writeMutex);
+  {
+    std::lock_guard<std::mutex> fillLock(fillMutex);
+    writing.swap(filling);
+  }
+  if (writing.empty() || !opened) {
+    writing.clear();
+    return;
+  }
+
+  if (maxFileBytes != 0 && fileBytes > fileHeaderBytes &&
+      fileBytes + writing.size() > maxFileBytes && !rotate()) {
+    writing.clear();
+    return;
+  }
+  file.write(reinterpret_cast<const char*>(writing.data()),
+             std::streamsize(writing.size()));
+  file.flush();
+  fileBytes += writing.size();
+  writing.clear();
+}
+
+///
+/// CaptureReader
+///
+
+CaptureReader::CaptureReader(const std::string& path)
+  : file(path, std::ios::binary)
+  , valid(false)
+  , nanoseconds(false)
+{
+  uint8_t header[fileHeaderBytes];
+  if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+    return;
+  }
+
+  // only files written in our own byte order
+  uint32_t magic = get32(header);
+  if (magic != pcapMagicNs && magic != pcapMagicUs) {
+    return;
+  }
+  uint32_t linkType = get32(header + 20) & 0xffff;
+  if (linkType != linkTypeIpv4 && linkType != linkTypeRaw) {
+    return;
+  }
+  nanoseconds = magic == pcapMagicNs;
+  valid = true;
+}
+
+bool
+CaptureReader::next(CapturedPacket& packet)
+{
+  while (valid) {
+    uint8_t header[recordHeaderBytes];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+      return false;
+    }
+    uint32_t length = get32(header + 8);
+    if (length > 0x40000) {
+      valid = false; // not a record boundary, the file is damaged
+      return false;
+    }
+    record.resize(length);
+    if (!file.read(reinterpret_cast<char*>(record.data()), length)) {
+      return false;
+    }
+
+    const uint8_t* ip = record.data();
+    if (length < ipHeaderBytes || (ip[0] >> 4) != 4 || ip[9] != 17) {
+      continue;
+    }
+    size_t ipLength = size_t(ip[0] & 0x0f) * 4;
+    bool fragment = (getNet16(ip + 6) & 0x3fff) != 0;
+    if (fragment || length < ipLength + udpHeaderBytes) {
+      continue;
+    }
+    const uint8_t* udp = ip + ipLength;
+    size_t udpLength = getNet16(udp + 4);
+    if (udpLength < udpHeaderBytes || ipLength + udpLength > length) {
+      continue;
+    }
+
+    uint64_t seconds = get32(header);
+    uint64_t fraction = get32(header + 4);
+    packet.time = std::chrono::seconds(seconds) +
+                  (nanoseconds ? std::chrono::nanoseconds(fraction)
+                               : std::chrono::microseconds(fraction));
+
+    for (auto* addr : { &packet.src, &packet.dst }) {
+      std::memset(&addr->addr, 0, sizeof(addr->addr));
+      addr->addr.sin_family = AF_INET;
+      addr->addrLen = sizeof(addr->addr);
+    }
+    std::memcpy(&packet.src.addr.sin_addr, ip + 12, 4);
+    std::memcpy(&packet.dst.addr.sin_addr, ip + 16, 4);
+    std::memcpy(&packet.src.addr.sin_port, udp, 2);
+    std::memcpy(&packet.dst.addr.sin_port, udp + 2, 2);
+
+    packet.data.assign(udp + udpHeaderBytes, udp + udpLength);
+    return true;
+  }
+  return false;
+}
+
+///
+/// Private Implementation
+///
+
+bool
+PacketCapture::openFile()
+{
+  file.open(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  uint8_t header[fileHeaderBytes] = {};
+  put32(header, pcapMagicNs);
+  put16(header + 4, 2); // version 2.4
+  put16(header + 6, 4);
+  put32(header + 16, 0xffff); // snap length
+  put32(header + 20, linkTypeIpv4);
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  fileBytes = sizeof(header);
+  return bool(file);
+}
+
+bool
+PacketCapture::rotate()
+{
+  file.close();
+  std::string older = path + ".1";
+  std::remove(older.c_str()); // rename will not replace it on Windows
+  std::rename(path.c_str(), older.c_str());
+  if (!openFile()) {
+    std::clog << "capture: can not reopen " << path << ", stopped capturing"
+              << std::endl;
+    file.close();
+    opened = false;
+    return false;
+  }
+  return true;
+}
+
+void
+PacketCapture::run()
+{
+  std::unique_lock<std::mutex> lock(runMutex);
+  while (!shutDown) {
+    lock.unlock();
+    flush();
+    lock.lock();
+    runCv.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
@@ -45,6 +45,15 @@ void PipeInterface::runUpdates(const std::chrono::time_point<std::chrono::steady
   }
 }
 
+void
+PipeInterface::registerMetrics(MetricsRegistry& registry,
+                               const std::string& labels)
+{
+  if (nextPipe) {
+    nextPipe->registerMetrics(registry, labels);
+  }
+}
+
 bool PipeInterface::send(std::unique_ptr<Packet> packet) {
   if (nextPipe) {
     return nextPipe->send(move(packet));
@@ -52,6 +61,15 @@ bool PipeInterface::send(std::unique_ptr<Packet> packet) {
   return false;
 }
 
+bool PipeInterface::sendBatch(Batch& packets) {
+  bool ok = true;
+  for (auto& packet : packets) {
+    ok &= send(move(packet));
+  }
+  packets.clear();
+  return ok;
+}
+
 std::unique_ptr<Packet> PipeInterface::recv() {
   if (nextPipe) {
     return nextPipe->recv();
@@ -76,6 +94,16 @@ void PipeInterface::ack(ShortName name) {
   }
 }
 
+void
+PipeInterface::sentAt(
+  uint32_t sendId,
+  const std::chrono::time_point<std::chrono::steady_clock>& when)
+{
+  if (prevPipe) {
+    prevPipe->sentAt(sendId, when);
+  }
+}
+
 void PipeInterface::updateRTT(uint16_t minRtMs, uint16_t bigRtMs) {
   if (nextPipe) {
     nextPipe->updateRTT(minRtMs, bigRtMs);
@@ -3,11 +3,14 @@
 #include <memory>
 #include <string>
 #include <chrono>
+#include <vector>
 
 #include "quicr/packet.hh"
 
 namespace MediaNet {
 
+class MetricsRegistry;
+
 class PipeInterface
 {
 public:
@@ -24,6 +27,10 @@ public:
     bitrateDown,
     jitterUpMs,
     jitterDownMs,
+    connectionsActive,
+    connectionsExpired,
+    cryptoQueueDepth,
+    cryptoUtilPercent, // busiest crypto worker
     bad // must be last
   };
 
@@ -34,6 +41,12 @@ public:
 
   virtual bool send(std::unique_ptr<Packet>);
 
+  // takes all the packets, leaving the batch empty. The default sends
+  // them one at a time, pipes that do better with a run of packets
+  // override it and pass the batch on down in one call.
+  using Batch = std::vector<std::unique_ptr<Packet>>;
+  virtual bool sendBatch(Batch& packets);
+
   /// non blocking, return nullptr if no buffer
   virtual std::unique_ptr<Packet> recv();
 
@@ -46,6 +59,12 @@ public:
   // tells upstream things name was received
   virtual void ack(MediaNet::ShortName name);
 
+  // tells upstream things when the packet with sendId left, from the
+  // transport's kernel or NIC timestamp
+  virtual void sentAt(
+    uint32_t sendId,
+    const std::chrono::time_point<std::chrono::steady_clock>& when);
+
   // tells downstream things the current RTT
   virtual void updateRTT(uint16_t minRttMs, uint16_t bigRttMs);
 
@@ -55,10 +74,18 @@ public:
                                uint64_t startBps,
                                uint64_t maxBps);
 
+  // registers the metrics of this pipe and those below it, with labels
+  // telling this chain apart from others in the process
+  virtual void registerMetrics(MetricsRegistry& registry,
+                               const std::string& labels);
+
   virtual void
   runUpdates(const std::chrono::time_point<std::chrono::steady_clock>& now);
 	virtual ~PipeInterface();
 
+  // the next pipe down the chain, nullptr at the bottom
+  [[nodiscard]] PipeInterface* downstream() const { return nextPipe; }
+
 protected:
   explicit PipeInterface(PipeInterface *downStream);
 
@@ -15,22 +15,26 @@ PriorityPipe::PriorityPipe(PipeInterface* t)
 
 bool PriorityPipe::send(std::unique_ptr<Packet> packet) {
   assert(nextPipe);
-  uint8_t priority = packet->getPriority();
-  if (priority > maxPriority) {
-    priority = maxPriority;
-  }
+
+  std::lock_guard<std::mutex> lock(sendQMutex);
+  // std::clog << "+";
+  push(move(packet));
+
+  return true;
+}
+
+bool
+PriorityPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
 
   {
     std::lock_guard<std::mutex> lock(sendQMutex);
-    // std::clog << "+";
-    sendQarray[priority].push(move(packet));
-
-    // TODO - check Q not too deep
-    if (sendQarray[priority].size() > 1000) {
-      sendQarray[priority]
-        .pop(); // this is wrong, should kill oldest data - TODO
+    for (auto& packet : packets) {
+      push(move(packet));
     }
   }
+  packets.clear();
 
   return true;
 }
@@ -46,6 +50,11 @@ PriorityPipe::toDownstream()
     if (!sendQarray[i].empty()) {
       packet = move(sendQarray[i].front());
       sendQarray[i].pop();
+      sendDepth--;
+      QUICR_TRACE(packet, dequeued);
+      if (sendDepthGauge) {
+        sendDepthGauge->set(int64_t(sendDepth));
+      }
 
       // TODO - if below the MTU , add some more data to the packet
 
@@ -67,6 +76,10 @@ PriorityPipe::recv()
   if (!recvQ.empty()) {
     ret = move(recvQ.front());
     recvQ.pop();
+    QUICR_TRACE(ret, recvDequeued);
+    if (recvDepthGauge) {
+      recvDepthGauge->set(int64_t(recvQ.size()));
+    }
 
     // std::clog << "-";
   }
@@ -77,12 +90,20 @@ PriorityPipe::recv()
 bool
 PriorityPipe::fromDownstream(std::unique_ptr<Packet> packet)
 {
+  {
+    std::lock_guard<std::mutex> lock(recvQMutex);
+    QUICR_TRACE(packet, recvQueued);
+    recvQ.push(move(packet));
+    if (recvDepthGauge) {
+      recvDepthGauge->set(int64_t(recvQ.size()));
+    }
 
-  std::lock_guard<std::mutex> lock(recvQMutex);
-  recvQ.push(move(packet));
-
-  // TODO - check Q not too deep
+    // TODO - check Q not too deep
+  }
 
+  if (recvEvent) {
+    recvEvent->notify();
+  }
   return true;
 }
 
@@ -93,3 +114,54 @@ PriorityPipe::updateMTU(uint16_t val, uint32_t pps)
 
   PipeInterface::updateMTU(val, pps);
 }
+
+void
+PriorityPipe::registerMetrics(MetricsRegistry& registry,
+                              const std::string& labels)
+{
+  {
+    std::lock_guard<std::mutex> lock(sendQMutex);
+    sendDepthGauge = &registry.gauge(
+      "quicr_send_queue_depth", "packets waiting for the pacer", labels);
+    dropCounter = &registry.counter("quicr_send_queue_drops_total",
+                                    "packets dropped from a full send queue",
+                                    labels);
+  }
+  {
+    std::lock_guard<std::mutex> lock(recvQMutex);
+    recvDepthGauge = &registry.gauge(
+      "quicr_recv_queue_depth", "packets waiting for the app", labels);
+  }
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+///
+/// Private Implementation
+///
+
+// called with sendQMutex held
+void
+PriorityPipe::push(std::unique_ptr<Packet> packet)
+{
+  uint8_t priority = packet->getPriority();
+  if (priority > maxPriority) {
+    priority = maxPriority;
+  }
+
+  QUICR_TRACE(packet, queued);
+  sendQarray[priority].push(move(packet));
+  sendDepth++;
+
+  // TODO - check Q not too deep
+  if (sendQarray[priority].size() > maxQueueDepth) {
+    sendQarray[priority].pop(); // this is wrong, should kill oldest data - TODO
+    sendDepth--;
+    if (dropCounter) {
+      dropCounter->add();
+    }
+  }
+  if (sendDepthGauge) {
+    sendDepthGauge->set(int64_t(sendDepth));
+  }
+}
@@ -7,7 +7,9 @@
 #include <queue>
 
 #include "pipeInterface.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
+#include "wakeupEvent.hh"
 
 namespace MediaNet {
 
@@ -17,6 +19,7 @@ public:
   explicit PriorityPipe(PipeInterface* t);
 
   bool send(std::unique_ptr<Packet> packet) override;
+  bool sendBatch(Batch& packets) override;
   std::unique_ptr<Packet> recv() override;
 
   std::unique_ptr<Packet> toDownstream() override;
@@ -24,16 +27,34 @@ public:
 
   void updateMTU(uint16_t mtu, uint32_t pps) override;
 
+  // packets kept per priority before the oldest are dropped
+  void setMaxQueueDepth(size_t depth) { maxQueueDepth = depth; }
+
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+  // notified from the network thread for every packet that arrives
+  void setRecvEvent(WakeupEvent* event) { recvEvent = event; }
+
 private:
+  void push(std::unique_ptr<Packet> packet);
+
   static const int maxPriority = 10;
 
   std::mutex sendQMutex;
   std::array<std::queue<std::unique_ptr<Packet>>, maxPriority + 1> sendQarray;
+  size_t maxQueueDepth = 1000;
+  size_t sendDepth = 0; // over all priorities
 
   std::queue<std::unique_ptr<Packet>> recvQ;
   std::mutex recvQMutex;
+  WakeupEvent* recvEvent = nullptr;
 
   uint16_t mtu;
+
+  Gauge* sendDepthGauge = nullptr;
+  Gauge* recvDepthGauge = nullptr;
+  Counter* dropCounter = nullptr;
 };
 
 } // namespace MediaNet
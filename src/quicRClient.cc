@@ -1,6 +1,10 @@
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 
+#include "quicr/log.hh"
+#include "quicr/metrics.hh"
 #include "quicr/quicRClient.hh"
 
 #include "encode.hh"
@@ -8,53 +12,108 @@
 #include "connectionPipe.hh"
 #include "crazyBitPipe.hh"
 #include "encryptPipe.hh"
-#include "fakeLossPipe.hh"
 #include "fecPipe.hh"
 #include "fragmentPipe.hh"
+#include "impairmentPipe.hh"
+#include "jitterBufferPipe.hh"
+#include "loopbackPipe.hh"
 #include "pacerPipe.hh"
 #include "priorityPipe.hh"
 #include "retransmitPipe.hh"
 #include "statsPipe.hh"
 #include "subscribePipe.hh"
 #include "udpPipe.hh"
+#include "wakeupEvent.hh"
 
 using namespace MediaNet;
 
-QuicRClient::QuicRClient()
+static UdpPipe*
+makeUdpPipe(const ClientConfig& config)
 {
+  auto* udpPipe = new UdpPipe();
+  udpPipe->setTimestamps(config.wireTimestamps,
+                         config.wireTimestamps,
+                         config.wireTimestamps && config.hardwareTimestamps);
+  return udpPipe;
+}
+
+QuicRClient::QuicRClient()
+  : QuicRClient(ClientConfig())
+{}
+
+QuicRClient::QuicRClient(const ClientConfig& config)
+  : QuicRClient(config, makeUdpPipe(config))
+{}
+
+QuicRClient::QuicRClient(const ClientConfig& config, LoopbackNetwork& network)
+  : QuicRClient(config, new LoopbackPipe(network))
+{}
 
-  UdpPipe* udpPipe = new UdpPipe();
-  FakeLossPipe* fakeLossPipe = new FakeLossPipe(udpPipe);
-  CrazyBitPipe* crazyBitPipe = new CrazyBitPipe(fakeLossPipe);
+QuicRClient::QuicRClient(const ClientConfig& config, PipeInterface* transport)
+{
+  // optional stages are left out of the chain rather than passing through
+  PipeInterface* pipe = transport;
+  if (config.impairUp.active() || config.impairDown.active()) {
+    pipe = new ImpairmentPipe(pipe, config.impairUp, config.impairDown);
+  }
+  if (config.spinBit) {
+    pipe = new CrazyBitPipe(pipe);
+  }
   /*ClientConnectionPipe* */ connectionPipe =
-    new ClientConnectionPipe(crazyBitPipe);                  // TODO fix
+    new ClientConnectionPipe(pipe);                          // TODO fix
   /*PacerPipe* */ pacerPipe = new PacerPipe(connectionPipe); // TODO fix
   PriorityPipe* priorityPipe = new PriorityPipe(pacerPipe);
-  RetransmitPipe* retransmitPipe = new RetransmitPipe(priorityPipe);
-  FecPipe* fecPipe = new FecPipe(retransmitPipe);
+  priorityPipe->setMaxQueueDepth(config.sendQueueDepth);
+  pipe = priorityPipe;
+  if (config.retransmit) {
+    pipe = new RetransmitPipe(pipe);
+  }
+  if (config.fec) {
+    pipe = new FecPipe(pipe);
+  }
 
-  /* SubscribePipe* */ subscribePipe = new SubscribePipe(fecPipe); // TODO fix
+  /* SubscribePipe* */ subscribePipe = new SubscribePipe(pipe); // TODO fix
 
   FragmentPipe* fragmentPipe = new FragmentPipe(subscribePipe);
 
   /* EncryptPipe* */ encryptPipe = new EncryptPipe(fragmentPipe); // TODO fix
 
-  StatsPipe* statsPipe = new StatsPipe(encryptPipe);
+  /* JitterBufferPipe* */ jitterBufferPipe =
+    new JitterBufferPipe(encryptPipe); // TODO fix
+
+  StatsPipe* statsPipe = new StatsPipe(jitterBufferPipe);
   firstPipe = statsPipe;
 
+  recvEvent = std::make_unique<WakeupEvent>();
+  priorityPipe->setRecvEvent(recvEvent.get());
+  encryptPipe->setRecvEvent(recvEvent.get());
+
+  // each client in the process reports under its own number
+  static std::atomic<int> numClients(0);
+  metricsLabels = "client=\"" + std::to_string(numClients++) + "\"";
+  firstPipe->registerMetrics(MetricsRegistry::global(), metricsLabels);
+
   // TODO - get rid of all other places were defaults get set for mtu, rtt, pps
-  firstPipe->updateMTU(1280, 480);
-  firstPipe->updateRTT(20, 50);
+  firstPipe->updateMTU(config.mtu, config.pps);
+  firstPipe->updateRTT(config.minRttMs, config.bigRttMs);
+
+  setCryptoThreads(config.cryptoThreads);
+  setJitterBuffer(config.jitterMinMs, config.jitterMaxMs);
 }
 
 QuicRClient::~QuicRClient()
 {
   assert(firstPipe);
 
+  shutDown = true;
+  if (timerThread.joinable()) {
+    timerThread.join();
+  }
   firstPipe->stop();
 
   delete firstPipe;
   firstPipe = nullptr;
+  MetricsRegistry::global().remove(metricsLabels);
 }
 
 bool
@@ -66,6 +125,7 @@ QuicRClient::ready() const
 void QuicRClient::close() {
 	shutDown = true;
 	firstPipe->stop();
+	recvEvent->notify();
 }
 
 void QuicRClient::setCurrentTime(const std::chrono::time_point<std::chrono::steady_clock> &now) {
@@ -80,33 +140,48 @@ QuicRClient::setCryptoKey(sframe::MLSContext::EpochID epoch,
   encryptPipe->setCryptoKey(epoch, mls_epoch_secret);
 }
 
-bool
-QuicRClient::publish(std::unique_ptr<Packet> packet)
+void
+QuicRClient::setCryptoThreads(int numThreads)
 {
-  size_t payloadSize = packet->size();
-  assert(payloadSize < 63 * 1200);
-
-  ClientData clientData;
-  clientData.clientSeqNum = 0;
-
-  NamedDataChunk namedDataChunk;
-  namedDataChunk.shortName = packet->shortName();
-  namedDataChunk.lifetime = toVarInt(0); // TODO
+  assert(encryptPipe);
+  encryptPipe->setCryptoThreads(numThreads);
+}
 
-  DataBlock dataBlock;
-  dataBlock.metaDataLen = toVarInt(0);
-  dataBlock.dataLen = toVarInt(packet->size());
+std::vector<uint32_t>
+QuicRClient::getCryptoUtilization() const
+{
+  assert(encryptPipe);
+  return encryptPipe->getCryptoUtilization();
+}
 
-  packet << dataBlock;
-  packet << namedDataChunk;
-  packet << clientData;
+void
+QuicRClient::setJitterBuffer(uint32_t minDepthMs, uint32_t maxDepthMs)
+{
+  assert(jitterBufferPipe);
+  jitterBufferPipe->setDepth(minDepthMs, maxDepthMs);
+}
 
+bool
+QuicRClient::publish(std::unique_ptr<Packet> packet)
+{
+  addPublishHeaders(packet);
   return firstPipe->send(move(packet));
 }
 
+bool
+QuicRClient::publishBatch(std::vector<std::unique_ptr<Packet>>& packets)
+{
+  for (auto& packet : packets) {
+    addPublishHeaders(packet);
+  }
+  return firstPipe->sendBatch(packets);
+}
+
 std::unique_ptr<Packet>
 QuicRClient::recv()
 {
+  // cleared before looking, so whatever arrives after sets it again
+  recvEvent->clear();
 
   auto packet = std::unique_ptr<Packet>(nullptr);
 
@@ -141,14 +216,14 @@ QuicRClient::recv()
     // implies NamedDataChunk
     if (nextTag(packet) != PacketTag::shortName) {
       // TODO log bad data
-      std::clog << "quicr recv bad tag: "
-                << (((uint16_t)(nextTag(packet))) >> 8) << std::endl;
+      QUICR_LOG_WARN("quicr recv bad tag: {}",
+                     ((uint16_t)(nextTag(packet))) >> 8);
       continue;
     }
 
     if (packet->size() < 2) {
       // TODO log bad data
-      std::clog << "quicr recv bad size=" << packet->size() << std::endl;
+      QUICR_LOG_WARN("quicr recv bad size={}", packet->size());
       continue;
     }
 
@@ -162,7 +237,7 @@ QuicRClient::recv()
 
     if (!ok) {
       // TODO log bad data
-      std::clog << "quicr recv bad relay data =" << std::endl;
+      QUICR_LOG_WARN("quicr recv bad relay data");
       continue;
     }
 
@@ -171,12 +246,13 @@ QuicRClient::recv()
     // TODO - set packet lifetime
 
     packet->name = namedDataChunk.shortName;
+    packet->setPriority(namedDataChunk.priority);
 
     size_t payloadSize = fromVarInt(dataBlock.dataLen);
 
     if (payloadSize > packet->size()) {
-      std::clog << "quicr recv bad data size " << payloadSize << " "
-                << packet->size() << std::endl;
+      QUICR_LOG_WARN(
+        "quicr recv bad data size {} of {}", payloadSize, packet->size());
       continue;
     }
 
@@ -186,9 +262,36 @@ QuicRClient::recv()
   }
 
   //std::clog << "QuicR received packet size=" << packet->size() << std::endl;
+  QUICR_TRACE(packet, delivered);
+  QUICR_TRACE_FINISH(packet);
   return packet;
 }
 
+std::unique_ptr<Packet>
+QuicRClient::recv(std::chrono::milliseconds timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (true) {
+    auto packet = recv();
+    if (packet || shutDown) {
+      return packet;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return packet;
+    }
+
+    // a held object coming due is not signaled, wake up for it
+    recvEvent->waitUntil(std::min(deadline, jitterBufferPipe->nextPlayout()));
+  }
+}
+
+int
+QuicRClient::getRecvFd()
+{
+  return recvEvent->fd();
+}
+
 bool
 QuicRClient::open(uint32_t clientID,
                   const std::string relayName,
@@ -214,13 +317,25 @@ QuicRClient::getTargetUpstreamBitrate()
   return pacerPipe->getTargetUpstreamBitrate(); // TODO - move to stats
 }
 
+std::vector<const PipeInterface*>
+QuicRClient::pipes() const
+{
+  std::vector<const PipeInterface*> chain;
+  for (const PipeInterface* pipe = firstPipe; pipe; pipe = pipe->downstream()) {
+    chain.push_back(pipe);
+  }
+  return chain;
+}
+
 std::unique_ptr<Packet>
 QuicRClient::createPacket(const ShortName& shortName, int reservedPayloadSize)
 {
   auto packet = std::make_unique<Packet>();
   assert(packet);
   packet->name = shortName;
-  packet->reserve(reservedPayloadSize + 20); // TODO - tune the 20
+  // room for the payload to grow by the encryption overhead
+  packet->reserve(reservedPayloadSize + sframe::max_overhead +
+                  20); // TODO - tune the 20
 
   auto hdr = Packet::Header(PacketTag::headerData);
   packet << hdr;
@@ -278,3 +393,28 @@ void QuicRClient::runTimerThread() {
     std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
 }
+
+void
+QuicRClient::addPublishHeaders(std::unique_ptr<Packet>& packet)
+{
+  QUICR_TRACE(packet, publish);
+
+  size_t payloadSize = packet->size();
+  assert(payloadSize < 63 * 1200);
+
+  ClientData clientData;
+  clientData.clientSeqNum = 0;
+
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = packet->shortName();
+  namedDataChunk.lifetime = toVarInt(0); // TODO
+  namedDataChunk.priority = packet->getPriority();
+
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(packet->size());
+
+  packet << dataBlock;
+  packet << namedDataChunk;
+  packet << clientData;
+}
@@ -1,27 +1,50 @@
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 
 #include "encode.hh"
+#include "quicr/log.hh"
+#include "quicr/metrics.hh"
+#include "quicr/packetCapture.hh"
 #include "quicr/quicRServer.hh"
 
 #include "connectionPipe.hh"
-#include "fakeLossPipe.hh"
+#include "impairmentPipe.hh"
+#include "loopbackPipe.hh"
+#include "statsPipe.hh"
 #include "udpPipe.hh"
 
 using namespace MediaNet;
 // TODO: Add other elements for pipeline - loss,spinBit, rateCtrl
 QuicRServer::QuicRServer()
-  : udpPipe()
-  , fakeLossPipe(&udpPipe)
-  , connectionPipe(&fakeLossPipe)
-  , firstPipe(&connectionPipe)
+  : QuicRServer(new UdpPipe())
+{}
+
+QuicRServer::QuicRServer(LoopbackNetwork& network)
+  : QuicRServer(new LoopbackPipe(network))
+{}
+
+QuicRServer::QuicRServer(TransportPipe* transportPipe)
+  : transport(transportPipe)
+  , impairmentPipe(
+      new ImpairmentPipe(transport, ImpairmentConfig(), ImpairmentConfig()))
+  , connectionPipe(new ServerConnectionPipe(impairmentPipe))
+  , statsPipe(new StatsPipe(connectionPipe))
+  , firstPipe(statsPipe)
 {
+  static std::atomic<int> numServers(0);
+  metricsLabels = "server=\"" + std::to_string(numServers++) + "\"";
+  firstPipe->registerMetrics(MetricsRegistry::global(), metricsLabels);
+
   firstPipe->updateMTU(1200, 500);
 }
 
 QuicRServer::~QuicRServer()
 {
   firstPipe->stop();
+  delete firstPipe;
+  MetricsRegistry::global().remove(metricsLabels);
 }
 
 bool
@@ -53,7 +76,7 @@ QuicRServer::recv()
 
     if (packet->size() < 1) {
       // TODO log bad data
-      std::clog << "quicr recv very bad size = " << packet->size() << std::endl;
+      QUICR_LOG_WARN("quicr recv very bad size = {}", packet->size());
       continue;
     }
 
@@ -65,6 +88,50 @@ QuicRServer::recv()
   return packet;
 }
 
+std::unique_ptr<Packet>
+QuicRServer::recv(std::chrono::milliseconds timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+
+    // held packets come due without the transport becoming readable
+    bool impaired = impairmentPipe->active();
+    if (impaired) {
+      impairmentPipe->runUpdates(now);
+      wait = std::min(wait, std::chrono::milliseconds(1));
+    }
+
+    bool readable =
+      transport->waitReadable(std::max(wait, std::chrono::milliseconds(0)));
+    if (!readable && !impaired) {
+      // nothing to read, still time out idle connections
+      firstPipe->runUpdates(std::chrono::steady_clock::now());
+      return std::unique_ptr<Packet>(nullptr);
+    }
+
+    // can be null when the connection pipe consumed it
+    auto packet = recv();
+    if (packet) {
+      return packet;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      if (!readable) {
+        firstPipe->runUpdates(std::chrono::steady_clock::now());
+      }
+      return packet;
+    }
+  }
+}
+
+int
+QuicRServer::getRecvFd() const
+{
+  return transport->getFd();
+}
+
 bool
 QuicRServer::open(const uint16_t port)
 {
@@ -75,6 +142,37 @@ QuicRServer::open(const uint16_t port)
 bool
 QuicRServer::send(std::unique_ptr<Packet> packet)
 {
-  // TODO: using UdpPipe directly. Revis this
-  return udpPipe.send(std::move(packet));
+  // below the connection pipe, as the relay addresses each packet itself
+  return impairmentPipe->send(std::move(packet));
+}
+
+void
+QuicRServer::setImpairment(const ImpairmentConfig& toClients,
+                           const ImpairmentConfig& fromClients)
+{
+  impairmentPipe->setImpairment(toClients, fromClients);
+}
+
+bool
+QuicRServer::startCapture(const std::string& path, uint64_t maxFileBytes)
+{
+  capture = std::make_unique<PacketCapture>(path, maxFileBytes);
+  if (!capture->ok()) {
+    capture.reset();
+    return false;
+  }
+  transport->setCapture(capture.get());
+  return true;
+}
+
+void
+QuicRServer::setClosedCallback(ServerConnectionPipe::ClosedCallback callback)
+{
+  connectionPipe->setClosedCallback(std::move(callback));
+}
+
+uint64_t
+QuicRServer::getStat(PipeInterface::StatName stat) const
+{
+  return statsPipe->getStat(stat);
 }
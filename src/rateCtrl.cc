@@ -37,7 +37,7 @@ RateCtrl::RateCtrl(PipeInterface* pacerPipeRef)
   downstreamHistory.clear();
   downstreamHistory.reserve(5000); // TODO limit length of history
 
-  startNewCycle();
+  startNewCycle(std::chrono::steady_clock::now());
 }
 
 void
@@ -46,7 +46,7 @@ RateCtrl::sendPacket(uint32_t seqNum,
                      uint16_t sizeBits,
                      ShortName shortName)
 {
-  updatePhase();
+  updatePhase(std::chrono::steady_clock::now());
 
   assert(sizeBits > 0);
 
@@ -75,52 +75,100 @@ RateCtrl::sendPacket(uint32_t seqNum,
   rec.shortName = shortName;
 }
 
+void
+RateCtrl::sentAt(uint32_t seqNum, uint32_t sendTimeUs)
+{
+  PacketUpstreamStatus* rec = findUpstream(seqNum);
+  if (!rec || rec->status != HistoryStatus::sent) {
+    return;
+  }
+  rec->localSendTimeUs = sendTimeUs;
+}
+
 void
 RateCtrl::recvAck(uint32_t seqNum,
+                  uint32_t ackVec,
                   uint32_t remoteAckTimeUs,
+                  uint32_t ackDelayUs,
                   uint32_t localRecvAckTimeUs,
                   bool congested,
                   bool haveAck)
 {
-  updatePhase();
+  updatePhase(std::chrono::steady_clock::now());
 
+  // older packets first so the retransmit pipe sees acks in send order
+  recvAckVec(seqNum, ackVec, congested);
+
+  PacketUpstreamStatus* rec = findUpstream(seqNum);
+  if (!rec) {
+    return;
+  }
+
+  if (rec->status == HistoryStatus::sent) {
+    pacerPipe->ack(rec->shortName);
+  }
+
+  if (haveAck) {
+    rec->status = (congested) ? HistoryStatus::congested : HistoryStatus::ack;
+    rec->remoteReceiveTimeUs = remoteAckTimeUs;
+    // time the ack sat at the far end is not part of the RTT
+    rec->localAckTimeUs = localRecvAckTimeUs - ackDelayUs;
+  } else {
+    if (rec->status == HistoryStatus::sent) {
+      rec->status =
+        (congested) ? HistoryStatus::congested : HistoryStatus::received;
+      rec->remoteReceiveTimeUs = remoteAckTimeUs;
+      rec->localAckTimeUs = 0;
+    }
+  }
+}
+
+void
+RateCtrl::recvAckVec(uint32_t seqNum, uint32_t ackVec, bool congested)
+{
+  for (int i = 31; i >= 0; i--) {
+    if ((ackVec & (1u << i)) == 0) {
+      continue;
+    }
+
+    PacketUpstreamStatus* rec = findUpstream(seqNum - 1 - i);
+    if (!rec || rec->status != HistoryStatus::sent) {
+      continue;
+    }
+
+    pacerPipe->ack(rec->shortName);
+    // no receive time for these so they do not feed RTT or skew
+    rec->status =
+      (congested) ? HistoryStatus::congested : HistoryStatus::received;
+    rec->remoteReceiveTimeUs = 0;
+    rec->localAckTimeUs = 0;
+  }
+}
+
+PacketUpstreamStatus*
+RateCtrl::findUpstream(uint32_t seqNum)
+{
   if (seqNum < upHistorySeqOffset) {
     // TODO - log really old
-    return;
+    return nullptr;
   }
 
   // TODO - shrink down history size if too large
 
   if (seqNum - upHistorySeqOffset >= upstreamHistory.size()) {
     // TODO - alien packet, toss out
-    return; // this happens when you get data from old buffer from previous
-            // session
+    return nullptr; // this happens when you get data from old buffer from
+                    // previous session
   }
 
   PacketUpstreamStatus& rec = upstreamHistory.at(seqNum - upHistorySeqOffset);
 
   if (rec.seqNum != seqNum) {
     // TODO - figure out how this happens
-    return;
+    return nullptr;
   }
-  assert(rec.seqNum == seqNum);
 
-  if (rec.status == HistoryStatus::sent) {
-    pacerPipe->ack(rec.shortName);
-  }
-
-  if (haveAck) {
-    rec.status = (congested) ? HistoryStatus::congested : HistoryStatus::ack;
-    rec.remoteReceiveTimeUs = remoteAckTimeUs;
-    rec.localAckTimeUs = localRecvAckTimeUs;
-  } else {
-    if (rec.status == HistoryStatus::sent) {
-      rec.status =
-        (congested) ? HistoryStatus::congested : HistoryStatus::received;
-      rec.remoteReceiveTimeUs = remoteAckTimeUs;
-      rec.localAckTimeUs = 0;
-    }
-  }
+  return &rec;
 }
 
 uint64_t
@@ -167,9 +215,11 @@ RateCtrl::bwDownTarget() const // in bits per second
 }
 
 void
-RateCtrl::updatePhase()
+RateCtrl::updatePhase(std::chrono::steady_clock::time_point timePointNow)
 {
-  auto timePointNow = std::chrono::steady_clock::now();
+  if (timePointNow < cycleStartTime) {
+    return; // a time from before this cycle started
+  }
   uint32_t cycleTimeUs =
     (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
       timePointNow - cycleStartTime)
@@ -180,7 +230,7 @@ RateCtrl::updatePhase()
 
   if (newPhase >= numPhasePerCycle) {
     startNewPhase();
-    startNewCycle();
+    startNewCycle(timePointNow);
     phaseCycleCount++;
   } else if (newPhase > oldPhase) {
     startNewPhase();
@@ -195,7 +245,7 @@ RateCtrl::startNewPhase()
 }
 
 void
-RateCtrl::startNewCycle()
+RateCtrl::startNewCycle(std::chrono::steady_clock::time_point now)
 {
 
 #if 0
@@ -248,7 +298,7 @@ RateCtrl::startNewCycle()
   pacerPipe->updateStat(PipeInterface::StatName::jitterDownMs,
                         filterJitterDown.estimate() / 1000);
 
-  cycleStartTime = std::chrono::steady_clock::now();
+  cycleStartTime = now;
 
   filterBitrateUp.reset();
   filterBitrateDown.reset();
@@ -267,7 +317,7 @@ RateCtrl::recvPacket(uint32_t relaySeqNum,
                      uint16_t sizeBits,
                      bool congested)
 {
-  updatePhase();
+  updatePhase(std::chrono::steady_clock::now());
 
 #if 0
   std::clog << "Got subData seq=" << relaySeqNum
@@ -83,14 +83,21 @@ public:
                   uint32_t sendTimeUs,
                   uint16_t sizeBits,
                   ShortName shortName);
+  // moves the send time of a packet not yet acked to when the transport
+  // says it left, which leaves out the time it took to get there
+  void sentAt(uint32_t seqNum, uint32_t sendTimeUs);
 
   void recvPacket(uint32_t relaySeqNum,
                   uint32_t remoteSendTimeUs,
                   uint32_t localRecvTimeUs,
                   uint16_t sizeBits,
                   bool congested);
+  // seqNum is the newest packet acked and gives an RTT sample once
+  // ackDelayUs is removed, bits in ackVec mark the 32 before it as received
   void recvAck(uint32_t seqNum,
+               uint32_t ackVec,
                uint32_t remoteAckTimeUs,
+               uint32_t ackDelayUs,
                uint32_t localRecvAckTimeUs,
                bool congested,
                bool haveAck);
@@ -105,22 +112,31 @@ public:
   void overrideBitrateUp(uint64_t minBps, uint64_t startBps, uint64_t maxBps);
 
 private:
+  // bench/rateCtrl.cc drives the phases on a clock of its own
+  friend class RateCtrlBench;
+
+  // moves on to the phase now is in, running the estimates for each phase
+  // that ended. The public calls do this with the current time.
+  void updatePhase(std::chrono::steady_clock::time_point now);
+
   PipeInterface* pacerPipe;
 
+  PacketUpstreamStatus* findUpstream(uint32_t seqNum);
+  void recvAckVec(uint32_t seqNum, uint32_t ackVec, bool congested);
+
   uint32_t upHistorySeqOffset;
   std::vector<PacketUpstreamStatus> upstreamHistory;
 
   uint32_t downHistorySeqOffset;
   std::vector<PacketDownstreamStatus> downstreamHistory;
 
-  void updatePhase();
   static const uint32_t phaseTimeUs = 33333 * 2; // 0.5 frames at 30 fps
   static const uint32_t numPhasePerCycle = 5;
 
   void startNewPhase();
   uint32_t phaseCycleCount; // does *not* reset to zero with each new cycle
 
-  void startNewCycle();
+  void startNewCycle(std::chrono::steady_clock::time_point now);
   std::chrono::steady_clock::time_point cycleStartTime;
 
   void cycleUpdateUpstreamTarget();
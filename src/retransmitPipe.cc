@@ -1,9 +1,11 @@
 
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
 #include "encode.hh"
+#include "quicr/log.hh"
 #include "quicr/packet.hh"
 #include "retransmitPipe.hh"
 
@@ -31,14 +33,50 @@ bool RetransmitPipe::send(std::unique_ptr<Packet> packet) {
     auto ret = rtxList.insert(move(p));
     if (!ret.second) {
       // element was already in map - not unique name, not good
-      std::clog << "Warning sending same name twice" << std::endl;
+      QUICR_LOG_WARN("sending same name twice: {}", packet->shortName());
       return false;
     }
+    if (pendingGauge) {
+      pendingGauge->set(int64_t(rtxList.size()));
+    }
   }
 
   return nextPipe->send(move(packet));
 }
 
+bool
+RetransmitPipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+
+  bool ok = true;
+  {
+    std::lock_guard<std::mutex> lock(rtxListMutex);
+    for (auto& packet : packets) {
+      if (!packet->isReliable()) {
+        continue;
+      }
+      auto clone = packet->clone();
+      assert(clone);
+      packet->setReliable(false);
+
+      auto ret = rtxList.emplace(packet->shortName(), move(clone));
+      if (!ret.second) {
+        QUICR_LOG_WARN("sending same name twice: {}", packet->shortName());
+        packet.reset();
+        ok = false;
+      }
+    }
+    if (pendingGauge) {
+      pendingGauge->set(int64_t(rtxList.size()));
+    }
+  }
+  packets.erase(std::remove(packets.begin(), packets.end(), nullptr),
+                packets.end());
+
+  return nextPipe->sendBatch(packets) && ok;
+}
+
 std::unique_ptr<Packet> RetransmitPipe::recv() {
   assert(nextPipe);
   return nextPipe->recv();
@@ -75,10 +113,17 @@ RetransmitPipe::ack(ShortName name)
       // resend this one
       nextPipe->send(move((*it).second));
       it = rtxList.erase(it);
+      if (resendCounter) {
+        resendCounter->add();
+      }
     } else {
       it++;
     }
   }
+
+  if (pendingGauge) {
+    pendingGauge->set(int64_t(rtxList.size()));
+  }
 }
 
 void
@@ -89,3 +134,18 @@ RetransmitPipe::updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
   bigRtt = bigRttMs;
   minRtt = minRttMs;
 }
+
+void
+RetransmitPipe::registerMetrics(MetricsRegistry& registry,
+                                const std::string& labels)
+{
+  {
+    std::lock_guard<std::mutex> lock(rtxListMutex);
+    resendCounter = &registry.counter(
+      "quicr_retransmits_total", "reliable packets sent again", labels);
+    pendingGauge = &registry.gauge(
+      "quicr_retransmit_pending", "reliable packets not yet acked", labels);
+  }
+
+  PipeInterface::registerMetrics(registry, labels);
+}
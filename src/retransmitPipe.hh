@@ -6,6 +6,7 @@
 #include <mutex>
 
 #include "pipeInterface.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
 
 namespace MediaNet {
@@ -16,6 +17,7 @@ public:
   explicit RetransmitPipe(PipeInterface* t);
 
   bool send(std::unique_ptr<Packet> packet) override;
+  bool sendBatch(Batch& packets) override;
 
   /// non blocking, return nullptr if no buffer
   std::unique_ptr<Packet> recv() override;
@@ -26,6 +28,9 @@ public:
     uint16_t minRttMs,
     uint16_t maxRttMs) override; // tells downstream things the current RTT
 
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
 private:
   std::mutex rtxListMutex;
   std::map<MediaNet::ShortName, std::unique_ptr<Packet>> rtxList;
@@ -34,6 +39,9 @@ private:
 
   uint16_t minRtt;
   uint16_t bigRtt;
+
+  Counter* resendCounter = nullptr;
+  Gauge* pendingGauge = nullptr; // unacked packets held for resend
 };
 
 } // namespace MediaNet
@@ -0,0 +1,166 @@
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+
+#include "retryCookie.hh"
+
+using namespace MediaNet;
+
+///
+/// RetryCookie::Key
+///
+
+// The HMAC context is keyed once and reused for every cookie, setting the
+// key up again costs several times more than the hash itself.
+class RetryCookie::Key
+{
+public:
+  Key()
+  {
+    // without a random secret anyone could forge cookies, so this is
+    // fatal in release builds too
+    if (RAND_bytes(secret.data(), int(secret.size())) != 1) {
+      std::clog << "retry cookie: no random bytes for the secret" << std::endl;
+      std::abort();
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC* hmac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    ctx = EVP_MAC_CTX_new(hmac);
+    EVP_MAC_free(hmac);
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+      OSSL_PARAM_construct_end()
+    };
+    bool keyed =
+      ctx && EVP_MAC_init(ctx, secret.data(), secret.size(), params) == 1;
+#else
+    ctx = HMAC_CTX_new();
+    bool keyed = ctx && HMAC_Init_ex(ctx,
+                                     secret.data(),
+                                     int(secret.size()),
+                                     EVP_sha256(),
+                                     nullptr) == 1;
+#endif
+    if (!keyed) {
+      std::clog << "retry cookie: can not set up HMAC-SHA256" << std::endl;
+      std::abort();
+    }
+  }
+
+  ~Key()
+  {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC_CTX_free(ctx);
+#else
+    HMAC_CTX_free(ctx);
+#endif
+  }
+
+  Key(const Key&) = delete;
+  Key& operator=(const Key&) = delete;
+
+  uint32_t mac(const IpAddr& remote, uint64_t epoch)
+  {
+    uint8_t data[4 + 2 + 8];
+    std::memcpy(data, &remote.addr.sin_addr.s_addr, 4);
+    std::memcpy(data + 4, &remote.addr.sin_port, 2);
+    std::memcpy(data + 6, &epoch, 8);
+
+    uint8_t md[EVP_MAX_MD_SIZE];
+    // a null key restarts the context with the key it already has
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    size_t mdLen = 0;
+    EVP_MAC_init(ctx, nullptr, 0, nullptr);
+    EVP_MAC_update(ctx, data, sizeof(data));
+    EVP_MAC_final(ctx, md, &mdLen, sizeof(md));
+#else
+    unsigned int mdLen = 0;
+    HMAC_Init_ex(ctx, nullptr, 0, nullptr, nullptr);
+    HMAC_Update(ctx, data, sizeof(data));
+    HMAC_Final(ctx, md, &mdLen);
+#endif
+    assert(mdLen >= 4);
+
+    uint32_t cookie;
+    std::memcpy(&cookie, md, sizeof(cookie));
+    return cookie;
+  }
+
+private:
+  std::array<uint8_t, 32> secret{};
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  EVP_MAC_CTX* ctx;
+#else
+  HMAC_CTX* ctx;
+#endif
+};
+
+///
+/// RetryCookie
+///
+
+RetryCookie::RetryCookie(std::chrono::milliseconds epochLen)
+  : epochLength(epochLen)
+  , epochStart(std::chrono::steady_clock::now())
+  , epoch(0)
+  , key(std::make_unique<Key>())
+  , prevKey(std::make_unique<Key>())
+{}
+
+RetryCookie::~RetryCookie() = default;
+
+uint32_t
+RetryCookie::make(const IpAddr& remote, const timepoint& now)
+{
+  rotate(now);
+  return key->mac(remote, epoch);
+}
+
+bool
+RetryCookie::verify(const IpAddr& remote,
+                    uint32_t cookie,
+                    const timepoint& now)
+{
+  rotate(now);
+
+  if (cookie == key->mac(remote, epoch)) {
+    return true;
+  }
+  // made just before the last rotation
+  return epoch > 0 && cookie == prevKey->mac(remote, epoch - 1);
+}
+
+///
+/// Private Implementation
+///
+
+void
+RetryCookie::rotate(const timepoint& now)
+{
+  if (now - epochStart < epochLength) {
+    return;
+  }
+
+  auto elapsed = (now - epochStart) / epochLength;
+  epochStart += elapsed * epochLength;
+  epoch += elapsed;
+
+  if (elapsed == 1) {
+    prevKey = std::move(key);
+  } else {
+    // nothing from the last epoch can still be valid
+    prevKey = std::make_unique<Key>();
+  }
+  key = std::make_unique<Key>();
+}
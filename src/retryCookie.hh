@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "quicr/packet.hh"
+
+namespace MediaNet {
+
+///
+/// RetryCookie
+///
+
+// Stateless cookies for the reset/retry step of connection setup. The
+// cookie is a truncated HMAC-SHA256 of the client address and the current
+// epoch under a random secret that is replaced every epoch, so the server
+// keeps nothing per client until the client proves it can receive at its
+// address. A cookie is accepted for one to two epochs.
+class RetryCookie
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  explicit RetryCookie(
+    std::chrono::milliseconds epochLength = std::chrono::seconds(10));
+
+  uint32_t make(const IpAddr& remote, const timepoint& now);
+  bool verify(const IpAddr& remote, uint32_t cookie, const timepoint& now);
+
+  ~RetryCookie();
+
+private:
+  class Key; // random secret and an HMAC context keyed with it
+
+  void rotate(const timepoint& now);
+
+  const std::chrono::milliseconds epochLength;
+  timepoint epochStart;
+  uint64_t epoch;
+
+  std::unique_ptr<Key> key;
+  std::unique_ptr<Key> prevKey;
+};
+
+} // namespace MediaNet
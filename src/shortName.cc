@@ -124,3 +124,17 @@ ShortName::fromString(const std::string& name_str)
 
   return name;
 }
+
+size_t
+std::hash<MediaNet::ShortName>::operator()(
+  const MediaNet::ShortName& name) const noexcept
+{
+  // mix the fields so names that differ only in mediaTime spread out
+  uint64_t h = name.resourceID;
+  h = h * 0x9e3779b97f4a7c15ULL +
+      ((uint64_t(name.senderID) << 16) | (uint64_t(name.sourceID) << 8) |
+       name.fragmentID);
+  h = h * 0x9e3779b97f4a7c15ULL + name.mediaTime;
+  h ^= h >> 32;
+  return size_t(h);
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "crazyBitPipe.hh"
+#include "pipeInterface.hh"
+#include "quicr/metrics.hh"
+#include "quicr/packet.hh"
+#include "statsPipe.hh"
+
+namespace MediaNet {
+
+///
+/// Static pipelines
+///
+
+// Pipe stages composed at compile time. A stage is a class template over
+// the stage below it and holds that stage by value, so a hop down the
+// chain is a direct call the compiler can inline, and a stage that only
+// forwards costs nothing. StaticStage forwards everything; a stage derives
+// from it and hides the calls it has work to do in.
+//
+// The bottom of a chain is DynamicTail, which hands on to an ordinary
+// PipeInterface chain such as ClientConnectionPipe and below, and
+// StaticPipe wraps a whole static chain as a PipeInterface so it sits
+// alongside the dynamic pipes:
+//
+//   using Bottom = StatsStage<CrazyBitStage<DynamicTail>>;
+//   auto pipe = new StaticPipe<Bottom>(new UdpPipe());
+//
+// Stats, acks and send times passed up from below are offered to every
+// stage on the way and then go on to the pipe above the StaticPipe. A
+// stage keeps its state in the same helper as the dynamic pipe it stands
+// in for, so the two do the same work.
+template<typename Next>
+class StaticStage
+{
+public:
+  template<typename... Args>
+  explicit StaticStage(Args&&... args)
+    : next(std::forward<Args>(args)...)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet)
+  {
+    return next.send(std::move(packet));
+  }
+  std::unique_ptr<Packet> recv() { return next.recv(); }
+
+  void updateStat(PipeInterface::StatName stat, uint64_t value)
+  {
+    next.updateStat(stat, value);
+  }
+  void updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
+  {
+    next.updateRTT(minRttMs, bigRttMs);
+  }
+  void updateMTU(uint16_t mtu, uint32_t pps) { next.updateMTU(mtu, pps); }
+  void updateBitrateUp(uint64_t minBps, uint64_t startBps, uint64_t maxBps)
+  {
+    next.updateBitrateUp(minBps, startBps, maxBps);
+  }
+  void ack(const ShortName& name) { next.ack(name); }
+  void sentAt(uint32_t sendId,
+              const std::chrono::time_point<std::chrono::steady_clock>& when)
+  {
+    next.sentAt(sendId, when);
+  }
+  void registerMetrics(MetricsRegistry& registry, const std::string& labels)
+  {
+    next.registerMetrics(registry, labels);
+  }
+  void runUpdates(const std::chrono::time_point<std::chrono::steady_clock>& now)
+  {
+    next.runUpdates(now);
+  }
+
+  Next& downstream() { return next; }
+
+protected:
+  Next next;
+};
+
+// End of a static chain, forwarding to a dynamic pipe it does not own
+class DynamicTail
+{
+public:
+  explicit DynamicTail(PipeInterface* pipe)
+    : pipe(pipe)
+  {
+    assert(pipe);
+  }
+
+  bool send(std::unique_ptr<Packet> packet)
+  {
+    return pipe->send(std::move(packet));
+  }
+  std::unique_ptr<Packet> recv() { return pipe->recv(); }
+
+  // these come from below, there is nothing further down to tell
+  void updateStat(PipeInterface::StatName, uint64_t) {}
+  void ack(const ShortName&) {}
+  void sentAt(uint32_t, const std::chrono::time_point<std::chrono::steady_clock>&)
+  {}
+
+  void updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
+  {
+    pipe->updateRTT(minRttMs, bigRttMs);
+  }
+  void updateMTU(uint16_t mtu, uint32_t pps) { pipe->updateMTU(mtu, pps); }
+  void updateBitrateUp(uint64_t minBps, uint64_t startBps, uint64_t maxBps)
+  {
+    pipe->updateBitrateUp(minBps, startBps, maxBps);
+  }
+  void registerMetrics(MetricsRegistry& registry, const std::string& labels)
+  {
+    pipe->registerMetrics(registry, labels);
+  }
+  void runUpdates(const std::chrono::time_point<std::chrono::steady_clock>& now)
+  {
+    pipe->runUpdates(now);
+  }
+
+private:
+  PipeInterface* pipe;
+};
+
+// A static chain ending in DynamicTail, as a PipeInterface. The dynamic
+// pipe below is owned like any nextPipe.
+template<typename Chain>
+class StaticPipe : public PipeInterface
+{
+public:
+  explicit StaticPipe(PipeInterface* t)
+    : PipeInterface(t)
+    , chain(t)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    return chain.send(std::move(packet));
+  }
+  std::unique_ptr<Packet> recv() override { return chain.recv(); }
+
+  void updateStat(StatName stat, uint64_t value) override
+  {
+    chain.updateStat(stat, value);
+    PipeInterface::updateStat(stat, value);
+  }
+  void updateRTT(uint16_t minRttMs, uint16_t bigRttMs) override
+  {
+    chain.updateRTT(minRttMs, bigRttMs);
+  }
+  void updateMTU(uint16_t mtu, uint32_t pps) override
+  {
+    chain.updateMTU(mtu, pps);
+  }
+  void updateBitrateUp(uint64_t minBps,
+                       uint64_t startBps,
+                       uint64_t maxBps) override
+  {
+    chain.updateBitrateUp(minBps, startBps, maxBps);
+  }
+  void ack(ShortName name) override
+  {
+    chain.ack(name);
+    PipeInterface::ack(name);
+  }
+  void sentAt(uint32_t sendId,
+              const std::chrono::time_point<std::chrono::steady_clock>& when)
+    override
+  {
+    chain.sentAt(sendId, when);
+    PipeInterface::sentAt(sendId, when);
+  }
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override
+  {
+    chain.registerMetrics(registry, labels);
+  }
+  void runUpdates(
+    const std::chrono::time_point<std::chrono::steady_clock>& now) override
+  {
+    chain.runUpdates(now);
+  }
+
+  Chain& stages() { return chain; }
+
+private:
+  Chain chain;
+};
+
+///
+/// Stages
+///
+
+// CrazyBitPipe: flips the spin bit once per RTT on the way out and clears
+// it on the way in
+template<typename Next>
+class CrazyBitStage : public StaticStage<Next>
+{
+public:
+  using StaticStage<Next>::StaticStage;
+
+  bool send(std::unique_ptr<Packet> packet)
+  {
+    spin.mark(*packet);
+    return this->next.send(std::move(packet));
+  }
+
+  std::unique_ptr<Packet> recv()
+  {
+    auto packet = this->next.recv();
+    if (packet) {
+      SpinBit::clear(*packet);
+    }
+    return packet;
+  }
+
+  void updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
+  {
+    spin.setRtt(minRttMs);
+    this->next.updateRTT(minRttMs, bigRttMs);
+  }
+
+  [[nodiscard]] bool spinBit() const { return spin.value(); }
+
+private:
+  SpinBit spin;
+};
+
+// StatsPipe: keeps the last value of every stat passed up, and mirrors
+// them into gauges once registered
+template<typename Next>
+class StatsStage : public StaticStage<Next>
+{
+public:
+  using StaticStage<Next>::StaticStage;
+
+  void updateStat(PipeInterface::StatName stat, uint64_t value)
+  {
+    stats.update(*this, stat, value);
+    this->next.updateStat(stat, value);
+  }
+
+  void updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
+  {
+    stats.set(PipeInterface::StatName::minRTTms, minRttMs);
+    stats.set(PipeInterface::StatName::bigRTTms, bigRttMs);
+    this->next.updateRTT(minRttMs, bigRttMs);
+  }
+
+  void updateMTU(uint16_t mtu, uint32_t pps)
+  {
+    stats.set(PipeInterface::StatName::mtu, mtu);
+    stats.set(PipeInterface::StatName::ppsTargetUp, pps);
+    this->next.updateMTU(mtu, pps);
+  }
+
+  void registerMetrics(MetricsRegistry& registry, const std::string& labels)
+  {
+    stats.registerMetrics(registry, labels);
+    this->next.registerMetrics(registry, labels);
+  }
+
+  [[nodiscard]] uint64_t getStat(PipeInterface::StatName stat) const
+  {
+    return stats.get(stat);
+  }
+
+private:
+  PipeStats stats;
+};
+
+} // namespace MediaNet
@@ -1,7 +1,5 @@
 
-
 #include <cassert>
-#include <iostream>
 
 #include "statsPipe.hh"
 
@@ -9,45 +7,26 @@ using namespace MediaNet;
 
 StatsPipe::StatsPipe(PipeInterface* t)
   : PipeInterface(t)
+{}
+
+bool
+StatsPipe::sendBatch(Batch& packets)
 {
-  for (int stat = (int)PipeInterface::StatName::none;
-       stat <= (int)PipeInterface::StatName::bad;
-       stat++) {
-    stats.insert(std::pair<PipeInterface::StatName, uint64_t>(
-      (PipeInterface::StatName)stat, 0));
-  }
+  assert(nextPipe);
+  return nextPipe->sendBatch(packets);
 }
 
 void
 StatsPipe::updateStat(PipeInterface::StatName stat, uint64_t value)
 {
-  stats.at(stat) = value;
-
-  // TODO if min or max rtt to a set of all of them
-  if (stat == PipeInterface::StatName::minRTTms) {
-    uint16_t minRtt = stats.at(PipeInterface::StatName::minRTTms);
-    uint16_t bigRtt = stats.at(PipeInterface::StatName::bigRTTms);
-
-    if (minRtt > bigRtt) {
-      std::clog << "bigRTT too small mintRtt=" << minRtt
-                << "  bigRtt=" << bigRtt << std::endl;
-      bigRtt = (minRtt * 3) / 2;
-    }
-    this->updateRTT(minRtt, bigRtt);
-  }
-
-  if (stat == PipeInterface::StatName::mtu) {
-    uint16_t mtu = stats.at(PipeInterface::StatName::mtu);
-    uint32_t pps = stats.at(PipeInterface::StatName::ppsTargetUp);
-    this->updateMTU(mtu, pps);
-  }
+  stats.update(*this, stat, value);
 }
 
 void
 StatsPipe::updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
 {
-  stats.at(PipeInterface::StatName::minRTTms) = minRttMs;
-  stats.at(PipeInterface::StatName::bigRTTms) = bigRttMs;
+  stats.set(PipeInterface::StatName::minRTTms, minRttMs);
+  stats.set(PipeInterface::StatName::bigRTTms, bigRttMs);
 
   PipeInterface::updateRTT(minRttMs, bigRttMs);
 }
@@ -55,8 +34,103 @@ StatsPipe::updateRTT(uint16_t minRttMs, uint16_t bigRttMs)
 void
 StatsPipe::updateMTU(uint16_t mtu, uint32_t pps)
 {
-  stats.at(PipeInterface::StatName::mtu) = mtu;
-  stats.at(PipeInterface::StatName::ppsTargetUp) = pps;
+  stats.set(PipeInterface::StatName::mtu, mtu);
+  stats.set(PipeInterface::StatName::ppsTargetUp, pps);
 
   PipeInterface::updateMTU(mtu, pps);
 }
+
+void
+StatsPipe::registerMetrics(MetricsRegistry& registry, const std::string& labels)
+{
+  stats.registerMetrics(registry, labels);
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
+uint64_t
+StatsPipe::getStat(PipeInterface::StatName stat) const
+{
+  return stats.get(stat);
+}
+
+///
+/// PipeStats
+///
+
+PipeStats::PipeStats()
+{
+  for (size_t stat = 0; stat < numStats; stat++) {
+    stats[stat].store(0, std::memory_order_relaxed);
+    gauges[stat].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+void
+PipeStats::set(StatName stat, uint64_t value)
+{
+  assert(size_t(stat) < numStats);
+  stats[size_t(stat)].store(value, std::memory_order_relaxed);
+
+  Gauge* gauge = gauges[size_t(stat)].load(std::memory_order_acquire);
+  if (gauge) {
+    gauge->set(int64_t(value));
+  }
+}
+
+uint64_t
+PipeStats::get(StatName stat) const
+{
+  assert(size_t(stat) < numStats);
+  return stats[size_t(stat)].load(std::memory_order_relaxed);
+}
+
+void
+PipeStats::registerMetrics(MetricsRegistry& registry, const std::string& labels)
+{
+  for (size_t stat = 1; stat < size_t(StatName::bad); stat++) {
+    Gauge& gauge = registry.gauge(
+      metricName(StatName(stat)), "last value passed up the pipeline", labels);
+    gauge.set(int64_t(stats[stat].load(std::memory_order_relaxed)));
+    gauges[stat].store(&gauge, std::memory_order_release);
+  }
+}
+
+const char*
+PipeStats::metricName(StatName stat)
+{
+  switch (stat) {
+    case StatName::mtu:
+      return "quicr_mtu_bytes";
+    case StatName::minRTTms:
+      return "quicr_min_rtt_ms";
+    case StatName::bigRTTms:
+      return "quicr_big_rtt_ms";
+    case StatName::ppsTargetUp:
+      return "quicr_pps_target_up";
+    case StatName::lossPerMillionUp:
+      return "quicr_loss_per_million_up";
+    case StatName::lossPerMillionDown:
+      return "quicr_loss_per_million_down";
+    case StatName::bitrateUp:
+      return "quicr_bitrate_up_bps";
+    case StatName::bitrateDown:
+      return "quicr_bitrate_down_bps";
+    case StatName::jitterUpMs:
+      return "quicr_jitter_up_ms";
+    case StatName::jitterDownMs:
+      return "quicr_jitter_down_ms";
+    case StatName::connectionsActive:
+      return "quicr_connections_active";
+    case StatName::connectionsExpired:
+      return "quicr_connections_expired";
+    case StatName::cryptoQueueDepth:
+      return "quicr_crypto_queue_depth";
+    case StatName::cryptoUtilPercent:
+      return "quicr_crypto_util_percent";
+    case StatName::none:
+    case StatName::bad:
+      break;
+  }
+  return "quicr_unknown";
+}
@@ -1,19 +1,79 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
-#include <map>
+#include <iostream>
 #include <memory>
+#include <string>
 
 #include "pipeInterface.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
 
 namespace MediaNet {
 
+// The last value of every stat passed up, readable from any thread, and
+// mirrored into gauges once registered. StatsPipe and StatsStage both
+// keep their stats in one.
+class PipeStats
+{
+public:
+  using StatName = PipeInterface::StatName;
+
+  PipeStats();
+
+  // records a stat passed up, and tells pipe and those below it the RTT
+  // or MTU when that is what changed
+  template<typename Pipe>
+  void update(Pipe& pipe, StatName stat, uint64_t value)
+  {
+    set(stat, value);
+
+    // TODO if min or max rtt to a set of all of them
+    if (stat == StatName::minRTTms) {
+      uint16_t minRtt = get(StatName::minRTTms);
+      uint16_t bigRtt = get(StatName::bigRTTms);
+
+      if (minRtt > bigRtt) {
+        std::clog << "bigRTT too small mintRtt=" << minRtt
+                  << "  bigRtt=" << bigRtt << std::endl;
+        bigRtt = (minRtt * 3) / 2;
+      }
+      pipe.updateRTT(minRtt, bigRtt);
+    }
+
+    if (stat == StatName::mtu) {
+      uint16_t mtu = get(StatName::mtu);
+      uint32_t pps = get(StatName::ppsTargetUp);
+      pipe.updateMTU(mtu, pps);
+    }
+  }
+
+  void set(StatName stat, uint64_t value);
+  [[nodiscard]] uint64_t get(StatName stat) const;
+
+  void registerMetrics(MetricsRegistry& registry, const std::string& labels);
+
+  // metric name of a stat, such as quicr_min_rtt_ms
+  static const char* metricName(StatName stat);
+
+private:
+  static constexpr size_t numStats = size_t(StatName::bad) + 1;
+
+  std::array<std::atomic<uint64_t>, numStats> stats;
+  std::array<std::atomic<Gauge*>, numStats> gauges;
+};
+
+// Keeps the last value of every stat passed up, readable from any thread,
+// and mirrors them into gauges once registered
 class StatsPipe : public PipeInterface
 {
 public:
   explicit StatsPipe(PipeInterface* t);
 
+  bool sendBatch(Batch& packets) override;
+
   void updateStat(StatName stat,
                   uint64_t value) override; // tells upstream things the stat
 
@@ -21,8 +81,13 @@ public:
 
   void updateMTU(uint16_t mtu, uint32_t pps) override;
 
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+  [[nodiscard]] uint64_t getStat(StatName stat) const;
+
 private:
-  std::map<PipeInterface::StatName, uint64_t> stats;
+  PipeStats stats;
 };
 
 } // namespace MediaNet
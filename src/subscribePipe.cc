@@ -14,6 +14,13 @@ SubscribePipe::SubscribePipe(PipeInterface* t)
   : PipeInterface(t)
 {}
 
+bool
+SubscribePipe::sendBatch(Batch& packets)
+{
+  assert(nextPipe);
+  return nextPipe->sendBatch(packets);
+}
+
 bool
 SubscribePipe::subscribe(const ShortName& name)
 {
@@ -15,6 +15,7 @@ public:
   explicit SubscribePipe(PipeInterface* t);
 
   bool subscribe(const ShortName& name);
+  bool sendBatch(Batch& packets) override;
   std::unique_ptr<Packet> recv() override;
 
 private:
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace MediaNet {
+
+///
+/// TimerWheel
+///
+
+// Hashed timer wheel. A timer lands in the slot for its deadline tick and
+// advance() only looks at the slots of the ticks that went by, so
+// schedule and expire are O(1) amortized however many timers there are.
+// Timers far enough out to wrap around the wheel are put back until their
+// tick comes. There is no cancel: the owner checks in the expired callback
+// whether the timer still matters and schedules it again if needed, which
+// keeps refreshing a timer off the per packet path.
+template<typename Key>
+class TimerWheel
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  TimerWheel(std::chrono::milliseconds tickLength,
+             size_t numSlots,
+             const timepoint& now)
+    : tick(tickLength)
+    , start(now)
+    , currentTick(0)
+    , count(0)
+  {
+    size_t cap = 1;
+    while (cap < numSlots) {
+      cap *= 2;
+    }
+    slots.resize(cap);
+    mask = cap - 1;
+  }
+
+  void schedule(const Key& key, const timepoint& when)
+  {
+    // never in the current slot, it has already been looked at
+    uint64_t due = std::max(tickOf(when), currentTick + 1);
+    slots[due & mask].push_back(Entry{ key, due });
+    count++;
+  }
+
+  // calls expired(key) for each timer due by now
+  template<typename Callback>
+  size_t advance(const timepoint& now, Callback&& expired)
+  {
+    uint64_t target = tickOf(now);
+    if (target <= currentTick) {
+      return 0;
+    }
+
+    // after a long stall one pass over every slot is enough
+    uint64_t first = currentTick + 1;
+    if (target - currentTick > slots.size()) {
+      first = target - slots.size() + 1;
+    }
+    currentTick = target;
+
+    size_t fired = 0;
+    for (uint64_t t = first; t <= target; t++) {
+      auto& slot = slots[t & mask];
+      if (slot.empty()) {
+        continue;
+      }
+
+      // callbacks may schedule, so work on a copy of the slot
+      due.clear();
+      due.swap(slot);
+      for (const auto& entry : due) {
+        if (entry.tick > target) {
+          slot.push_back(entry); // more laps to go
+          continue;
+        }
+        count--;
+        fired++;
+        expired(entry.key);
+      }
+    }
+
+    return fired;
+  }
+
+  [[nodiscard]] size_t size() const { return count; }
+
+private:
+  struct Entry
+  {
+    Key key;
+    uint64_t tick;
+  };
+
+  [[nodiscard]] uint64_t tickOf(const timepoint& when) const
+  {
+    if (when <= start) {
+      return 0;
+    }
+    return uint64_t((when - start) / tick);
+  }
+
+  const std::chrono::milliseconds tick;
+  const timepoint start;
+  uint64_t currentTick;
+
+  std::vector<std::vector<Entry>> slots;
+  size_t mask;
+  size_t count;
+
+  std::vector<Entry> due;
+};
+
+} // namespace MediaNet
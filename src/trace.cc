@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+#include "quicr/trace.hh"
+
+using namespace MediaNet;
+
+TraceRecorder::TraceRecorder(MetricsRegistry& registry)
+  : nextRecord(0)
+{
+  auto bounds = Histogram::decadeBounds(10000000000); // 10 s
+  for (const auto& stage : stages()) {
+    histograms.push_back(&registry.histogram(
+      "quicr_stage_latency_ns",
+      "time packets take from one trace point to the next",
+      bounds,
+      std::string("stage=\"") + stage.name + "\""));
+  }
+}
+
+void
+TraceRecorder::finish(const PacketTrace& trace, const ShortName& name)
+{
+  bool any = false;
+  for (size_t i = 0; i < stages().size(); i++) {
+    const Stage& stage = stages()[i];
+    uint64_t from = trace.at(stage.from);
+    uint64_t to = trace.at(stage.to);
+    if (from == 0 || to == 0 || to < from) {
+      continue;
+    }
+    histograms[i]->record(to - from);
+    any = true;
+  }
+  if (!any) {
+    return; // control packets only pass one point
+  }
+
+  std::lock_guard<std::mutex> lock(recordMutex);
+  if (records.size() < maxRecords) {
+    records.push_back(Record{ trace, name });
+  } else {
+    records[nextRecord] = Record{ trace, name };
+  }
+  nextRecord = (nextRecord + 1) % maxRecords;
+}
+
+void
+TraceRecorder::dumpText(std::ostream& out) const
+{
+  for (size_t i = 0; i < stages().size(); i++) {
+    const Histogram& histogram = *histograms[i];
+    auto buckets = histogram.buckets();
+    uint64_t count = 0;
+    for (auto bucket : buckets) {
+      count += bucket;
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    // upper bound of the bucket the percentile falls in
+    auto percentile = [&](double p) -> std::string {
+      uint64_t rank = uint64_t(p * double(count - 1)) + 1;
+      uint64_t seen = 0;
+      for (size_t b = 0; b < buckets.size(); b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+          return b < histogram.bounds().size()
+                   ? std::to_string(histogram.bounds()[b] / 1000) + "us"
+                   : std::string("inf");
+        }
+      }
+      return "inf";
+    };
+
+    out << std::left << std::setw(14) << stages()[i].name
+        << " count=" << count
+        << " mean=" << histogram.sum() / count / 1000 << "us"
+        << " p50<=" << percentile(0.5) << " p99<=" << percentile(0.99)
+        << std::endl;
+  }
+}
+
+void
+TraceRecorder::dumpChromeTrace(std::ostream& out) const
+{
+  std::lock_guard<std::mutex> lock(recordMutex);
+
+  // oldest first
+  size_t first = records.size() < maxRecords ? 0 : nextRecord;
+  bool comma = false;
+  out << "[";
+  for (size_t n = 0; n < records.size(); n++) {
+    const Record& record = records[(first + n) % records.size()];
+    bool publish = record.trace.at(TracePoint::received) == 0;
+
+    for (const auto& stage : stages()) {
+      uint64_t from = record.trace.at(stage.from);
+      uint64_t to = record.trace.at(stage.to);
+      if (from == 0 || to == 0 || to < from) {
+        continue;
+      }
+      out << (comma ? ",\n" : "\n") << "{\"name\":\"" << stage.name
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (publish ? 1 : 2)
+          << ",\"ts\":" << from / 1000 << "." << std::setfill('0')
+          << std::setw(3) << from % 1000 << ",\"dur\":" << (to - from) / 1000
+          << "." << std::setw(3) << (to - from) % 1000 << std::setfill(' ')
+          << ",\"args\":{\"name\":\"" << record.name.resourceID << "/"
+          << record.name.senderID << "/" << int(record.name.sourceID) << "/"
+          << record.name.mediaTime << "/" << int(record.name.fragmentID)
+          << "\"}}";
+      comma = true;
+    }
+  }
+  out << "\n]\n";
+}
+
+const std::vector<TraceRecorder::Stage>&
+TraceRecorder::stages()
+{
+  static const std::vector<Stage> all = {
+    { "seal", TracePoint::publish, TracePoint::sealed },
+    { "fragment", TracePoint::sealed, TracePoint::fragmented },
+    { "pipes", TracePoint::fragmented, TracePoint::queued },
+    { "send_queue", TracePoint::queued, TracePoint::dequeued }, // and pacing
+    { "transmit", TracePoint::dequeued, TracePoint::sent },
+    { "recv_pipes", TracePoint::received, TracePoint::recvQueued },
+    { "recv_queue", TracePoint::recvQueued, TracePoint::recvDequeued },
+    { "reassembly", TracePoint::recvDequeued, TracePoint::reassembled },
+    { "open", TracePoint::reassembled, TracePoint::opened },
+    { "jitter_buffer", TracePoint::opened, TracePoint::delivered },
+    { "publish_total", TracePoint::publish, TracePoint::sent },
+    { "receive_total", TracePoint::received, TracePoint::delivered },
+  };
+  return all;
+}
+
+TraceRecorder&
+TraceRecorder::global()
+{
+  static TraceRecorder recorder(MetricsRegistry::global());
+  return recorder;
+}
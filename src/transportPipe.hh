@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+#include "pipeInterface.hh"
+#include "quicr/packetCapture.hh"
+
+namespace MediaNet {
+
+// The bottom of a chain, which moves packets to and from other hosts.
+// UdpPipe does it over a socket, LoopbackPipe inside the process.
+class TransportPipe : public PipeInterface
+{
+public:
+  // true once recv() has a packet, false on timeout
+  virtual bool waitReadable(std::chrono::milliseconds timeout) const = 0;
+  // for apps that wait in their own poll loop, -1 when there is none
+  [[nodiscard]] virtual int getFd() const = 0;
+
+  // records every datagram sent and received, nullptr to stop. Call
+  // before start(), capture has to outlive the pipe.
+  void setCapture(PacketCapture* packetCapture) { capture = packetCapture; }
+
+protected:
+  TransportPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  PacketCapture* capture = nullptr;
+};
+
+} // namespace MediaNet
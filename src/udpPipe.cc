@@ -1,13 +1,17 @@
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <thread>
 
 #if defined(__linux) || defined(__APPLE__)
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <poll.h>
 #endif
 #if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/ethernet.h>
 #include <netpacket/packet.h>
 #include <string.h>
@@ -25,9 +29,48 @@
 
 using namespace MediaNet;
 
+#if defined(__linux__)
+// Kernel and NIC timestamps are on CLOCK_REALTIME, or on the NIC's own
+// clock. They move to steady_clock by how long ago they were; false for
+// one not from the last second, such as a NIC clock that is not kept to
+// the system clock.
+static bool
+toSteady(const struct timespec& stamp,
+         std::chrono::steady_clock::time_point& steady)
+{
+  if (stamp.tv_sec == 0 && stamp.tv_nsec == 0) {
+    return false;
+  }
+  auto steadyNow = std::chrono::steady_clock::now();
+  auto age = std::chrono::system_clock::now().time_since_epoch() -
+             (std::chrono::seconds(stamp.tv_sec) +
+              std::chrono::nanoseconds(stamp.tv_nsec));
+  if (age < std::chrono::seconds(0) || age > std::chrono::seconds(1)) {
+    return false;
+  }
+  steady =
+    steadyNow -
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+  return true;
+}
+
+// ts[0] is the software timestamp, ts[2] the NIC's
+static bool
+pickTimestamp(const struct cmsghdr* cmsg,
+              bool hardware,
+              std::chrono::steady_clock::time_point& steady)
+{
+  struct scm_timestamping stamps
+  {};
+  std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+  return (hardware && toSteady(stamps.ts[2], steady)) ||
+         toSteady(stamps.ts[0], steady);
+}
+#endif
+
 UdpPipe::UdpPipe()
-  : PipeInterface(nullptr)
-  , serverAddr()
+  : serverAddr()
+  , localAddr()
 {
   fd = 0;
 }
@@ -51,6 +94,31 @@ UdpPipe::ready() const
   return (fd > 0);
 }
 
+bool
+UdpPipe::waitReadable(std::chrono::milliseconds timeout) const
+{
+  if (fd <= 0) {
+    return false;
+  }
+
+  struct pollfd pfd
+  {};
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+#if defined(_WIN32)
+  int num = WSAPoll(&pfd, 1, int(timeout.count()));
+#else
+  int num = poll(&pfd, 1, int(timeout.count()));
+#endif
+  return num > 0;
+}
+
+int
+UdpPipe::getFd() const
+{
+  return fd > 0 ? int(fd) : -1;
+}
+
 void
 UdpPipe::stop()
 {
@@ -65,6 +133,29 @@ UdpPipe::stop()
   }
 }
 
+void
+UdpPipe::setTimestamps(bool receive, bool send, bool hardware)
+{
+  rxTimestamps = receive;
+  txTimestamps = send;
+  hwTimestamps = hardware;
+}
+
+void
+UdpPipe::registerMetrics(MetricsRegistry& registry, const std::string& labels)
+{
+  packetsSent = &registry.counter(
+    "quicr_udp_sent_packets_total", "datagrams sent", labels);
+  bytesSent =
+    &registry.counter("quicr_udp_sent_bytes_total", "bytes sent", labels);
+  packetsReceived = &registry.counter(
+    "quicr_udp_received_packets_total", "datagrams received", labels);
+  bytesReceived = &registry.counter(
+    "quicr_udp_received_bytes_total", "bytes received", labels);
+
+  PipeInterface::registerMetrics(registry, labels);
+}
+
 bool
 UdpPipe::send(std::unique_ptr<Packet> packet)
 {
@@ -88,6 +179,12 @@ UdpPipe::send(std::unique_ptr<Packet> packet)
   }
   // std::clog << "Send to " << addr.toString() << std::endl;
 
+  // in the kernel's order, which keys the timestamps it sends back
+  std::unique_lock<std::mutex> sendIdLock(sendIdMutex, std::defer_lock);
+  if (txTimestamps) {
+    sendIdLock.lock();
+  }
+
   int numSent = sendto(fd,
                        (const char*)&(packet->fullData()),
                        (int)(packet->fullSize()),
@@ -116,6 +213,25 @@ UdpPipe::send(std::unique_ptr<Packet> packet)
     assert(0); // TODO
   }
 
+  if (txTimestamps && numSent >= 0) {
+    sendIds[numTimestamped++ % sendIdsSize] = packet->getSendId();
+    // past the ring the older ones can not be matched anyway
+    if (timestampsPending.load() < sendIdsSize) {
+      timestampsPending++;
+    }
+    sendIdLock.unlock();
+  }
+
+  if (capture) {
+    capture->record(
+      localAddr, addr, &packet->fullData(), packet->fullSize());
+  }
+  if (packetsSent) {
+    packetsSent->add();
+    bytesSent->add(uint64_t(numSent));
+  }
+  QUICR_TRACE(packet, sent);
+  QUICR_TRACE_FINISH(packet);
   return true;
 }
 
@@ -128,6 +244,10 @@ UdpPipe::recv()
     return std::unique_ptr<Packet>(nullptr);
   }
 
+  if (timestampsPending.load() > 0) {
+    readSendTimestamps();
+  }
+
   auto packet = std::make_unique<Packet>();
 
   const int dataSize = 1500;
@@ -137,12 +257,31 @@ UdpPipe::recv()
   memset(&remoteAddr.addr, 0, sizeof(remoteAddr.addr));
   remoteAddr.addrLen = sizeof(remoteAddr.addr);
 
+#if defined(__linux__)
+  // recvmsg for the arrival timestamp that comes with it
+  struct iovec iov
+  {};
+  iov.iov_base = &(packet->fullData());
+  iov.iov_len = packet->fullSize();
+  alignas(struct cmsghdr) char control[256];
+  struct msghdr msg
+  {};
+  msg.msg_name = &remoteAddr.addr;
+  msg.msg_namelen = remoteAddr.addrLen;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  int rLen = int(recvmsg(fd, &msg, 0 /*flags*/));
+  remoteAddr.addrLen = msg.msg_namelen;
+#else
   int rLen = recvfrom(fd,
                       (char*)&(packet->fullData()),
                       (int)packet->fullSize(),
                       0 /*flags*/,
                       (struct sockaddr*)&remoteAddr.addr,
                       &remoteAddr.addrLen);
+#endif
   if (rLen < 0) {
 #if defined(_WIN32)
     int error = WSAGetLastError();
@@ -183,6 +322,25 @@ UdpPipe::recv()
 
   packet->setSrc(remoteAddr);
   packet->resizeFull(rLen);
+  QUICR_TRACE(packet, received);
+#if defined(__linux__)
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    std::chrono::steady_clock::time_point arrived;
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_TIMESTAMPING &&
+        pickTimestamp(cmsg, hwTimestamps, arrived)) {
+      packet->setWireTime(arrived);
+    }
+  }
+#endif
+  if (capture) {
+    capture->record(remoteAddr, localAddr, &packet->fullData(), size_t(rLen));
+  }
+
+  if (packetsReceived) {
+    packetsReceived->add();
+    bytesReceived->add(uint64_t(rLen));
+  }
 
   return packet;
 }
@@ -207,6 +365,10 @@ bool UdpPipe::start(const uint16_t serverPort, const std::string& serverName,
     assert(0); // TODO
   }
 
+#if defined(__linux__)
+  enableTimestamps();
+#endif
+
   // make socket non blocking IO
   struct timeval timeOut
   {};
@@ -311,5 +473,105 @@ bool UdpPipe::start(const uint16_t serverPort, const std::string& serverName,
 #endif
   }
 
+  localAddr.addrLen = sizeof(localAddr.addr);
+  if (getsockname(
+        fd, (struct sockaddr*)&localAddr.addr, &localAddr.addrLen) != 0) {
+    localAddr = serverAddr;
+  }
+
   return true;
 }
+
+///
+/// Private Implementation
+///
+
+void
+UdpPipe::enableTimestamps()
+{
+#if defined(__linux__)
+  unsigned int flags = 0;
+  if (rxTimestamps) {
+    flags |= SOF_TIMESTAMPING_RX_SOFTWARE;
+    if (hwTimestamps) {
+      flags |= SOF_TIMESTAMPING_RX_HARDWARE;
+    }
+  }
+  if (txTimestamps) {
+    // keyed by a count of sends, without the packet echoed back
+    flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+             SOF_TIMESTAMPING_OPT_TSONLY;
+    if (hwTimestamps) {
+      flags |= SOF_TIMESTAMPING_TX_HARDWARE;
+    }
+  }
+  if (flags == 0) {
+    return;
+  }
+  flags |= SOF_TIMESTAMPING_SOFTWARE;
+  if (hwTimestamps) {
+    flags |= SOF_TIMESTAMPING_RAW_HARDWARE;
+  }
+
+  if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) != 0) {
+    std::clog << "UdpTransport: no kernel timestamps: " << strerror(errno)
+              << std::endl;
+    rxTimestamps = false;
+    txTimestamps = false;
+  }
+#endif
+}
+
+void
+UdpPipe::readSendTimestamps()
+{
+#if defined(__linux__)
+  while (timestampsPending.load() > 0) {
+    alignas(struct cmsghdr) char control[256];
+    struct msghdr msg
+    {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // the kernel had none for some sends, or lost them, so stop
+        // looking until the next send. One that is still on its way is
+        // read after that send, the ids come from the kernel's count.
+        timestampsPending = 0;
+      }
+      return;
+    }
+    timestampsPending--;
+
+    const struct cmsghdr* stamp = nullptr;
+    struct sock_extended_err err
+    {};
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        stamp = cmsg;
+      } else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) {
+        std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+      }
+    }
+    if (!stamp || err.ee_errno != ENOMSG ||
+        err.ee_origin != SO_EE_ORIGIN_TIMESTAMPING ||
+        err.ee_info != SCM_TSTAMP_SND) {
+      continue;
+    }
+
+    uint32_t sendId = 0;
+    {
+      std::lock_guard<std::mutex> lock(sendIdMutex);
+      if (numTimestamped - err.ee_data <= sendIdsSize) {
+        sendId = sendIds[err.ee_data % sendIdsSize];
+      }
+    }
+    std::chrono::steady_clock::time_point left;
+    if (sendId != 0 && prevPipe && pickTimestamp(stamp, hwTimestamps, left)) {
+      prevPipe->sentAt(sendId, left);
+    }
+  }
+#endif
+}
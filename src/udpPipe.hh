@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <sys/types.h>
 
@@ -14,12 +17,13 @@
 #include <cstdint>
 #include <string>
 
-#include "pipeInterface.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
+#include "transportPipe.hh"
 
 namespace MediaNet {
 
-class UdpPipe : public PipeInterface
+class UdpPipe : public TransportPipe
 {
 public:
   UdpPipe();
@@ -34,7 +38,36 @@ public:
   std::unique_ptr<Packet> recv()
     override; // non blocking, return nullptr if no buffer
 
+  bool waitReadable(std::chrono::milliseconds timeout) const override;
+  [[nodiscard]] int getFd() const override;
+
+  // call before start()
+  void registerMetrics(MetricsRegistry& registry,
+                       const std::string& labels) override;
+
+  // Kernel timestamps, Linux only, receive on by default. With receive on,
+  // packets from recv() carry the time they arrived as their wire time.
+  // With send on, a later recv() reports the time each packet with a
+  // sendId left with sentAt(). hardware prefers the NIC's timestamps, for
+  // an interface with timestamping turned on and its clock kept to the
+  // system clock. Call before start().
+  void setTimestamps(bool receive, bool send, bool hardware);
+
 private:
+  void enableTimestamps();
+  void readSendTimestamps(); // from the error queue, under socketMutex
+
+  bool rxTimestamps = true;
+  bool txTimestamps = false;
+  bool hwTimestamps = false;
+
+  // the sendId of each timestamped send, by the kernel's count of them
+  static constexpr size_t sendIdsSize = 1024;
+  std::mutex sendIdMutex;
+  std::array<uint32_t, sendIdsSize> sendIds{};
+  uint32_t numTimestamped = 0;              // under sendIdMutex
+  std::atomic<uint32_t> timestampsPending{ 0 }; // not yet read, capped
+
   std::mutex socketMutex;
 #if defined(_WIN32)
   SOCKET fd; // UDP socket
@@ -43,6 +76,12 @@ private:
 #endif
 
   IpAddr serverAddr;
+  IpAddr localAddr; // as bound, for the capture
+
+  Counter* packetsSent = nullptr;
+  Counter* bytesSent = nullptr;
+  Counter* packetsReceived = nullptr;
+  Counter* bytesReceived = nullptr;
 };
 
 } // namespace MediaNet
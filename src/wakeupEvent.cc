@@ -0,0 +1,112 @@
+#include <cassert>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "wakeupEvent.hh"
+
+using namespace MediaNet;
+
+WakeupEvent::WakeupEvent()
+  : signaled(false)
+  , readFd(-1)
+  , writeFd(-1)
+{}
+
+WakeupEvent::~WakeupEvent()
+{
+#if defined(__linux__) || defined(__APPLE__)
+  if (writeFd >= 0 && writeFd != readFd) {
+    ::close(writeFd);
+  }
+  if (readFd >= 0) {
+    ::close(readFd);
+  }
+#endif
+}
+
+void
+WakeupEvent::notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (signaled) {
+      return; // already up, nobody can be waiting
+    }
+    signaled = true;
+
+#if defined(__linux__) || defined(__APPLE__)
+    if (writeFd >= 0) {
+      uint64_t one = 1;
+      [[maybe_unused]] auto n =
+        ::write(writeFd, &one, writeFd == readFd ? sizeof(one) : 1);
+    }
+#endif
+  }
+  cv.notify_all();
+}
+
+void
+WakeupEvent::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!signaled) {
+    return;
+  }
+  signaled = false;
+
+#if defined(__linux__) || defined(__APPLE__)
+  if (readFd >= 0) {
+    uint64_t count;
+    [[maybe_unused]] auto n =
+      ::read(readFd, &count, writeFd == readFd ? sizeof(count) : 1);
+  }
+#endif
+}
+
+bool
+WakeupEvent::waitUntil(const timepoint& deadline)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return cv.wait_until(lock, deadline, [this]() { return signaled; });
+}
+
+int
+WakeupEvent::fd()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (readFd >= 0) {
+    return readFd;
+  }
+
+#if defined(__linux__)
+  readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  writeFd = readFd;
+#elif defined(__APPLE__)
+  int fds[2];
+  if (pipe(fds) == 0) {
+    for (int f : fds) {
+      fcntl(f, F_SETFL, fcntl(f, F_GETFL) | O_NONBLOCK);
+      fcntl(f, F_SETFD, FD_CLOEXEC);
+    }
+    readFd = fds[0];
+    writeFd = fds[1];
+  }
+#endif
+
+  // the fd has to reflect a notify that came before it existed
+  if (signaled && writeFd >= 0) {
+#if defined(__linux__) || defined(__APPLE__)
+    uint64_t one = 1;
+    [[maybe_unused]] auto n =
+      ::write(writeFd, &one, writeFd == readFd ? sizeof(one) : 1);
+#endif
+  }
+  return readFd;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace MediaNet {
+
+///
+/// WakeupEvent
+///
+
+// Level triggered flag a producer thread raises when there is something to
+// receive. A consumer clears it before it checks for data and then waits,
+// so a notify between the check and the wait is not lost. fd() gives a
+// descriptor that is readable while the flag is up, for apps that wait in
+// their own poll or epoll loop; it is only created when asked for, and is
+// -1 on platforms without eventfd or pipes.
+class WakeupEvent
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  WakeupEvent();
+  ~WakeupEvent();
+  WakeupEvent(const WakeupEvent&) = delete;
+  WakeupEvent& operator=(const WakeupEvent&) = delete;
+
+  void notify();
+  void clear();
+
+  // returns false if the deadline passed without a notify
+  bool waitUntil(const timepoint& deadline);
+
+  int fd();
+
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool signaled;
+
+  int readFd;
+  int writeFd; // same as readFd for an eventfd
+};
+
+} // namespace MediaNet
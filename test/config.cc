@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdio>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <string>
+
+#include "../src/crazyBitPipe.hh"
+#include "../src/fecPipe.hh"
+#include "../src/priorityPipe.hh"
+#include "../src/retransmitPipe.hh"
+#include "../src/udpPipe.hh"
+#include "quicr/config.hh"
+#include "quicr/quicRClient.hh"
+
+using namespace MediaNet;
+
+static std::string
+writeFile(const std::string& text)
+{
+  std::string path = "quicr_test_config.conf";
+  std::ofstream file(path);
+  file << text;
+  return path;
+}
+
+template<typename Stage>
+static bool
+hasStage(const QuicRClient& client)
+{
+  auto pipes = client.pipes();
+  return std::any_of(pipes.begin(), pipes.end(), [](const PipeInterface* p) {
+    return dynamic_cast<const Stage*>(p) != nullptr;
+  });
+}
+
+TEST_CASE("loadClientConfig sets the keys in the file")
+{
+  auto path = writeFile("# comment\n"
+                        "\n"
+                        "fec = off   # no duplicates\n"
+                        "spinBit=false\n"
+                        "  mtu = 1400\n"
+                        "cryptoThreads = 2\n"
+                        "jitterMaxMs = 60\n"
+                        "impairUp.delayMs = 40\n"
+                        "impairDown.lossGoodPerMillion = 10000\n"
+                        "capture = relay.pcap\n");
+  ClientConfig config;
+  CHECK(loadClientConfig(path, config));
+  CHECK_FALSE(config.fec);
+  CHECK_FALSE(config.spinBit);
+  CHECK(config.retransmit);
+  CHECK_EQ(config.mtu, 1400);
+  CHECK_EQ(config.pps, 480);
+  CHECK_EQ(config.cryptoThreads, 2);
+  CHECK_EQ(config.jitterMaxMs, 60);
+  CHECK_EQ(config.impairUp.delayMs, 40);
+  CHECK(config.impairUp.active());
+  CHECK_EQ(config.impairDown.lossGoodPerMillion, 10000);
+  CHECK_EQ(config.impairDown.delayMs, 0);
+
+  // the relay reads the same file, and the client keys are checked for it
+  RelayConfig relay;
+  CHECK(loadRelayConfig(path, relay));
+  CHECK_EQ(relay.capture, "relay.pcap");
+  CHECK_EQ(relay.captureFileBytes, 0);
+  CHECK_EQ(relay.relayPort, 5004);
+  std::remove(path.c_str());
+}
+
+TEST_CASE("loadClientConfig rejects bad lines and values")
+{
+  ClientConfig config;
+  CHECK_FALSE(loadClientConfig("no/such/file.conf", config));
+
+  auto path = writeFile("mtu = 99999\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+  CHECK_EQ(config.mtu, 1280);
+
+  // no room for the headers, or more than a datagram UdpPipe takes in
+  for (const char* mtu : { "mtu = 0\n", "mtu = 64\n", "mtu = 9000\n" }) {
+    path = writeFile(mtu);
+    CHECK_FALSE(loadClientConfig(path, config));
+    CHECK_EQ(config.mtu, 1280);
+  }
+
+  // a value out of range leaves the setting as it was
+  path = writeFile("sendQueueDepth = 0\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+  CHECK_EQ(config.sendQueueDepth, 1000);
+  path = writeFile("cryptoThreads = 1000\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+  CHECK_EQ(config.cryptoThreads, 0);
+
+  path = writeFile("fec = maybe\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+
+  path = writeFile("colour = blue\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+
+  path = writeFile("just words\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+
+  path = writeFile("impairUp.lossBadPerMillion = 1000001\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+
+  path = writeFile("jitterMinMs = 50\njitterMaxMs = 20\n");
+  CHECK_FALSE(loadClientConfig(path, config));
+
+  RelayConfig relay;
+  path = writeFile("relayPort = 70000\n");
+  CHECK_FALSE(loadRelayConfig(path, relay));
+  CHECK_EQ(relay.relayPort, 5004);
+  path = writeFile("mtu = 9000\n");
+  CHECK_FALSE(loadRelayConfig(path, relay));
+  std::remove(path.c_str());
+}
+
+TEST_CASE("QuicRClient publishes without the optional stages")
+{
+  ClientConfig config;
+  config.spinBit = false;
+  config.fec = false;
+  config.retransmit = false;
+  config.sendQueueDepth = 4;
+
+  QuicRClient client(config);
+  CHECK_FALSE(hasStage<CrazyBitPipe>(client));
+  CHECK_FALSE(hasStage<FecPipe>(client));
+  CHECK_FALSE(hasStage<RetransmitPipe>(client));
+  CHECK(hasStage<PriorityPipe>(client));
+  CHECK(hasStage<UdpPipe>(client));
+  CHECK(hasStage<CrazyBitPipe>(QuicRClient(ClientConfig())));
+
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  for (uint32_t i = 0; i < 10; i++) {
+    auto name = ShortName::fromString("qr://1234/12/");
+    name.mediaTime = i;
+    auto packet = client.createPacket(name, 100);
+    packet->resize(100);
+    packet->setReliable(true);
+    CHECK(client.publish(std::move(packet)));
+  }
+}
@@ -0,0 +1,75 @@
+#include <arpa/inet.h>
+#include <doctest/doctest.h>
+
+#include "../src/connectionTable.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+static IpAddr
+makeAddr(uint32_t host, uint16_t port)
+{
+  IpAddr ipAddr{};
+  ipAddr.addr.sin_family = AF_INET;
+  ipAddr.addr.sin_addr.s_addr = htonl(host);
+  ipAddr.addr.sin_port = htons(port);
+  ipAddr.addrLen = sizeof(ipAddr.addr);
+  return ipAddr;
+}
+
+TEST_CASE("ConnectionTable insert/find/erase")
+{
+  auto now = std::chrono::steady_clock::now();
+  ConnectionTable table;
+
+  auto a = makeAddr(0x0a000001, 5004);
+  auto b = makeAddr(0x0a000001, 5005);
+
+  CHECK_EQ(table.find(a), nullptr);
+
+  auto& con = table.insert(a, now);
+  CHECK(con.state == ConnectionTable::State::connected);
+  con.pathToken = 42;
+
+  CHECK_EQ(table.size(), 1);
+  REQUIRE_NE(table.find(a), nullptr);
+  CHECK_EQ(table.find(a)->pathToken, 42);
+  CHECK_EQ(table.find(b), nullptr);
+
+  // insert of an existing entry returns it
+  CHECK_EQ(table.insert(a, now).pathToken, 42);
+  CHECK_EQ(table.size(), 1);
+
+  CHECK(table.erase(a));
+  CHECK_FALSE(table.erase(a));
+  CHECK_EQ(table.find(a), nullptr);
+  CHECK_EQ(table.size(), 0);
+}
+
+TEST_CASE("ConnectionTable grows and keeps entries after erase")
+{
+  auto now = std::chrono::steady_clock::now();
+  ConnectionTable table(16);
+  const uint32_t num = 5000;
+
+  for (uint32_t i = 0; i < num; i++) {
+    table.insert(makeAddr(0xc0a80000 + i / 100, 1000 + i % 100), now)
+      .pathToken = i;
+  }
+  CHECK_EQ(table.size(), num);
+  CHECK_GE(table.capacity(), 2 * num);
+
+  // remove every third one, the rest must still be found
+  for (uint32_t i = 0; i < num; i += 3) {
+    CHECK(table.erase(makeAddr(0xc0a80000 + i / 100, 1000 + i % 100)));
+  }
+  for (uint32_t i = 0; i < num; i++) {
+    auto con = table.find(makeAddr(0xc0a80000 + i / 100, 1000 + i % 100));
+    if (i % 3 == 0) {
+      CHECK_EQ(con, nullptr);
+    } else {
+      REQUIRE_NE(con, nullptr);
+      CHECK_EQ(con->pathToken, i);
+    }
+  }
+}
@@ -0,0 +1,126 @@
+#include <atomic>
+#include <doctest/doctest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../src/cryptoWorkerPool.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+static std::unique_ptr<Packet>
+makePacket(uint32_t num)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->push_back(uint8_t(num >> 8));
+  packet->push_back(uint8_t(num));
+  return packet;
+}
+
+static uint32_t
+numOf(std::unique_ptr<Packet>& packet)
+{
+  const uint8_t* data = &packet->fullData();
+  return (uint32_t(data[0]) << 8) | data[1];
+}
+
+// uneven work so later packets often finish before earlier ones
+static bool
+slowWork(int, CryptoWorkerPool::Lane, std::unique_ptr<Packet>& packet)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(
+    (numOf(packet) * 37) % 200));
+  return numOf(packet) % 10 != 3; // drop some
+}
+
+TEST_CASE("CryptoWorkerPool hands results to the sink in submission order")
+{
+  const uint32_t num = 500;
+  std::mutex mutex;
+  std::vector<uint32_t> out;
+
+  {
+    CryptoWorkerPool pool(4, slowWork);
+    pool.setSink(CryptoWorkerPool::Lane::protect,
+                 [&](std::unique_ptr<Packet> packet) {
+                   std::lock_guard<std::mutex> lock(mutex);
+                   out.push_back(numOf(packet));
+                 });
+    for (uint32_t i = 0; i < num; i++) {
+      pool.submit(CryptoWorkerPool::Lane::protect, makePacket(i));
+    }
+    // destructor finishes the queued work
+  }
+
+  REQUIRE_EQ(out.size(), num - num / 10);
+  bool ordered = true;
+  for (size_t i = 1; i < out.size(); i++) {
+    ordered &= out[i - 1] < out[i];
+  }
+  CHECK(ordered);
+}
+
+TEST_CASE("CryptoWorkerPool pop returns results in order and reports stats")
+{
+  const uint32_t num = 200;
+  CryptoWorkerPool pool(3, slowWork);
+  for (uint32_t i = 0; i < num; i++) {
+    pool.submit(CryptoWorkerPool::Lane::unprotect, makePacket(i));
+  }
+
+  std::vector<uint32_t> out;
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (out.size() < num - num / 10 &&
+         std::chrono::steady_clock::now() < deadline) {
+    auto packet = pool.pop(CryptoWorkerPool::Lane::unprotect);
+    if (!packet) {
+      std::this_thread::sleep_for(100us);
+      continue;
+    }
+    out.push_back(numOf(packet));
+  }
+
+  REQUIRE_EQ(out.size(), num - num / 10);
+  bool ordered = true;
+  for (size_t i = 1; i < out.size(); i++) {
+    ordered &= out[i - 1] < out[i];
+  }
+  CHECK(ordered);
+
+  auto stats = pool.stats();
+  CHECK_EQ(stats.queueDepth, 0);
+  CHECK_EQ(stats.reorderDepth, 0);
+  REQUIRE_EQ(stats.workers.size(), 3);
+  uint64_t packets = 0;
+  for (const auto& worker : stats.workers) {
+    packets += worker.packets;
+    CHECK_LE(worker.utilizationPercent, 100);
+  }
+  CHECK_EQ(packets, num);
+}
+
+TEST_CASE("CryptoWorkerPool notifies when pop() has results")
+{
+  const uint32_t num = 50;
+  std::atomic<int> notified(0);
+  CryptoWorkerPool pool(2, slowWork);
+  pool.setNotify(CryptoWorkerPool::Lane::unprotect,
+                 [&notified]() { notified++; });
+  for (uint32_t i = 0; i < num; i++) {
+    pool.submit(CryptoWorkerPool::Lane::unprotect, makePacket(i));
+  }
+
+  uint32_t got = 0;
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (got < num - num / 10 && std::chrono::steady_clock::now() < deadline) {
+    if (pool.pop(CryptoWorkerPool::Lane::unprotect)) {
+      got++;
+    } else {
+      std::this_thread::sleep_for(100us);
+    }
+  }
+  CHECK_EQ(got, num - num / 10);
+  CHECK_GT(notified.load(), 0);
+}
@@ -0,0 +1,64 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+#include "../cmd/relay/include/egress_queue.hh"
+
+using namespace MediaNet;
+
+static std::unique_ptr<Packet>
+makePacket(uint8_t priority, uint8_t first, size_t size = 100)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->resizeFull(int(size));
+  packet->fullData() = first;
+  packet->setPriority(priority);
+  return packet;
+}
+
+TEST_CASE("EgressQueue sends the highest priority first, as PriorityPipe does")
+{
+  auto now = std::chrono::steady_clock::now();
+  EgressQueue queue(1, now);
+  queue.push(makePacket(0, 1)); // FEC repair
+  queue.push(makePacket(3, 2));
+  queue.push(makePacket(1, 3));
+  queue.push(makePacket(7, 4)); // shares the top queue
+  queue.push(makePacket(3, 5));
+
+  std::vector<int> order;
+  while (auto packet = queue.pop(now)) {
+    order.push_back(packet->fullData());
+  }
+  std::vector<int> expected{ 4, 2, 5, 3, 1 };
+  CHECK_EQ(order, expected);
+}
+
+TEST_CASE("EgressQueue drops the lowest priority first")
+{
+  auto now = std::chrono::steady_clock::now();
+  EgressQueue queue(1, now);
+  queue.setRate(100 * 1000); // holds 64 KiB at the least
+  for (int i = 0; i < 40; i++) {
+    queue.push(makePacket(3, 3, 1000));
+  }
+  for (int i = 0; i < 40; i++) {
+    queue.push(makePacket(0, 0, 1000));
+  }
+  CHECK_GT(queue.getDropCount(), 0);
+
+  // unshaped, so all that is left comes out now
+  queue.setRate(0);
+  int popped = 0;
+  int media = 0;
+  bool mediaFirst = true;
+  while (auto packet = queue.pop(now)) {
+    if (packet->fullData() == 3) {
+      mediaFirst &= popped < 40;
+      media++;
+    }
+    popped++;
+  }
+  CHECK_EQ(media, 40);
+  CHECK(mediaFirst);
+}
@@ -183,6 +183,7 @@ TEST_CASE("NetAck encode/decode")
   ackIn.ackVec = 0x4;
   ackIn.clientSeqNum = 0x1000;
   ackIn.recvTimeUs = 0x2000;
+  ackIn.ackDelayUs = 0x300;
 
   auto packet = std::make_unique<Packet>();
   packet << ackIn;
@@ -194,6 +195,7 @@ TEST_CASE("NetAck encode/decode")
   CHECK_EQ(ackIn.ackVec, ackOut.ackVec);
   CHECK_EQ(ackIn.recvTimeUs, ackOut.recvTimeUs);
   CHECK_EQ(ackIn.clientSeqNum, ackOut.clientSeqNum);
+  CHECK_EQ(ackIn.ackDelayUs, ackOut.ackDelayUs);
 }
 
 TEST_CASE("ClientData encode/decode")
@@ -207,6 +209,7 @@ TEST_CASE("ClientData encode/decode")
 
   chunkIn.shortName = ShortName(1, 2, 3);
   chunkIn.lifetime = toVarInt(0x1000);
+  chunkIn.priority = 3;
 
   dataBlockIn.metaDataLen = toVarInt(0);
   dataBlockIn.dataLen = toVarInt(dataIn.size());
@@ -230,6 +233,7 @@ TEST_CASE("ClientData encode/decode")
   CHECK_EQ(clientDataIn.clientSeqNum, clientDataOut.clientSeqNum);
   CHECK(chunkIn.shortName == chunkOut.shortName);
   CHECK_EQ(chunkIn.lifetime, chunkOut.lifetime);
+  CHECK_EQ(chunkIn.priority, chunkOut.priority);
   CHECK_EQ(dataBlockIn.metaDataLen, dataBlockOut.metaDataLen);
   CHECK_EQ(dataBlockIn.dataLen, dataBlockOut.dataLen);
   CHECK_EQ(dataIn[0], dataOut[0]);
@@ -247,6 +251,7 @@ TEST_CASE("RelayData encode/decode")
 
   chunkIn.shortName = ShortName(1, 2, 3);
   chunkIn.lifetime = toVarInt(0x1000);
+  chunkIn.priority = 2;
 
   dataBlockIn.metaDataLen = toVarInt(0);
   dataBlockIn.authTagLen = 4;
@@ -269,6 +274,7 @@ TEST_CASE("RelayData encode/decode")
   CHECK_EQ(relayDataIn.relaySeqNum, relayDataOut.relaySeqNum);
   CHECK(chunkIn.shortName == chunkOut.shortName);
   CHECK_EQ(chunkIn.lifetime, chunkOut.lifetime);
+  CHECK_EQ(chunkIn.priority, chunkOut.priority);
   CHECK_EQ(dataBlockIn.metaDataLen, dataBlockOut.metaDataLen);
   CHECK_EQ(dataBlockIn.authTagLen, dataBlockOut.authTagLen);
   CHECK_EQ(dataBlockIn.cipherDataLen, dataBlockOut.cipherDataLen);
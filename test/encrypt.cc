@@ -0,0 +1,164 @@
+#include <deque>
+#include <doctest/doctest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../src/encode.hh"
+#include "../src/encryptPipe.hh"
+#include "quicr/packet.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+
+// loops whatever EncryptPipe sends back up to it
+class LoopbackPipe : public PipeInterface
+{
+public:
+  LoopbackPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    ClientData clientData;
+    packet >> clientData;
+    sent = std::move(packet);
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override { return std::move(sent); }
+
+  std::unique_ptr<Packet> sent;
+};
+
+static std::unique_ptr<Packet>
+makePacket(size_t size)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->reserve(size + sframe::max_overhead + 20);
+  packet << Packet::Header(PacketTag::headerData);
+
+  std::vector<uint8_t> payload(size);
+  for (size_t i = 0; i < size; i++) {
+    payload[i] = uint8_t(i * 7);
+  }
+  packet->push_back(payload);
+
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = ShortName::fromString("qr://1234/12/");
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  DataBlock dataBlock;
+  dataBlock.metaDataLen = toVarInt(0);
+  dataBlock.dataLen = toVarInt(size);
+  ClientData clientData;
+  clientData.clientSeqNum = 1;
+
+  packet << dataBlock;
+  packet << namedDataChunk;
+  packet << clientData;
+  return packet;
+}
+
+TEST_CASE("EncryptPipe encrypts and decrypts within the packet buffer")
+{
+  constexpr size_t size = 1000;
+  auto loopback = new LoopbackPipe();
+  EncryptPipe encryptPipe(loopback);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+
+  auto packet = makePacket(size);
+  uint8_t* bufferBefore = &packet->fullData();
+  encryptPipe.send(std::move(packet));
+
+  REQUIRE(loopback->sent);
+  // the ciphertext fit the reserved capacity, no new buffer
+  CHECK_EQ(&loopback->sent->fullData(), bufferBefore);
+
+  auto decrypted = encryptPipe.recv();
+  REQUIRE(decrypted);
+  CHECK_EQ(&decrypted->fullData(), bufferBefore);
+
+  NamedDataChunk namedDataChunk;
+  DataBlock dataBlock;
+  REQUIRE(decrypted >> namedDataChunk);
+  REQUIRE(decrypted >> dataBlock);
+  REQUIRE_EQ(fromVarInt(dataBlock.dataLen), size);
+  REQUIRE_EQ(decrypted->size(), size);
+
+  const uint8_t* data = &decrypted->data();
+  bool same = true;
+  for (size_t i = 0; i < size; i++) {
+    same &= (data[i] == uint8_t(i * 7));
+  }
+  CHECK(same);
+}
+
+// like LoopbackPipe but keeps everything, sends come from crypto workers
+class QueueLoopbackPipe : public PipeInterface
+{
+public:
+  QueueLoopbackPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    ClientData clientData;
+    packet >> clientData;
+    std::lock_guard<std::mutex> lock(mutex);
+    sent.push_back(std::move(packet));
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sent.empty()) {
+      return nullptr;
+    }
+    auto packet = std::move(sent.front());
+    sent.pop_front();
+    return packet;
+  }
+
+  std::mutex mutex;
+  std::deque<std::unique_ptr<Packet>> sent;
+};
+
+TEST_CASE("EncryptPipe with crypto threads keeps packet order")
+{
+  const size_t num = 300;
+  auto loopback = new QueueLoopbackPipe();
+  EncryptPipe encryptPipe(loopback);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+  encryptPipe.setCryptoThreads(4);
+
+  // payload size tells the packets apart
+  for (size_t i = 0; i < num; i++) {
+    encryptPipe.send(makePacket(200 + i));
+  }
+
+  std::vector<size_t> sizes;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sizes.size() < num && std::chrono::steady_clock::now() < deadline) {
+    auto packet = encryptPipe.recv();
+    if (!packet) {
+      std::this_thread::yield();
+      continue;
+    }
+    NamedDataChunk namedDataChunk;
+    DataBlock dataBlock;
+    REQUIRE(packet >> namedDataChunk);
+    REQUIRE(packet >> dataBlock);
+    sizes.push_back(fromVarInt(dataBlock.dataLen));
+  }
+
+  REQUIRE_EQ(sizes.size(), num);
+  bool ordered = true;
+  for (size_t i = 0; i < num; i++) {
+    ordered &= (sizes[i] == 200 + i);
+  }
+  CHECK(ordered);
+}
@@ -0,0 +1,39 @@
+#include <arpa/inet.h>
+#include <doctest/doctest.h>
+
+#include "../cmd/relay/include/multimap_fib.hh"
+
+using namespace MediaNet;
+
+static SubscriberInfo
+subscriber(const ShortName& name, uint32_t host)
+{
+  SubscriberInfo info{};
+  info.name = name;
+  info.face.addr.sin_family = AF_INET;
+  info.face.addr.sin_addr.s_addr = htonl(host);
+  info.face.addr.sin_port = htons(5000);
+  info.face.addrLen = sizeof(info.face.addr);
+  return info;
+}
+
+TEST_CASE("MultimapFib keeps every subscriber of a name")
+{
+  MultimapFib fib;
+  ShortName name(1, 2);
+  auto first = subscriber(name, 0x0a000001);
+  auto second = subscriber(name, 0x0a000002);
+
+  fib.addSubscription(name, first);
+  fib.addSubscription(name, second);
+  CHECK_EQ(fib.lookupSubscription(ShortName(1, 2, 3)).size(), 2);
+
+  // subscribing again does not add a second entry for the face
+  fib.addSubscription(name, first);
+  CHECK_EQ(fib.lookupSubscription(ShortName(1, 2, 3)).size(), 2);
+
+  fib.removeSubscription(name, first);
+  auto left = fib.lookupSubscription(ShortName(1, 2, 3));
+  REQUIRE_EQ(left.size(), 1);
+  CHECK_EQ(IpAddr::toString(left.front().face), IpAddr::toString(second.face));
+}
@@ -1,6 +1,8 @@
 
 #include "../src/encode.hh"
+#include "../src/encryptPipe.hh"
 #include "../src/fragmentPipe.hh"
+#include "quicr/metrics.hh"
 #include "quicr/packet.hh"
 #include "quicr/quicRClient.hh"
 #include "quicr/shortName.hh"
@@ -28,6 +30,17 @@ public:
     return true;
   }
 
+  // hands back what was sent, in order
+  std::unique_ptr<Packet> recv() override
+  {
+    if (fragmented_packets.empty()) {
+      return std::unique_ptr<Packet>(nullptr);
+    }
+    auto packet = std::move(fragmented_packets.front());
+    fragmented_packets.pop_front();
+    return packet;
+  }
+
   ShortName name;
   std::deque<std::unique_ptr<Packet>> fragmented_packets;
   int upstreamCount = 0;
@@ -53,6 +66,7 @@ generate_large_packet(int size)
   NamedDataChunk namedDataChunk;
   namedDataChunk.shortName = packet->shortName();
   namedDataChunk.lifetime = toVarInt(0); // TODO
+  namedDataChunk.priority = packet->getPriority();
 
   DataBlock dataBlock;
   dataBlock.metaDataLen = toVarInt(0);
@@ -89,3 +103,214 @@ TEST_CASE("verify fragmentation and re-assembly")
     }
   }
 }
+
+TEST_CASE("fragments carry their own slice of the object")
+{
+  auto fake_pipe = new FakePipe(nullptr);
+  constexpr int payload_size = 5000;
+  auto fragment_pipe = std::make_unique<FragmentPipe>(fake_pipe);
+
+  auto packet = generate_large_packet(payload_size);
+  uint8_t* data = &packet->fullData() + QUICR_HEADER_SIZE_BYTES;
+  for (int i = 0; i < payload_size; i++) {
+    data[i] = uint8_t(i * 13);
+  }
+  fragment_pipe->send(std::move(packet));
+  REQUIRE_GE(fake_pipe->upstreamCount, 4);
+
+  // each fragment is only its slice plus the headers
+  std::vector<uint8_t> joined;
+  for (auto& frag : fake_pipe->fragmented_packets) {
+    CHECK_LE(frag->fullSize(), 1280);
+    NamedDataChunk namedDataChunk;
+    DataBlock block;
+    REQUIRE(frag >> namedDataChunk);
+    REQUIRE(frag >> block);
+    size_t len = fromVarInt(block.dataLen);
+    REQUIRE_EQ(frag->fullSize(), QUICR_HEADER_SIZE_BYTES + len);
+    const uint8_t* fragData = &frag->fullData() + QUICR_HEADER_SIZE_BYTES;
+    joined.insert(joined.end(), fragData, fragData + len);
+  }
+
+  REQUIRE_EQ(joined.size(), payload_size);
+  bool same = true;
+  for (int i = 0; i < payload_size; i++) {
+    same &= (joined[i] == uint8_t(i * 13));
+  }
+  CHECK(same);
+}
+
+static std::deque<std::unique_ptr<Packet>>
+fragment(FragmentPipe& fragment_pipe, FakePipe& fake_pipe, int size)
+{
+  auto packet = generate_large_packet(size);
+  uint8_t* data = &packet->fullData() + QUICR_HEADER_SIZE_BYTES;
+  for (int i = 0; i < size; i++) {
+    data[i] = uint8_t(i * 7);
+  }
+  fragment_pipe.send(std::move(packet));
+  return std::move(fake_pipe.fragmented_packets);
+}
+
+TEST_CASE("re-assembly takes fragments in any order and drops duplicates")
+{
+  auto fake_pipe = new FakePipe(nullptr);
+  constexpr int payload_size = 8000;
+  FragmentPipe fragment_pipe(fake_pipe);
+  auto frags = fragment(fragment_pipe, *fake_pipe, payload_size);
+  REQUIRE_GE(frags.size(), 4);
+
+  // last fragment first, then a duplicate, then the rest backwards
+  auto duplicate = frags.back()->clone();
+  std::unique_ptr<Packet> result;
+  for (auto it = frags.rbegin(); it != frags.rend(); ++it) {
+    CHECK_FALSE(result);
+    result = fragment_pipe.processRxPacket(std::move(*it));
+    if (it == frags.rbegin()) {
+      CHECK_FALSE(fragment_pipe.processRxPacket(std::move(duplicate)));
+    }
+  }
+
+  REQUIRE(result);
+  CHECK_EQ(fragment_pipe.pendingObjects(), 0);
+  NamedDataChunk namedDataChunk;
+  DataBlock block;
+  REQUIRE(result >> namedDataChunk);
+  REQUIRE(result >> block);
+  CHECK_EQ(namedDataChunk.shortName.fragmentID, 0);
+  REQUIRE_EQ(fromVarInt(block.dataLen), payload_size);
+  REQUIRE_EQ(result->size(), payload_size);
+
+  const uint8_t* data = &result->data();
+  bool same = true;
+  for (int i = 0; i < payload_size; i++) {
+    same &= (data[i] == uint8_t(i * 7));
+  }
+  CHECK(same);
+}
+
+TEST_CASE("re-assembly evicts objects that miss their deadline")
+{
+  auto fake_pipe = new FakePipe(nullptr);
+  FragmentPipe fragment_pipe(fake_pipe);
+  auto frags = fragment(fragment_pipe, *fake_pipe, 6000);
+  REQUIRE_GE(frags.size(), 3);
+
+  CHECK_FALSE(fragment_pipe.processRxPacket(std::move(frags[0])));
+  CHECK_FALSE(fragment_pipe.processRxPacket(std::move(frags[1])));
+  CHECK_EQ(fragment_pipe.pendingObjects(), 1);
+
+  auto now = std::chrono::steady_clock::now();
+  fragment_pipe.runUpdates(now + FragmentPipe::defaultLifetime / 2);
+  CHECK_EQ(fragment_pipe.pendingObjects(), 1);
+  fragment_pipe.runUpdates(now + FragmentPipe::defaultLifetime +
+                           std::chrono::milliseconds(200));
+  CHECK_EQ(fragment_pipe.pendingObjects(), 0);
+
+  // the rest can no longer complete the object
+  std::unique_ptr<Packet> result;
+  for (size_t i = 2; i < frags.size(); i++) {
+    result = fragment_pipe.processRxPacket(std::move(frags[i]));
+  }
+  CHECK_FALSE(result);
+}
+
+TEST_CASE("re-assembly drops fragment ids past the bitmap")
+{
+  auto fake_pipe = new FakePipe(nullptr);
+  FragmentPipe fragment_pipe(fake_pipe);
+  auto frags = fragment(fragment_pipe, *fake_pipe, 6000);
+  REQUIRE_GE(frags.size(), 2);
+
+  // index 127 and last, as a peer could send it
+  auto packet = std::move(frags[0]);
+  NamedDataChunk namedDataChunk;
+  REQUIRE(packet >> namedDataChunk);
+  namedDataChunk.shortName.fragmentID = 255;
+  packet << namedDataChunk;
+
+  CHECK_FALSE(fragment_pipe.processRxPacket(std::move(packet)));
+  CHECK_EQ(fragment_pipe.pendingObjects(), 0);
+}
+
+class BatchSinkPipe : public PipeInterface
+{
+public:
+  BatchSinkPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool sendBatch(Batch& packets) override
+  {
+    batches++;
+    for (auto& packet : packets) {
+      received.push_back(std::move(packet));
+    }
+    packets.clear();
+    return true;
+  }
+
+  int batches = 0;
+  std::vector<std::unique_ptr<Packet>> received;
+};
+
+TEST_CASE("sendBatch hands all fragments of a batch down in one call")
+{
+  auto sink = new BatchSinkPipe();
+  FragmentPipe fragmentPipe(sink);
+
+  PipeInterface::Batch batch;
+  batch.push_back(generate_large_packet(12000));
+  batch.push_back(generate_large_packet(100));
+  batch.push_back(generate_large_packet(5000));
+  CHECK(fragmentPipe.sendBatch(batch));
+  CHECK(batch.empty());
+
+  CHECK_EQ(sink->batches, 1);
+  // the small one is not fragmented and keeps its place
+  REQUIRE_GE(sink->received.size(), 14);
+  size_t numFirst = 0;
+  while (sink->received[numFirst]->shortName().fragmentID != 0) {
+    numFirst++;
+  }
+  CHECK_GE(numFirst, 10);
+  CHECK_LT(numFirst + 1, sink->received.size());
+}
+
+TEST_CASE("a damaged fragment fails its object's decrypt after re-assembly")
+{
+  auto fake = new FakePipe(nullptr);
+  auto fragmentPipe = new FragmentPipe(fake);
+  EncryptPipe encryptPipe(fragmentPipe);
+  encryptPipe.setCryptoKey(1, sframe::bytes(32, 0x42));
+  MetricsRegistry registry;
+  encryptPipe.registerMetrics(registry, "");
+
+  auto receiveAll = [&encryptPipe, fake]() {
+    int objects = 0;
+    while (!fake->fragmented_packets.empty()) {
+      if (encryptPipe.recv()) {
+        objects++;
+      }
+    }
+    return objects;
+  };
+
+  CHECK(encryptPipe.send(generate_large_packet(5000)));
+  REQUIRE_GT(fake->fragmented_packets.size(), 1);
+  CHECK_EQ(receiveAll(), 1);
+
+  // the sealed object covers every fragment, a byte of the last one here
+  CHECK(encryptPipe.send(generate_large_packet(5000)));
+  auto& last = fake->fragmented_packets.back();
+  NamedDataChunk namedDataChunk;
+  EncryptedDataBlock encryptedDataBlock;
+  REQUIRE(last >> namedDataChunk);
+  REQUIRE(last >> encryptedDataBlock);
+  (&last->data())[last->size() - 1] ^= 1;
+  last << encryptedDataBlock;
+  last << namedDataChunk;
+  CHECK_EQ(receiveAll(), 0);
+  CHECK_EQ(fragmentPipe->pendingObjects(), 0);
+  CHECK_EQ(registry.counter("quicr_crypto_failures_total", "").value(), 1);
+}
@@ -0,0 +1,304 @@
+#include <doctest/doctest.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/impairmentPipe.hh"
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/quicRServer.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+// keeps what is sent, hands out what the test queued for recv
+class SinkPipe : public PipeInterface
+{
+public:
+  SinkPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    sent.push_back(std::move(packet));
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override
+  {
+    if (toRecv.empty()) {
+      return std::unique_ptr<Packet>(nullptr);
+    }
+    auto packet = std::move(toRecv.front());
+    toRecv.pop_front();
+    return packet;
+  }
+
+  std::vector<std::unique_ptr<Packet>> sent;
+  std::deque<std::unique_ptr<Packet>> toRecv;
+};
+
+static std::unique_ptr<Packet>
+makePacket(uint8_t first, size_t size = 100)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->resizeFull(int(size));
+  packet->fullData() = first;
+  return packet;
+}
+
+// which of count packets sent through config arrive
+static std::vector<bool>
+survivors(const ImpairmentConfig& config, int count)
+{
+  auto sink = new SinkPipe(); // owned by the pipe
+  ImpairmentPipe pipe(sink, config, ImpairmentConfig());
+  for (int i = 0; i < count; i++) {
+    auto packet = makePacket(uint8_t(i));
+    (&packet->fullData())[1] = uint8_t(i >> 8);
+    pipe.send(std::move(packet));
+  }
+  pipe.runUpdates(std::chrono::steady_clock::now() + 1s);
+
+  std::vector<bool> arrived(count, false);
+  for (auto& packet : sink->sent) {
+    auto* data = &packet->fullData();
+    arrived[data[0] | data[1] << 8] = true;
+  }
+  return arrived;
+}
+
+TEST_CASE("ImpairmentPipe passes everything when not configured")
+{
+  auto sink = new SinkPipe();
+  ImpairmentPipe pipe(sink, ImpairmentConfig(), ImpairmentConfig());
+  CHECK_FALSE(pipe.active());
+
+  CHECK(pipe.send(makePacket(1)));
+  REQUIRE_EQ(sink->sent.size(), 1);
+  sink->toRecv.push_back(makePacket(2));
+  auto packet = pipe.recv();
+  REQUIRE(packet);
+  CHECK_EQ(packet->fullData(), 2);
+}
+
+TEST_CASE("ImpairmentPipe delays, reorders and duplicates")
+{
+  ImpairmentConfig delayed;
+  delayed.delayMs = 20;
+  delayed.jitterMs = 5;
+  auto sink = new SinkPipe();
+  ImpairmentPipe pipe(sink, delayed, delayed);
+  CHECK(pipe.active());
+
+  auto start = std::chrono::steady_clock::now();
+  pipe.send(makePacket(1));
+  CHECK(sink->sent.empty());
+  pipe.runUpdates(start + 19ms);
+  CHECK(sink->sent.empty());
+  pipe.runUpdates(start + 30ms);
+  CHECK_EQ(sink->sent.size(), 1);
+
+  // received ones come out of recv() once due
+  sink->toRecv.push_back(makePacket(2));
+  CHECK_FALSE(pipe.recv());
+  CHECK(sink->toRecv.empty());
+
+  ImpairmentConfig shuffled;
+  shuffled.reorderPerMillion = 1000000;
+  shuffled.reorderMs = 30;
+  shuffled.duplicatePerMillion = 1000000;
+  sink = new SinkPipe();
+  ImpairmentPipe other(sink, shuffled, ImpairmentConfig());
+  start = std::chrono::steady_clock::now();
+  other.send(makePacket(1));
+  other.runUpdates(start + 40ms);
+  REQUIRE_EQ(sink->sent.size(), 2);
+  CHECK_EQ(sink->sent[0]->fullData(), 1);
+  CHECK_EQ(sink->sent[1]->fullData(), 1);
+}
+
+TEST_CASE("ImpairmentPipe loses packets in bursts, the same each run")
+{
+  ImpairmentConfig bursty;
+  bursty.goodToBadPerMillion = 100000;
+  bursty.badToGoodPerMillion = 300000;
+  bursty.seed = 7;
+
+  auto arrived = survivors(bursty, 10000);
+  CHECK(arrived == survivors(bursty, 10000));
+
+  int lost = 0;
+  int bursts = 0;
+  for (size_t i = 0; i < arrived.size(); i++) {
+    if (!arrived[i]) {
+      lost++;
+      if (i == 0 || arrived[i - 1]) {
+        bursts++;
+      }
+    }
+  }
+
+  // a quarter of the time in the bad state, bursts of 1 / 0.3 packets
+  CHECK_GT(lost, 2200);
+  CHECK_LT(lost, 2800);
+  REQUIRE_GT(bursts, 0);
+  CHECK_GT(double(lost) / bursts, 3.0);
+  CHECK_LT(double(lost) / bursts, 3.7);
+
+  bursty.seed = 8;
+  CHECK(arrived != survivors(bursty, 10000));
+}
+
+TEST_CASE("ImpairmentPipe paces to the bitrate and drops past the queue")
+{
+  ImpairmentConfig capped;
+  capped.bitrateBps = 8000000; // 1 ms a 1000 byte packet
+  capped.queueBytes = 5000;
+
+  auto sink = new SinkPipe();
+  ImpairmentPipe pipe(sink, capped, ImpairmentConfig());
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 10; i++) {
+    pipe.send(makePacket(uint8_t(i), 1000));
+  }
+
+  pipe.runUpdates(start + 2500us);
+  CHECK_LE(sink->sent.size(), 3);
+
+  // the queue took about 5, the rest were dropped
+  pipe.runUpdates(start + 100ms);
+  CHECK_GE(sink->sent.size(), 5);
+  CHECK_LE(sink->sent.size(), 6);
+  for (size_t i = 0; i < sink->sent.size(); i++) {
+    CHECK_EQ(sink->sent[i]->fullData(), i);
+  }
+}
+
+TEST_CASE("ImpairmentPipe receives every due packet, not one a call")
+{
+  ImpairmentConfig lossy;
+  lossy.lossGoodPerMillion = 500000;
+  lossy.seed = 3;
+
+  // the same draws either way, so the send side says which survive
+  auto arrived = survivors(lossy, 20);
+  auto expected = std::count(arrived.begin(), arrived.end(), true);
+  REQUIRE_GT(expected, 0);
+  REQUIRE_LT(expected, 20);
+
+  auto sink = new SinkPipe();
+  ImpairmentPipe pipe(sink, ImpairmentConfig(), lossy);
+  for (int i = 0; i < 20; i++) {
+    sink->toRecv.push_back(makePacket(uint8_t(i)));
+  }
+
+  // read until empty, as the server does, past the lost ones
+  long received = 0;
+  while (auto packet = pipe.recv()) {
+    CHECK(arrived[packet->fullData()]);
+    received++;
+  }
+  CHECK_EQ(received, expected);
+  CHECK(sink->toRecv.empty());
+}
+
+TEST_CASE("ImpairmentPipe sends on in order from the timer and sending threads")
+{
+  ImpairmentConfig delayed;
+  delayed.delayMs = 1;
+  auto sink = new SinkPipe();
+  ImpairmentPipe pipe(sink, delayed, ImpairmentConfig());
+
+  std::atomic<bool> done(false);
+  std::thread timer([&]() {
+    while (!done) {
+      pipe.runUpdates(std::chrono::steady_clock::now());
+    }
+  });
+  for (int i = 0; i < 2000; i++) {
+    auto packet = makePacket(uint8_t(i));
+    (&packet->fullData())[1] = uint8_t(i >> 8);
+    pipe.send(std::move(packet));
+  }
+  done = true;
+  timer.join();
+  pipe.runUpdates(std::chrono::steady_clock::now() + 1s);
+
+  REQUIRE_EQ(sink->sent.size(), 2000);
+  bool inOrder = true;
+  for (size_t i = 0; i < sink->sent.size(); i++) {
+    auto* data = &sink->sent[i]->fullData();
+    inOrder &= size_t(data[0] | data[1] << 8) == i;
+  }
+  CHECK(inOrder);
+
+  // turned off with packets held, they still go on
+  pipe.send(makePacket(1));
+  pipe.setImpairment(ImpairmentConfig(), ImpairmentConfig());
+  CHECK(pipe.active());
+  pipe.runUpdates(std::chrono::steady_clock::now() + 1s);
+  CHECK_EQ(sink->sent.size(), 2001);
+  CHECK_FALSE(pipe.active());
+}
+
+TEST_CASE("QuicRClient and QuicRServer connect through impaired chains")
+{
+  ImpairmentConfig slow;
+  slow.delayMs = 15;
+  slow.jitterMs = 5;
+
+  LoopbackNetwork network;
+  QuicRServer server(network);
+  server.setImpairment(slow, slow);
+  REQUIRE(server.open(5004));
+
+  std::atomic<bool> done(false);
+  std::atomic<int> received(0);
+  std::thread relay([&]() {
+    while (!done) {
+      auto packet = server.recv(10ms);
+      if (packet && nextTag(packet) == PacketTag::clientData) {
+        received++;
+      }
+    }
+  });
+
+  ClientConfig config;
+  config.impairUp = slow;
+  config.impairDown = slow;
+  QuicRClient client(config, network);
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  REQUIRE(client.open(1, "loopback", 5004, 1));
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!client.ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  CHECK(client.ready());
+
+  auto name = ShortName::fromString("qr://1234/12/");
+  name.mediaTime = 1;
+  auto packet = client.createPacket(name, 100);
+  packet->push_back(std::vector<uint8_t>(100, 1));
+  packet->setPriority(3);
+  packet->setReliable(false);
+  auto sent = std::chrono::steady_clock::now();
+  CHECK(client.publish(std::move(packet)));
+
+  deadline = sent + 5s;
+  while (received == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  CHECK_GT(received, 0);
+  // held on the client's way up and the server's way in
+  CHECK_GE(std::chrono::steady_clock::now() - sent, 30ms);
+
+  done = true;
+  relay.join();
+}
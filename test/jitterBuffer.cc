@@ -0,0 +1,190 @@
+#include <deque>
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/jitterBufferPipe.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+// hands out whatever the test queued
+class FeedPipe : public PipeInterface
+{
+public:
+  FeedPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  std::unique_ptr<Packet> recv() override
+  {
+    if (queue.empty()) {
+      return nullptr;
+    }
+    auto packet = std::move(queue.front());
+    queue.pop_front();
+    return packet;
+  }
+
+  std::deque<std::unique_ptr<Packet>> queue;
+};
+
+static std::unique_ptr<Packet>
+makeObject(QuicRClient& client, uint32_t sourceID, uint32_t mediaTime)
+{
+  auto name = ShortName::fromString("qr://1234/12/");
+  name.sourceID = sourceID;
+  name.mediaTime = mediaTime;
+  auto packet = client.createPacket(name, 10);
+  packet->push_back(uint8_t(mediaTime));
+
+  NamedDataChunk namedDataChunk;
+  namedDataChunk.shortName = name;
+  namedDataChunk.lifetime = toVarInt(0);
+  namedDataChunk.priority = 3;
+  packet << namedDataChunk;
+  return packet;
+}
+
+TEST_CASE("JitterBufferPipe passes through when disabled")
+{
+  QuicRClient client;
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+
+  feed->queue.push_back(makeObject(client, 1, 40));
+  feed->queue.push_back(makeObject(client, 1, 20));
+  auto packet = jitterBuffer.recv();
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 40);
+}
+
+TEST_CASE("JitterBufferPipe releases in mediaTime order at playout time")
+{
+  QuicRClient client;
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+  jitterBuffer.setDepth(50, 200);
+  CHECK_EQ(jitterBuffer.depthMs(), 50);
+
+  auto start = std::chrono::steady_clock::now();
+
+  // 20 ms objects, 20 is lost
+  feed->queue.push_back(makeObject(client, 1, 0));
+  CHECK_FALSE(jitterBuffer.recv(start));
+  feed->queue.push_back(makeObject(client, 1, 40));
+  CHECK_FALSE(jitterBuffer.recv(start + 45ms));
+
+  auto packet = jitterBuffer.recv(start + 50ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 0);
+  CHECK_FALSE(jitterBuffer.recv(start + 50ms));
+
+  // 20 never came, 40 plays at its own time
+  feed->queue.push_back(makeObject(client, 1, 60));
+  CHECK_FALSE(jitterBuffer.recv(start + 89ms));
+  packet = jitterBuffer.recv(start + 90ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 40);
+
+  // 20 showing up now is too late
+  feed->queue.push_back(makeObject(client, 1, 20));
+  packet = jitterBuffer.recv(start + 110ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 60);
+  CHECK_EQ(jitterBuffer.lateCount(), 1);
+  CHECK_FALSE(jitterBuffer.recv(start + 500ms));
+}
+
+TEST_CASE("JitterBufferPipe keeps streams apart and tracks the fastest path")
+{
+  QuicRClient client;
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+  jitterBuffer.setDepth(30, 30);
+
+  auto start = std::chrono::steady_clock::now();
+  feed->queue.push_back(makeObject(client, 1, 1000));
+  feed->queue.push_back(makeObject(client, 2, 5000));
+  CHECK_FALSE(jitterBuffer.recv(start));
+
+  // 1020 came 10 ms sooner than 1000 said it would, so 1000 was late
+  // itself and the base moves up
+  feed->queue.push_back(makeObject(client, 1, 1020));
+  CHECK_FALSE(jitterBuffer.recv(start + 10ms));
+  auto packet = jitterBuffer.recv(start + 20ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 1000);
+
+  packet = jitterBuffer.recv(start + 30ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 5000);
+  CHECK_EQ(packet->shortName().sourceID, 2);
+
+  packet = jitterBuffer.recv(start + 40ms);
+  REQUIRE(packet);
+  CHECK_EQ(packet->shortName().mediaTime, 1020);
+}
+
+TEST_CASE("JitterBufferPipe depth follows the downstream jitter")
+{
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+  jitterBuffer.setDepth(20, 100);
+
+  jitterBuffer.updateStat(PipeInterface::StatName::jitterDownMs, 15);
+  CHECK_EQ(jitterBuffer.depthMs(), 30);
+  jitterBuffer.updateStat(PipeInterface::StatName::jitterDownMs, 500);
+  CHECK_EQ(jitterBuffer.depthMs(), 100);
+  jitterBuffer.updateStat(PipeInterface::StatName::jitterDownMs, 0);
+  CHECK_EQ(jitterBuffer.depthMs(), 20);
+}
+
+TEST_CASE("JitterBufferPipe keeps mediaTime order across the wrap")
+{
+  QuicRClient client;
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+  jitterBuffer.setDepth(50, 50);
+
+  auto start = std::chrono::steady_clock::now();
+  feed->queue.push_back(makeObject(client, 1, UINT32_MAX - 19));
+  feed->queue.push_back(makeObject(client, 1, 20));
+  feed->queue.push_back(makeObject(client, 1, 0));
+  CHECK_FALSE(jitterBuffer.recv(start));
+
+  std::vector<uint32_t> order;
+  while (auto packet = jitterBuffer.recv(start + 200ms)) {
+    order.push_back(packet->shortName().mediaTime);
+  }
+  std::vector<uint32_t> expected{ UINT32_MAX - 19, 0, 20 };
+  CHECK_EQ(order, expected);
+  CHECK_EQ(jitterBuffer.lateCount(), 0);
+}
+
+TEST_CASE("JitterBufferPipe forgets streams that went idle")
+{
+  QuicRClient client;
+  auto feed = new FeedPipe();
+  JitterBufferPipe jitterBuffer(feed);
+  jitterBuffer.setDepth(10, 10);
+
+  auto start = std::chrono::steady_clock::now();
+  feed->queue.push_back(makeObject(client, 1, 0));
+  feed->queue.push_back(makeObject(client, 2, 0));
+  CHECK_FALSE(jitterBuffer.recv(start));
+  CHECK(jitterBuffer.recv(start + 20ms));
+  CHECK(jitterBuffer.recv(start + 20ms));
+  CHECK_EQ(jitterBuffer.streamCount(), 2);
+
+  // only source 2 keeps sending
+  feed->queue.push_back(makeObject(client, 2, 9000));
+  CHECK(jitterBuffer.recv(start + 9s + 20ms));
+  CHECK_FALSE(jitterBuffer.recv(start +
+                                JitterBufferPipe::streamIdleTimeout + 2s));
+  CHECK_EQ(jitterBuffer.streamCount(), 1);
+}
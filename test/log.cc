@@ -0,0 +1,110 @@
+#include <doctest/doctest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "quicr/log.hh"
+#include "quicr/shortName.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+static size_t
+countLines(const std::string& text, const std::string& with)
+{
+  size_t count = 0;
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    count += line.find(with) != std::string::npos;
+  }
+  return count;
+}
+
+TEST_CASE("Logger formats captured arguments on the drain side")
+{
+  Logger logger;
+  std::ostringstream out;
+  logger.setSink(&out);
+  logger.setLevel(LogLevel::trace); // whatever level was compiled in
+
+  static LogSite site(LogLevel::warn, "some/dir/file.cc", 42, 0);
+  std::string text = "lost";
+  uint8_t small = 7;
+  logger.log(site,
+             "{} has {} subscribers, {} {} {}",
+             ShortName(1, 2, 3),
+             size_t(12),
+             text,
+             small,
+             "end");
+  text = "changed after the call";
+  logger.flush();
+
+  CHECK_NE(out.str().find(" W file.cc:42 "), std::string::npos);
+  CHECK_NE(
+    out.str().find("qr:./r1/c2/s3/0 has 12 subscribers, lost 7 end\n"),
+    std::string::npos);
+
+  // below the run time level
+  static LogSite debugSite(LogLevel::debug, "file.cc", 43, 0);
+  logger.setLevel(LogLevel::info);
+  logger.log(debugSite, "hidden");
+  logger.flush();
+  CHECK_EQ(out.str().find("hidden"), std::string::npos);
+
+  // arguments that do not fit are cut short
+  out.str("");
+  logger.log(site, "{} {}", std::string(1000, 'x'), 5);
+  logger.flush();
+  CHECK_EQ(countLines(out.str(), "xxxx"), 1);
+  CHECK_NE(out.str().find("xxx {} ...\n"), std::string::npos);
+}
+
+TEST_CASE("Logger limits each site and says how many it held back")
+{
+  Logger logger;
+  std::ostringstream out;
+  logger.setSink(&out);
+  logger.setLevel(LogLevel::trace); // whatever level was compiled in
+
+  static LogSite site(LogLevel::info, "file.cc", 1, 3);
+  for (int i = 0; i < 1000; i++) {
+    logger.log(site, "flood {}", i);
+  }
+  logger.flush();
+  size_t first = countLines(out.str(), "flood");
+  CHECK_GE(first, 3);
+  CHECK_LE(first, 6); // the loop may straddle a second
+
+  std::this_thread::sleep_for(1100ms);
+  logger.log(site, "flood {}", 1000);
+  logger.flush();
+  CHECK_EQ(countLines(out.str(), "flood"), first + 1);
+  CHECK_NE(out.str().find("more not logged)"), std::string::npos);
+}
+
+TEST_CASE("Logger keeps every message from concurrent threads")
+{
+  Logger logger;
+  std::ostringstream out;
+  logger.setSink(&out);
+  logger.setLevel(LogLevel::trace); // whatever level was compiled in
+
+  static LogSite site(LogLevel::info, "file.cc", 1, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&logger, t]() {
+      for (int i = 0; i < 500; i++) {
+        logger.log(site, "thread {} message {}", t, i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  logger.flush();
+
+  CHECK_EQ(countLines(out.str(), " message ") + logger.droppedCount(), 2000);
+}
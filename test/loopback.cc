@@ -0,0 +1,215 @@
+#include <doctest/doctest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/encode.hh"
+#include "../src/loopbackPipe.hh"
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/quicRServer.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+static std::unique_ptr<Packet>
+makePacket(uint8_t first, size_t size = 100)
+{
+  auto packet = std::make_unique<Packet>();
+  packet->resizeFull(int(size));
+  packet->fullData() = first;
+  return packet;
+}
+
+TEST_CASE("LoopbackPipe carries packets between a client and a server")
+{
+  LoopbackNetwork network;
+  LoopbackPipe server(network);
+  LoopbackPipe client(network);
+  REQUIRE(server.start(5004, "", nullptr));
+  REQUIRE(client.start(5004, "localhost", nullptr));
+
+  // a second server can not have the port
+  LoopbackPipe other(network);
+  CHECK_FALSE(other.start(5004, "", nullptr));
+
+  CHECK(client.send(makePacket(7)));
+  REQUIRE(server.waitReadable(100ms));
+  auto up = server.recv();
+  REQUIRE(up);
+  CHECK_EQ(up->fullData(), 7);
+  CHECK_EQ(up->getSrc().addr.sin_port, htons(49152));
+
+  // answered at the address it came from
+  auto down = makePacket(9);
+  down->setDst(up->getSrc());
+  CHECK(server.send(std::move(down)));
+  auto back = client.recv();
+  REQUIRE(back);
+  CHECK_EQ(back->fullData(), 9);
+  CHECK_FALSE(client.recv());
+
+  // gone once stopped
+  client.stop();
+  down = makePacket(10);
+  down->setDst(up->getSrc());
+  server.send(std::move(down));
+  CHECK_FALSE(server.waitReadable(10ms));
+}
+
+TEST_CASE("LoopbackPipe delays, paces and drops as configured")
+{
+  LoopbackNetwork::LinkConfig link;
+  link.delayMs = 20;
+  link.bitrateBps = 8000000; // 1 ms a 1000 byte packet
+  link.queueMs = 5;
+  LoopbackNetwork network(link);
+
+  LoopbackPipe server(network);
+  LoopbackPipe client(network);
+  REQUIRE(server.start(5004, "", nullptr));
+  REQUIRE(client.start(5004, "localhost", nullptr));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 10; i++) {
+    client.send(makePacket(uint8_t(i), 1000));
+  }
+  auto sent = std::chrono::steady_clock::now();
+  CHECK_FALSE(server.recv());
+
+  // 5 ms of queue holds about 6, the rest are dropped. The link drains on
+  // the real clock, so one more fits for each ms the sends were held up.
+  auto heldUp = int((sent - start) / 1ms);
+  int received = 0;
+  while (server.waitReadable(100ms)) {
+    auto packet = server.recv();
+    REQUIRE(packet);
+    CHECK_EQ(packet->fullData(), received);
+    received++;
+  }
+  CHECK_GE(received, 5);
+  CHECK_LE(received, 7 + heldUp);
+  CHECK_GE(std::chrono::steady_clock::now() - start, 25ms);
+
+  LoopbackNetwork::LinkConfig lossy;
+  lossy.lossPerMillion = 250000;
+  LoopbackNetwork lossyNetwork(lossy);
+  LoopbackPipe lossyServer(lossyNetwork);
+  LoopbackPipe lossyClient(lossyNetwork);
+  REQUIRE(lossyServer.start(5004, "", nullptr));
+  REQUIRE(lossyClient.start(5004, "localhost", nullptr));
+  for (int i = 0; i < 1000; i++) {
+    lossyClient.send(makePacket(1));
+  }
+  received = 0;
+  while (lossyServer.recv()) {
+    received++;
+  }
+  CHECK_GT(received, 700);
+  CHECK_LT(received, 800);
+}
+
+TEST_CASE("QuicRClient publishes to a QuicRServer over a LoopbackNetwork")
+{
+  LoopbackNetwork network;
+  QuicRServer server(network);
+  REQUIRE(server.open(5004));
+
+  auto name = ShortName::fromString("qr://1234/12/");
+  name.mediaTime = 1;
+
+  std::atomic<bool> done(false);
+  std::atomic<bool> published(false);
+  std::thread relay([&]() {
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!done && std::chrono::steady_clock::now() < deadline) {
+      auto packet = server.recv(10ms);
+      if (!packet || nextTag(packet) != PacketTag::clientData) {
+        continue;
+      }
+      ClientData seqNum{};
+      ClientData clientData{};
+      NamedDataChunk chunk{};
+      packet >> seqNum;
+      if (nextTag(packet) == PacketTag::clientData && packet >> clientData &&
+          packet >> chunk && chunk.shortName == name) {
+        published = true;
+        return;
+      }
+    }
+  });
+
+  ClientConfig config;
+  QuicRClient client(config, network);
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  REQUIRE(client.open(1, "loopback", 5004, 1));
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!client.ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  CHECK(client.ready());
+
+  auto packet = client.createPacket(name, 100);
+  packet->push_back(std::vector<uint8_t>(100, 1));
+  packet->setPriority(3);
+  packet->setReliable(false);
+  CHECK(client.publish(std::move(packet)));
+
+  relay.join();
+  done = true;
+  CHECK(published);
+  CHECK_EQ(server.getStat(PipeInterface::StatName::connectionsActive), 1);
+}
+
+TEST_CASE("QuicRClient subscribes while crypto threads publish")
+{
+  LoopbackNetwork network;
+  QuicRServer server(network);
+  REQUIRE(server.open(5004));
+
+  std::atomic<bool> done(false);
+  std::thread relay([&]() {
+    while (!done) {
+      server.recv(10ms);
+    }
+  });
+
+  // FEC is on by default, so both threads go through FecPipe
+  ClientConfig config;
+  config.cryptoThreads = 2;
+  QuicRClient client(config, network);
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  REQUIRE(client.open(1, "loopback", 5004, 1));
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!client.ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  REQUIRE(client.ready());
+
+  std::atomic<int> published(0);
+  std::thread publisher([&]() {
+    for (uint32_t i = 1; i <= 500; i++) {
+      auto name = ShortName::fromString("qr://1234/12/");
+      name.mediaTime = i;
+      auto packet = client.createPacket(name, 100);
+      packet->push_back(std::vector<uint8_t>(100, 1));
+      packet->setPriority(3);
+      packet->setFEC(true);
+      if (client.publish(std::move(packet))) {
+        published++;
+      }
+    }
+  });
+  for (int i = 0; i < 50; i++) {
+    auto name = ShortName::fromString("qr://5678/" + std::to_string(i) + "/");
+    CHECK(client.subscribe(name));
+  }
+  publisher.join();
+  CHECK_EQ(published, 500);
+
+  done = true;
+  relay.join();
+}
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <doctest/doctest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/statsPipe.hh"
+#include "quicr/metrics.hh"
+#include "quicr/quicRClient.hh"
+
+using namespace MediaNet;
+
+TEST_CASE("Counter adds up the shards of every thread")
+{
+  Counter counter;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < 10000; i++) {
+        counter.add();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  CHECK_EQ(counter.value(), 80000);
+}
+
+TEST_CASE("Histogram puts values in the first bucket that holds them")
+{
+  std::vector<uint64_t> decades{ 1, 2, 5, 10, 20, 50, 100 };
+  CHECK_EQ(Histogram::decadeBounds(100), decades);
+
+  Histogram histogram({ 10, 100 });
+  histogram.record(0);
+  histogram.record(10);
+  histogram.record(11);
+  histogram.record(1000);
+
+  std::vector<uint64_t> buckets{ 2, 1, 1 };
+  CHECK_EQ(histogram.buckets(), buckets);
+  CHECK_EQ(histogram.count(), 4);
+  CHECK_EQ(histogram.sum(), 1021);
+}
+
+TEST_CASE("MetricsRegistry returns the same metric and snapshots it")
+{
+  MetricsRegistry registry(3);
+  Counter& counter = registry.counter("c_total", "help", "a=\"1\"");
+  CHECK_EQ(&counter, &registry.counter("c_total", "help", "a=\"1\""));
+  CHECK_NE(&counter, &registry.counter("c_total", "help", "a=\"2\""));
+  Histogram& histogram = registry.histogram("h", "help", { 5 });
+  CHECK_EQ(registry.size(), 3);
+
+  // past capacity it still works, it just is not reported
+  Gauge& extra = registry.gauge("g", "help");
+  extra.set(7);
+  CHECK_EQ(extra.value(), 7);
+  CHECK_EQ(registry.size(), 3);
+
+  counter.add(3);
+  histogram.record(9);
+
+  auto samples = registry.snapshot();
+  REQUIRE_EQ(samples.size(), 3);
+  CHECK_EQ(samples[0].name, "c_total");
+  CHECK_EQ(samples[0].labels, "a=\"1\"");
+  CHECK_EQ(samples[0].value, 3);
+  CHECK_EQ(samples[1].value, 0);
+  CHECK(samples[2].type == MetricsRegistry::Type::histogram);
+  std::vector<uint64_t> buckets{ 0, 1 };
+  CHECK_EQ(samples[2].buckets, buckets);
+  CHECK_EQ(samples[2].count, 1);
+  CHECK_EQ(samples[2].sum, 9);
+}
+
+TEST_CASE("MetricsRegistry snapshots while other threads register")
+{
+  MetricsRegistry registry;
+  std::atomic<bool> done(false);
+
+  std::thread writer([&]() {
+    for (int i = 0; i < 1000; i++) {
+      registry.counter("n_total", "help", "i=\"" + std::to_string(i) + "\"")
+        .add(uint64_t(i));
+    }
+    done = true;
+  });
+
+  size_t last = 0;
+  bool grew = true;
+  while (!done) {
+    auto samples = registry.snapshot();
+    grew &= samples.size() >= last;
+    last = samples.size();
+    for (const auto& sample : samples) {
+      grew &= sample.name == "n_total";
+    }
+  }
+  writer.join();
+
+  CHECK(grew);
+  CHECK_EQ(registry.snapshot().size(), 1000);
+}
+
+TEST_CASE("MetricsRegistry removes an owner's metrics and reuses their slots")
+{
+  MetricsRegistry registry(3);
+  registry.counter("c_total", "help", "client=\"1\"").add(5);
+  registry.counter("c_total", "help", "client=\"1\",op=\"protect\"");
+  registry.counter("c_total", "help", "client=\"10\"").add(2);
+
+  // client="1" and what is joined onto it, but not client="10"
+  registry.remove("client=\"1\"");
+  auto samples = registry.snapshot();
+  REQUIRE_EQ(samples.size(), 1);
+  CHECK_EQ(samples[0].labels, "client=\"10\"");
+
+  Counter& reused = registry.counter("c_total", "help", "client=\"2\"");
+  registry.counter("c_total", "help", "client=\"2\",op=\"protect\"");
+  CHECK_EQ(registry.size(), 3);
+  CHECK_EQ(reused.value(), 0);
+  CHECK_EQ(registry.snapshot().size(), 3);
+}
+
+TEST_CASE("QuicRClient takes its metrics out of the registry")
+{
+  auto& registry = MetricsRegistry::global();
+  {
+    QuicRClient warmup;
+  }
+  size_t slots = registry.size();
+  size_t reported = registry.snapshot().size();
+
+  for (int i = 0; i < 20; i++) {
+    QuicRClient client;
+    CHECK_GT(registry.snapshot().size(), reported);
+  }
+  CHECK_EQ(registry.size(), slots);
+  CHECK_EQ(registry.snapshot().size(), reported);
+}
+
+TEST_CASE("StatsPipe mirrors its stats into gauges")
+{
+  MetricsRegistry registry;
+  StatsPipe stats(nullptr);
+  stats.updateStat(PipeInterface::StatName::lossPerMillionUp, 12);
+  stats.registerMetrics(registry, "client=\"9\"");
+  stats.updateStat(PipeInterface::StatName::bitrateUp, 1000000);
+
+  CHECK_EQ(stats.getStat(PipeInterface::StatName::bitrateUp), 1000000);
+  CHECK_EQ(registry.gauge("quicr_loss_per_million_up", "", "client=\"9\"")
+             .value(),
+           12);
+  CHECK_EQ(
+    registry.gauge("quicr_bitrate_up_bps", "", "client=\"9\"").value(),
+    1000000);
+}
@@ -0,0 +1,117 @@
+#include <doctest/doctest.h>
+#include <string>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "quicr/metricsExporter.hh"
+
+using namespace MediaNet;
+
+TEST_CASE("MetricsExporter formats samples as OpenMetrics text")
+{
+  MetricsRegistry registry;
+  registry.counter("quicr_sent_total", "packets sent", "client=\"0\"").add(5);
+  registry.gauge("quicr_depth", "queue depth").set(-2);
+  registry.counter("quicr_sent_total", "packets sent", "client=\"1\"").add(1);
+  registry.histogram("quicr_time_ns", "time", { 10, 100 }).record(50);
+
+  std::string expected = "# TYPE quicr_sent counter\n"
+                         "# HELP quicr_sent packets sent\n"
+                         "quicr_sent_total{client=\"0\"} 5\n"
+                         "quicr_sent_total{client=\"1\"} 1\n"
+                         "# TYPE quicr_depth gauge\n"
+                         "# HELP quicr_depth queue depth\n"
+                         "quicr_depth -2\n"
+                         "# TYPE quicr_time_ns histogram\n"
+                         "# HELP quicr_time_ns time\n"
+                         "quicr_time_ns_bucket{le=\"10\"} 0\n"
+                         "quicr_time_ns_bucket{le=\"100\"} 1\n"
+                         "quicr_time_ns_bucket{le=\"+Inf\"} 1\n"
+                         "quicr_time_ns_count 1\n"
+                         "quicr_time_ns_sum 50\n"
+                         "# EOF\n";
+  CHECK_EQ(MetricsExporter::format(registry.snapshot()), expected);
+}
+
+TEST_CASE("TripleBuffer hands the reader the latest value published")
+{
+  TripleBuffer<int> buffer;
+  CHECK_EQ(buffer.read(), 0);
+
+  buffer.back() = 1;
+  buffer.publish();
+  buffer.back() = 2;
+  buffer.publish();
+  CHECK_EQ(buffer.read(), 2);
+  CHECK_EQ(buffer.read(), 2);
+
+  buffer.back() = 3;
+  buffer.publish();
+  CHECK_EQ(buffer.read(), 3);
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+static std::string
+httpGet(uint16_t port, const std::string& path)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr
+  {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return "";
+  }
+
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: x\r\n\r\n";
+  send(fd, request.data(), request.size(), 0);
+
+  std::string response;
+  char buf[1024];
+  ssize_t len;
+  while ((len = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    response.append(buf, size_t(len));
+  }
+  close(fd);
+  return response;
+}
+
+TEST_CASE("MetricsExporter serves /metrics over HTTP")
+{
+  MetricsRegistry registry;
+  registry.counter("quicr_sent_total", "packets sent").add(3);
+
+  MetricsExporter exporter(registry);
+  exporter.addCollector([](MetricsExporter::Samples& samples) {
+    samples.push_back(MetricsRegistry::Sample{ "quicr_face_rx_bps",
+                                               "",
+                                               "face=\"a\"",
+                                               MetricsRegistry::Type::gauge,
+                                               42,
+                                               {},
+                                               {},
+                                               0,
+                                               0 });
+  });
+  REQUIRE(exporter.start(0, "127.0.0.1"));
+  REQUIRE_NE(exporter.port(), 0);
+
+  auto response = httpGet(exporter.port(), "/metrics");
+  CHECK_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0);
+  CHECK_NE(response.find("application/openmetrics-text"), std::string::npos);
+  CHECK_NE(response.find("\nquicr_sent_total 3\n"), std::string::npos);
+  CHECK_NE(response.find("\nquicr_face_rx_bps{face=\"a\"} 42\n"),
+           std::string::npos);
+
+  CHECK_EQ(httpGet(exporter.port(), "/other").rfind("HTTP/1.1 404", 0), 0);
+
+  exporter.stop();
+}
+#endif
@@ -0,0 +1,49 @@
+#include <doctest/doctest.h>
+#include <numeric>
+
+#include "../src/encode.hh"
+#include "quicr/packet.hh"
+#include "quicr/quicRClient.hh"
+
+using namespace MediaNet;
+
+TEST_CASE("acquire and commit write the payload in place")
+{
+  QuicRClient client;
+  client.setCryptoKey(1, sframe::bytes(32, 0x42));
+  auto packet = client.createPacket(ShortName::fromString("qr://1234/12/"),
+                                    1000);
+  size_t headerSize = packet->fullSize();
+  const uint8_t* start = &packet->fullData();
+
+  uint8_t* payload = packet->acquire(1000);
+  CHECK_EQ(packet->size(), 1000);
+  std::iota(payload, payload + 600, uint8_t(0));
+  packet->commit(600);
+
+  // written where createPacket reserved the room, nothing moved
+  CHECK_EQ(&packet->fullData(), start);
+  CHECK_EQ(&packet->data(), payload);
+  REQUIRE_EQ(packet->size(), 600);
+  CHECK_EQ(packet->fullSize(), headerSize + 600);
+  CHECK_EQ((&packet->data())[0], 0);
+  CHECK_EQ((&packet->data())[599], uint8_t(599));
+
+  // it can be published like any other
+  CHECK(client.publish(std::move(packet)));
+}
+
+TEST_CASE("resize clears the payload it adds")
+{
+  Packet packet;
+  packet.resize(100);
+  uint8_t* payload = &packet.data();
+  std::fill(payload, payload + 100, 0xff);
+  packet.resize(10);
+  packet.resize(100);
+  int sum = 0;
+  for (int i = 10; i < 100; i++) {
+    sum += (&packet.data())[i];
+  }
+  CHECK_EQ(sum, 0);
+}
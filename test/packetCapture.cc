@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <doctest/doctest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/encode.hh"
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/packetCapture.hh"
+#include "quicr/quicRClient.hh"
+#include "quicr/quicRServer.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+static IpAddr
+address(const char* ip, uint16_t port)
+{
+  IpAddr addr{};
+  addr.addr.sin_family = AF_INET;
+  inet_pton(AF_INET, ip, &addr.addr.sin_addr);
+  addr.addr.sin_port = htons(port);
+  addr.addrLen = sizeof(addr.addr);
+  return addr;
+}
+
+static std::vector<CapturedPacket>
+readAll(const std::string& path)
+{
+  std::vector<CapturedPacket> packets;
+  CaptureReader reader(path);
+  CapturedPacket packet;
+  while (reader.next(packet)) {
+    packets.push_back(packet);
+  }
+  return packets;
+}
+
+TEST_CASE("PacketCapture writes what CaptureReader reads back")
+{
+  std::string path = "quicr_test_capture.pcap";
+  auto client = address("10.1.2.3", 40000);
+  auto relay = address("192.168.0.1", 5004);
+
+  auto before = std::chrono::system_clock::now().time_since_epoch();
+  {
+    PacketCapture capture(path);
+    REQUIRE(capture.ok());
+    std::vector<uint8_t> data(100, 0x5a);
+    capture.record(client, relay, data.data(), data.size());
+    data.assign(1200, 0xa5);
+    capture.record(relay, client, data.data(), data.size());
+    CHECK_EQ(capture.capturedCount(), 2);
+  }
+
+  auto packets = readAll(path);
+  REQUIRE_EQ(packets.size(), 2);
+  CHECK_EQ(packets[0].data, std::vector<uint8_t>(100, 0x5a));
+  CHECK_EQ(packets[1].data, std::vector<uint8_t>(1200, 0xa5));
+  CHECK_EQ(IpAddr::toString(packets[0].src), IpAddr::toString(client));
+  CHECK_EQ(IpAddr::toString(packets[0].dst), IpAddr::toString(relay));
+  CHECK_EQ(IpAddr::toString(packets[1].src), IpAddr::toString(relay));
+  CHECK_GE(packets[0].time, before);
+  CHECK_LE(packets[0].time, packets[1].time);
+
+  CHECK_FALSE(CaptureReader("no/such/file.pcap").ok());
+  std::remove(path.c_str());
+}
+
+TEST_CASE("PacketCapture rotates to path.1 past maxFileBytes")
+{
+  std::string path = "quicr_test_ring.pcap";
+  std::string older = path + ".1";
+  std::vector<uint8_t> data(1000, 1);
+  auto from = address("10.0.0.1", 1);
+  auto to = address("10.0.0.2", 2);
+
+  // one packet a round, as the writer may flush between any two
+  {
+    PacketCapture capture(path, 2000);
+    for (int round = 0; round < 3; round++) {
+      data[0] = uint8_t(round);
+      capture.record(from, to, data.data(), data.size());
+      capture.flush();
+    }
+  }
+
+  // each packet does not fit after the one before
+  auto newest = readAll(path);
+  auto previous = readAll(older);
+  REQUIRE_EQ(newest.size(), 1);
+  REQUIRE_EQ(previous.size(), 1);
+  CHECK_EQ(newest[0].data[0], 2);
+  CHECK_EQ(previous[0].data[0], 1);
+
+  std::remove(path.c_str());
+  std::remove(older.c_str());
+}
+
+TEST_CASE("PacketCapture stops when it can not reopen after rotating")
+{
+  std::string dir = "quicr_test_gone";
+  std::string path = dir + "/ring.pcap";
+  std::vector<uint8_t> data(1000, 1);
+  auto from = address("10.0.0.1", 1);
+  auto to = address("10.0.0.2", 2);
+
+  REQUIRE_EQ(mkdir(dir.c_str(), 0755), 0);
+  PacketCapture capture(path, 5000);
+  REQUIRE(capture.ok());
+  for (int i = 0; i < 3; i++) {
+    capture.record(from, to, data.data(), data.size());
+  }
+  capture.flush();
+
+  // the directory goes away, so rotating can not make a new file
+  std::remove(path.c_str());
+  REQUIRE_EQ(rmdir(dir.c_str()), 0);
+  for (int i = 0; i < 3; i++) {
+    capture.record(from, to, data.data(), data.size());
+  }
+  capture.flush();
+  CHECK_FALSE(capture.ok());
+
+  capture.record(from, to, data.data(), data.size());
+  CHECK_EQ(capture.capturedCount(), 6);
+}
+
+TEST_CASE("QuicRServer captures its clients' traffic")
+{
+  std::string path = "quicr_test_server.pcap";
+  {
+    LoopbackNetwork network;
+    QuicRServer server(network);
+    REQUIRE(server.startCapture(path));
+    REQUIRE(server.open(5004));
+
+    std::atomic<bool> done(false);
+    std::thread relay([&]() {
+      while (!done) {
+        server.recv(10ms);
+      }
+    });
+
+    QuicRClient client(ClientConfig(), network);
+    REQUIRE(client.open(1, "loopback", 5004, 1));
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!client.ready() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(1ms);
+    }
+    CHECK(client.ready());
+
+    done = true;
+    relay.join();
+  }
+
+  // sync, reset with a cookie, sync again and the syncAck at least
+  auto packets = readAll(path);
+  REQUIRE_GE(packets.size(), 4);
+  CHECK_EQ(ntohs(packets[0].dst.addr.sin_port), 5004);
+  CHECK_EQ(packets[0].data.back(), packetTagTrunc(PacketTag::sync));
+  CHECK_EQ(ntohs(packets[1].src.addr.sin_port), 5004);
+  CHECK_EQ(packets[1].dst.addr.sin_port, packets[0].src.addr.sin_port);
+  CHECK_EQ(packets[1].data.back(), packetTagTrunc(PacketTag::resetRetry));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,42 @@
+#include <doctest/doctest.h>
+#include <functional>
+#include <thread>
+
+#include "../cmd/relay/include/relay.hh"
+#include "quicr/loopbackNetwork.hh"
+#include "quicr/quicRClient.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+// runs the relay on this thread until done() or the deadline
+static bool
+processUntil(Relay& relay, const std::function<bool()>& done)
+{
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    relay.process();
+  }
+  return done();
+}
+
+TEST_CASE("Relay drops the subscriptions of a client that resets")
+{
+  LoopbackNetwork network;
+  Relay relay(network, 5004);
+
+  QuicRClient client(ClientConfig(), network);
+  REQUIRE(client.open(1, "loopback", 5004, 1));
+  REQUIRE(processUntil(relay, [&client]() { return client.ready(); }));
+
+  REQUIRE(client.subscribe(ShortName::fromString("qr://1234/12/")));
+  REQUIRE(processUntil(relay, [&relay]() {
+    return relay.subscriptionCount() == 1;
+  }));
+
+  // a graceful close sends a reset, well before the idle timeout
+  client.close();
+  CHECK(processUntil(relay, [&relay]() {
+    return relay.subscriptionCount() == 0;
+  }));
+}
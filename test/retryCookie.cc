@@ -0,0 +1,44 @@
+#include <arpa/inet.h>
+#include <doctest/doctest.h>
+
+#include "../src/retryCookie.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+static IpAddr
+makeAddr(uint32_t host, uint16_t port)
+{
+  IpAddr ipAddr{};
+  ipAddr.addr.sin_family = AF_INET;
+  ipAddr.addr.sin_addr.s_addr = htonl(host);
+  ipAddr.addr.sin_port = htons(port);
+  ipAddr.addrLen = sizeof(ipAddr.addr);
+  return ipAddr;
+}
+
+TEST_CASE("RetryCookie verifies only for the address it was made for")
+{
+  auto now = std::chrono::steady_clock::now();
+  RetryCookie retryCookie(std::chrono::seconds(10));
+
+  auto a = makeAddr(0x0a000001, 5004);
+  auto cookie = retryCookie.make(a, now);
+
+  CHECK(retryCookie.verify(a, cookie, now));
+  CHECK_FALSE(retryCookie.verify(a, cookie + 1, now));
+  CHECK_FALSE(retryCookie.verify(makeAddr(0x0a000001, 5005), cookie, now));
+  CHECK_FALSE(retryCookie.verify(makeAddr(0x0a000002, 5004), cookie, now));
+}
+
+TEST_CASE("RetryCookie expires after the secret rotates twice")
+{
+  auto now = std::chrono::steady_clock::now();
+  RetryCookie retryCookie(std::chrono::seconds(10));
+
+  auto a = makeAddr(0x0a000001, 5004);
+  auto cookie = retryCookie.make(a, now);
+
+  CHECK(retryCookie.verify(a, cookie, now + std::chrono::seconds(12)));
+  CHECK_FALSE(retryCookie.verify(a, cookie, now + std::chrono::seconds(22)));
+}
@@ -0,0 +1,122 @@
+#include <doctest/doctest.h>
+#include <memory>
+
+#include "../src/encode.hh"
+#include "../src/staticPipeline.hh"
+#include "quicr/packet.hh"
+
+using namespace MediaNet;
+
+class TailPipe : public PipeInterface
+{
+public:
+  TailPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  bool send(std::unique_ptr<Packet> packet) override
+  {
+    sent = std::move(packet);
+    return true;
+  }
+
+  std::unique_ptr<Packet> recv() override { return std::move(toRecv); }
+
+  void updateRTT(uint16_t minRttMs, uint16_t) override { minRtt = minRttMs; }
+
+  void updateBitrateUp(uint64_t, uint64_t startBps, uint64_t) override
+  {
+    startBitrate = startBps;
+  }
+
+  std::unique_ptr<Packet> sent;
+  std::unique_ptr<Packet> toRecv;
+  uint16_t minRtt = 0;
+  uint64_t startBitrate = 0;
+};
+
+class TopPipe : public PipeInterface
+{
+public:
+  explicit TopPipe(PipeInterface* t)
+    : PipeInterface(t)
+  {}
+
+  void updateStat(StatName stat, uint64_t value) override
+  {
+    if (stat == StatName::bitrateUp) {
+      bitrate = value;
+    }
+  }
+
+  void ack(ShortName name) override { acked = name; }
+
+  void sentAt(uint32_t sendId,
+              const std::chrono::time_point<std::chrono::steady_clock>&) override
+  {
+    sentId = sendId;
+  }
+
+  uint64_t bitrate = 0;
+  ShortName acked;
+  uint32_t sentId = 0;
+};
+
+using Chain = StatsStage<CrazyBitStage<DynamicTail>>;
+
+TEST_CASE("StaticPipe passes packets and updates through its stages")
+{
+  auto tail = new TailPipe();
+  auto pipe = new StaticPipe<Chain>(tail);
+  TopPipe top(pipe);
+  REQUIRE(top.start(0, "", nullptr));
+
+  auto packet = std::make_unique<Packet>();
+  packet << Packet::Header(PacketTag::headerData);
+  CHECK(top.send(std::move(packet)));
+  REQUIRE(tail->sent);
+
+  // spin bit is cleared on the way in
+  tail->toRecv = std::move(tail->sent);
+  tail->toRecv->fullData() |= 0x01;
+  auto received = top.recv();
+  REQUIRE(received);
+  CHECK_EQ(received->fullData() & 0x01, 0);
+  CHECK_FALSE(top.recv());
+
+  top.updateRTT(33, 66);
+  CHECK_EQ(tail->minRtt, 33);
+
+  // stats from below are kept by the stats stage and passed on up
+  tail->updateStat(PipeInterface::StatName::bitrateUp, 1234);
+  CHECK_EQ(pipe->stages().getStat(PipeInterface::StatName::bitrateUp), 1234);
+  CHECK_EQ(top.bitrate, 1234);
+}
+
+TEST_CASE("StaticPipe forwards acks, send times, bitrates and metrics")
+{
+  auto tail = new TailPipe();
+  auto pipe = new StaticPipe<Chain>(tail);
+  TopPipe top(pipe);
+  REQUIRE(top.start(0, "", nullptr));
+  MetricsRegistry registry;
+  top.registerMetrics(registry, "");
+
+  top.updateBitrateUp(1000, 2000, 3000);
+  CHECK_EQ(tail->startBitrate, 2000);
+
+  ShortName name(7, 3, 1);
+  name.mediaTime = 9;
+  name.fragmentID = 0;
+  tail->ack(name);
+  CHECK(top.acked == name);
+
+  tail->sentAt(42, std::chrono::steady_clock::now());
+  CHECK_EQ(top.sentId, 42);
+
+  // the stats stage fills the same gauges StatsPipe does
+  tail->updateStat(PipeInterface::StatName::bitrateUp, 1234);
+  auto& gauge = registry.gauge(
+    PipeStats::metricName(PipeInterface::StatName::bitrateUp), "");
+  CHECK_EQ(gauge.value(), 1234);
+}
@@ -0,0 +1,72 @@
+#include <doctest/doctest.h>
+#include <vector>
+
+#include "../src/timerWheel.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+TEST_CASE("TimerWheel fires timers once their tick has passed")
+{
+  auto start = std::chrono::steady_clock::now();
+  TimerWheel<int> wheel(10ms, 8, start);
+
+  wheel.schedule(1, start + 25ms);
+  wheel.schedule(2, start + 55ms);
+  CHECK_EQ(wheel.size(), 2);
+
+  std::vector<int> fired;
+  auto collect = [&fired](int key) { fired.push_back(key); };
+
+  CHECK_EQ(wheel.advance(start + 15ms, collect), 0);
+  CHECK_EQ(wheel.advance(start + 30ms, collect), 1);
+  REQUIRE_EQ(fired.size(), 1);
+  CHECK_EQ(fired[0], 1);
+
+  CHECK_EQ(wheel.advance(start + 60ms, collect), 1);
+  REQUIRE_EQ(fired.size(), 2);
+  CHECK_EQ(fired[1], 2);
+  CHECK_EQ(wheel.size(), 0);
+}
+
+TEST_CASE("TimerWheel keeps timers more than one lap out")
+{
+  auto start = std::chrono::steady_clock::now();
+  TimerWheel<int> wheel(10ms, 4, start); // 40 ms per lap
+
+  wheel.schedule(7, start + 125ms);
+
+  int count = 0;
+  auto collect = [&count](int) { count++; };
+  for (auto t = 10ms; t < 120ms; t += 10ms) {
+    wheel.advance(start + t, collect);
+  }
+  CHECK_EQ(count, 0);
+  CHECK_EQ(wheel.size(), 1);
+
+  // a long stall past the deadline still fires it
+  wheel.advance(start + 1000ms, collect);
+  CHECK_EQ(count, 1);
+}
+
+TEST_CASE("TimerWheel callbacks may schedule again")
+{
+  auto start = std::chrono::steady_clock::now();
+  TimerWheel<int> wheel(10ms, 8, start);
+
+  wheel.schedule(1, start + 10ms);
+
+  int count = 0;
+  auto rearm = [&](int key) {
+    count++;
+    wheel.schedule(key, start + 40ms);
+  };
+  wheel.advance(start + 20ms, rearm);
+  CHECK_EQ(count, 1);
+  CHECK_EQ(wheel.size(), 1);
+
+  wheel.advance(start + 30ms, rearm);
+  CHECK_EQ(count, 1);
+  wheel.advance(start + 40ms, rearm);
+  CHECK_EQ(count, 2);
+}
@@ -0,0 +1,73 @@
+#include <doctest/doctest.h>
+#include <sstream>
+#include <string>
+
+#include "quicr/packet.hh"
+#include "quicr/trace.hh"
+
+using namespace MediaNet;
+
+static PacketTrace
+publishTrace(uint64_t start)
+{
+  PacketTrace trace;
+  trace.ns[size_t(TracePoint::publish)] = start;
+  trace.ns[size_t(TracePoint::sealed)] = start + 3000;
+  trace.ns[size_t(TracePoint::fragmented)] = start + 4000;
+  trace.ns[size_t(TracePoint::queued)] = start + 4500;
+  trace.ns[size_t(TracePoint::dequeued)] = start + 900000;
+  trace.ns[size_t(TracePoint::sent)] = start + 910000;
+  return trace;
+}
+
+TEST_CASE("TraceRecorder records the stages a packet passed")
+{
+  MetricsRegistry registry;
+  TraceRecorder recorder(registry);
+
+  recorder.finish(publishTrace(1000000), ShortName(1, 2, 3));
+  PacketTrace control;
+  control.stamp(TracePoint::sent);
+  recorder.finish(control, ShortName(1));
+
+  auto& seal = registry.histogram("quicr_stage_latency_ns",
+                                  "",
+                                  Histogram::decadeBounds(10000000000),
+                                  "stage=\"seal\"");
+  CHECK_EQ(seal.count(), 1);
+  CHECK_EQ(seal.sum(), 3000);
+  auto& open = registry.histogram("quicr_stage_latency_ns",
+                                  "",
+                                  Histogram::decadeBounds(10000000000),
+                                  "stage=\"open\"");
+  CHECK_EQ(open.count(), 0);
+
+  std::ostringstream text;
+  recorder.dumpText(text);
+  CHECK_NE(text.str().find("send_queue"), std::string::npos);
+  CHECK_EQ(text.str().find("reassembly"), std::string::npos);
+
+  std::ostringstream json;
+  recorder.dumpChromeTrace(json);
+  CHECK_EQ(json.str().rfind("[\n{\"name\":\"seal\",\"ph\":\"X\",\"pid\":1,"
+                            "\"tid\":1,\"ts\":1000.000,\"dur\":3.000,",
+                            0),
+           0);
+  CHECK_NE(json.str().find("\"name\":\"publish_total\""), std::string::npos);
+  CHECK_EQ(json.str().substr(json.str().size() - 3), "\n]\n");
+}
+
+#if defined(QUICR_TRACING)
+TEST_CASE("Packet trace goes along to clones and fragments")
+{
+  Packet packet;
+  packet.push_back(std::vector<uint8_t>(10, 0));
+  packet.trace.stamp(TracePoint::publish);
+
+  CHECK_NE(packet.trace.at(TracePoint::publish), 0);
+  CHECK_EQ(packet.clone()->trace.at(TracePoint::publish),
+           packet.trace.at(TracePoint::publish));
+  CHECK_EQ(packet.cloneSlice(0, 2)->trace.at(TracePoint::publish),
+           packet.trace.at(TracePoint::publish));
+}
+#endif
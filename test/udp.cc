@@ -0,0 +1,87 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../src/udpPipe.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+#if defined(__linux__)
+
+// keeps the send times the transport reports up
+class SentAtPipe : public PipeInterface
+{
+public:
+  using timepoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  SentAtPipe()
+    : PipeInterface(nullptr)
+  {}
+
+  void sentAt(uint32_t sendId, const timepoint& when) override
+  {
+    sent.emplace_back(sendId, when);
+  }
+
+  std::vector<std::pair<uint32_t, timepoint>> sent;
+};
+
+TEST_CASE("UdpPipe stamps packets with kernel send and receive times")
+{
+  UdpPipe server;
+  REQUIRE(server.start(5098, "", nullptr));
+  SentAtPipe up;
+  UdpPipe client;
+  client.setTimestamps(true, true, false);
+  REQUIRE(client.start(5098, "localhost", &up));
+
+  // the kernel turns receive stamps on a moment after being asked, so
+  // wait for a packet that has one. sendId 0 is not passed up.
+  bool stamped = false;
+  auto deadline = std::chrono::steady_clock::now() + 1s;
+  while (!stamped && std::chrono::steady_clock::now() < deadline) {
+    auto warmUp = std::make_unique<Packet>();
+    warmUp->resizeFull(100);
+    REQUIRE(client.send(std::move(warmUp)));
+    std::this_thread::sleep_for(1ms);
+    while (auto early = server.recv()) {
+      stamped |=
+        early->getWireTime() != std::chrono::steady_clock::time_point();
+    }
+  }
+  REQUIRE(stamped);
+
+  auto before = std::chrono::steady_clock::now();
+  auto packet = std::make_unique<Packet>();
+  packet->resizeFull(100);
+  packet->setSendId(42);
+  REQUIRE(client.send(std::move(packet)));
+
+  std::unique_ptr<Packet> received;
+  deadline = std::chrono::steady_clock::now() + 1s;
+  while (!received && std::chrono::steady_clock::now() < deadline) {
+    received = server.recv();
+  }
+  REQUIRE(received);
+  auto arrived = received->getWireTime();
+  CHECK_GE(arrived, before);
+  CHECK_LE(arrived, std::chrono::steady_clock::now());
+
+  // the send time comes off the error queue on the client's next recv
+  deadline = std::chrono::steady_clock::now() + 1s;
+  while (up.sent.empty() && std::chrono::steady_clock::now() < deadline) {
+    client.recv();
+  }
+  REQUIRE_EQ(up.sent.size(), 1);
+  CHECK_EQ(up.sent[0].first, 42);
+  CHECK_GE(up.sent[0].second, before);
+  CHECK_LE(up.sent[0].second, arrived + 1ms);
+
+  client.stop();
+  server.stop();
+}
+
+#endif
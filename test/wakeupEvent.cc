@@ -0,0 +1,73 @@
+#include <doctest/doctest.h>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <poll.h>
+#endif
+
+#include "../src/wakeupEvent.hh"
+
+using namespace MediaNet;
+using namespace std::chrono_literals;
+
+TEST_CASE("WakeupEvent wait returns at once when notified and times out when not")
+{
+  WakeupEvent event;
+
+  event.notify();
+  CHECK(event.waitUntil(std::chrono::steady_clock::now() + 1s));
+  // stays up until cleared
+  CHECK(event.waitUntil(std::chrono::steady_clock::now()));
+
+  event.clear();
+  auto start = std::chrono::steady_clock::now();
+  CHECK_FALSE(event.waitUntil(start + 20ms));
+  CHECK_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
+
+TEST_CASE("WakeupEvent wakes a waiting thread")
+{
+  WakeupEvent event;
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread notifier([&event]() {
+    std::this_thread::sleep_for(10ms);
+    event.notify();
+  });
+  CHECK(event.waitUntil(start + 5s));
+  CHECK_LT(std::chrono::steady_clock::now() - start, 1s);
+  notifier.join();
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+static bool
+readable(int fd)
+{
+  struct pollfd pfd
+  {};
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  return poll(&pfd, 1, 0) == 1;
+}
+
+TEST_CASE("WakeupEvent fd is readable while the event is up")
+{
+  WakeupEvent event;
+
+  // a notify from before the fd was asked for still shows
+  event.notify();
+  int fd = event.fd();
+  REQUIRE_GE(fd, 0);
+  CHECK_EQ(event.fd(), fd);
+  CHECK(readable(fd));
+
+  event.clear();
+  CHECK_FALSE(readable(fd));
+
+  event.notify();
+  event.notify();
+  CHECK(readable(fd));
+  event.clear();
+  CHECK_FALSE(readable(fd));
+}
+#endif